@@ -9,7 +9,11 @@ public static class Game
     {
         PhysicsWorld.Instance.Init();
 
-        int meshId = NativeBridge.LoadMesh(ModelPath);
+        NativeBridge.SetTextureMipmaps(GameConstants.TextureMipmaps);
+        NativeBridge.SetMeshOptimization(GameConstants.MeshOptimization);
+        NativeBridge.SetMeshLods(GameConstants.MeshLods);
+        NativeBridge.SetLodBias(GameConstants.LodBias);
+        int meshId = world.LoadMesh(ModelPath);
         if (meshId < 0)
         {
             Console.WriteLine("Failed to load model: " + ModelPath);
@@ -45,6 +49,9 @@ public static class Game
         );
 
         NativeBridge.SetAmbient(0.15f);
+        NativeBridge.SetGpuCulling(GameConstants.GpuCulling);
+        NativeBridge.SetMeshletCulling(GameConstants.MeshletCulling);
+        NativeBridge.SetRecordThreads(GameConstants.RecordThreads);
 
         // --- Procedural primitives showcase ---
         int groundMesh = NativeBridge.CreatePlaneMesh(20f, 20f, new Color(0.3f, 0.3f, 0.3f));
@@ -3,6 +3,16 @@ namespace ECS
     public static class GameConstants
     {
         public static bool Debug = true;
+        public static bool GpuCulling = false;
+        public static bool MeshletCulling = true;
+        public static int RecordThreads = 1;
+        public static bool TextureMipmaps = true;
+        public static bool MeshOptimization = true;
+        public static bool MeshLods = true;
+        public static float LodBias = 1f;
+        // Applied before the renderer is initialized (see Viewer.Main)
+        public static int FramesInFlight = 2;
+        public static PresentMode PresentMode = PresentMode.Mailbox;
         public static float FreeCamSensitivity = 0.15f;
         public static float FreeCamSpeed = 5f;
 
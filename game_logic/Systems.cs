@@ -301,13 +301,16 @@ namespace ECS
             }
         }
 
+        // Light slots filled by the previous LightSyncSystem run
+        private static int syncedLightSlots_ = 0;
+
         public static void LightSyncSystem(World world)
         {
             List<int> entities = world.Query(typeof(Light), typeof(Transform));
             int slot = 0;
             foreach (int e in entities)
             {
-                if (slot >= 8) break;
+                if (slot >= NativeBridge.MaxLights) break;
                 var light = world.GetComponent<Light>(e);
                 var tr = world.GetComponent<Transform>(e);
 
@@ -324,9 +327,10 @@ namespace ECS
                 slot++;
             }
 
-            // Clear unused slots
-            for (int i = slot; i < 8; i++)
+            // Clear the slots of lights removed since the last run
+            for (int i = slot; i < syncedLightSlots_; i++)
                 NativeBridge.ClearLight(i);
+            syncedLightSlots_ = slot;
         }
 
         public static void HierarchyTransformSystem(World world)
@@ -3,6 +3,14 @@ using System.Runtime.InteropServices;
 
 namespace ECS
 {
+    // Matches PresentMode in renderer.h
+    public enum PresentMode
+    {
+        Fifo = 0,
+        Mailbox = 1,
+        Immediate = 2
+    }
+
     public static class NativeBridge
     {
         const string LIB = "renderer";
@@ -30,8 +38,13 @@ namespace ECS
         public const int GLFW_MOUSE_BUTTON_RIGHT = 1;
         public const int GLFW_MOUSE_BUTTON_MIDDLE = 2;
 
+        // Light slots accepted by SetLight/ClearLight (MAX_LIGHTS in renderer.h)
+        public const int MaxLights = 1024;
+
         // Legacy API
         [DllImport(LIB)] public static extern bool renderer_init(int width, int height, string title);
+        [DllImport(LIB)] public static extern bool renderer_init_headless(int width, int height);
+        [DllImport(LIB)] public static extern void renderer_set_frame_dump_directory(string directory);
         [DllImport(LIB)] public static extern void renderer_cleanup();
         [DllImport(LIB)] public static extern bool renderer_load_model(string path);
         [DllImport(LIB)] public static extern bool renderer_should_close();
@@ -42,6 +55,8 @@ namespace ECS
 
         // Multi-entity API
         [DllImport(LIB)] public static extern int renderer_load_mesh(string path);
+        [DllImport(LIB)] public static extern void renderer_release_mesh(int mesh_id);
+        [DllImport(LIB)] public static extern int renderer_get_mesh_ref_count(int mesh_id);
         [DllImport(LIB)] public static extern int renderer_create_entity(int mesh_id);
         [DllImport(LIB)] public static extern void renderer_set_entity_transform(int entity_id, float[] mat4x4);
         [DllImport(LIB)] public static extern void renderer_remove_entity(int entity_id);
@@ -78,6 +93,27 @@ namespace ECS
         // Debug Overlay API
         [DllImport(LIB)] public static extern void renderer_set_debug_overlay(int enabled);
         [DllImport(LIB)] public static extern int renderer_get_entity_count();
+        [DllImport(LIB)] public static extern int renderer_get_culled_entity_count();
+        [DllImport(LIB)] public static extern void renderer_get_render_stats(out int drawCalls, out int instances, out int pipelineBinds, out int descriptorBinds, out int bufferBinds, out int skippedBinds);
+        [DllImport(LIB)] public static extern void renderer_print_memory_stats();
+        [DllImport(LIB)] public static extern int renderer_get_gpu_timings(out float cullMs, out float sceneMs, out float debugMs, out float uiMs, out float totalMs);
+        [DllImport(LIB)] public static extern int renderer_get_pipeline_statistics(out ulong vertexInvocations, out ulong clippingPrimitives, out ulong fragmentInvocations);
+        [DllImport(LIB)] public static extern void renderer_set_texture_mipmaps(int enabled);
+        [DllImport(LIB)] public static extern void renderer_set_mesh_optimization(int enabled);
+        [DllImport(LIB)] public static extern void renderer_set_weld_epsilon(float epsilon);
+        [DllImport(LIB)] public static extern void renderer_set_mesh_lods(int enabled);
+        [DllImport(LIB)] public static extern void renderer_set_lod_bias(float pixels);
+        [DllImport(LIB)] public static extern void renderer_set_lod_hysteresis(float fraction);
+        [DllImport(LIB)] public static extern void renderer_set_frames_in_flight(int count);
+        [DllImport(LIB)] public static extern int renderer_get_frames_in_flight();
+        [DllImport(LIB)] public static extern void renderer_set_present_mode(int mode);
+        [DllImport(LIB)] public static extern int renderer_get_present_mode();
+        [DllImport(LIB)] public static extern void renderer_set_gpu_culling(int enabled);
+        [DllImport(LIB)] public static extern int renderer_get_gpu_culling();
+        [DllImport(LIB)] public static extern void renderer_set_meshlet_culling(int enabled);
+        [DllImport(LIB)] public static extern void renderer_get_meshlet_stats(out int testedMeshlets, out int frustumCulledMeshlets, out int backfaceCulledMeshlets, out int testedTriangles, out int culledTriangles);
+        [DllImport(LIB)] public static extern void renderer_set_record_threads(int threadCount);
+        [DllImport(LIB)] public static extern int renderer_get_record_threads();
 
         // Debug Wireframe Entity API
         [DllImport(LIB)] public static extern int renderer_create_debug_entity(int meshId);
@@ -85,6 +121,20 @@ namespace ECS
         [DllImport(LIB)] public static extern void renderer_remove_debug_entity(int entityId);
         [DllImport(LIB)] public static extern void renderer_clear_debug_entities();
 
+        // Profiler API (no-ops unless the native library was built with PROFILE=1)
+        [DllImport(LIB)] public static extern int renderer_profiler_available();
+        [DllImport(LIB)] public static extern void renderer_profiler_set_enabled(int enabled);
+        [DllImport(LIB)] public static extern int renderer_profiler_intern_name(string name);
+        [DllImport(LIB)] public static extern void renderer_profiler_begin_zone(int nameId);
+        [DllImport(LIB)] public static extern void renderer_profiler_end_zone();
+        [DllImport(LIB)] public static extern int renderer_profiler_write_trace(string path);
+
+        // Benchmarks
+        [DllImport(LIB)] public static extern void renderer_benchmark_culling(int entityCount, int iterations);
+        [DllImport(LIB)] public static extern void renderer_benchmark_recording(int drawCount, int iterations);
+        [DllImport(LIB)] public static extern void renderer_benchmark_mesh_optimizer(string path, int iterations);
+        [DllImport(LIB)] public static extern void renderer_benchmark_lighting(int maxLights, int iterations);
+
         // Lighting API
         [DllImport(LIB)]
         public static extern void renderer_set_light(
@@ -107,6 +157,19 @@ namespace ECS
             return renderer_load_mesh(path);
         }
 
+        // Each successful LoadMesh takes a reference; unchanged files are not
+        // reloaded while the renderer is alive (see World.LoadMesh)
+        public static void ReleaseMesh(int meshId)
+        {
+            renderer_release_mesh(meshId);
+        }
+
+        // -1 for meshes that weren't loaded from a file
+        public static int GetMeshRefCount(int meshId)
+        {
+            return renderer_get_mesh_ref_count(meshId);
+        }
+
         public static int CreateEntity(int meshId)
         {
             return renderer_create_entity(meshId);
@@ -253,6 +316,177 @@ namespace ECS
             return renderer_get_entity_count();
         }
 
+        public static int GetCulledEntityCount()
+        {
+            return renderer_get_culled_entity_count();
+        }
+
+        public static void GetRenderStats(out int drawCalls, out int instances, out int pipelineBinds, out int descriptorBinds, out int bufferBinds, out int skippedBinds)
+        {
+            renderer_get_render_stats(out drawCalls, out instances, out pipelineBinds, out descriptorBinds, out bufferBinds, out skippedBinds);
+        }
+
+        public static void PrintMemoryStats()
+        {
+            renderer_print_memory_stats();
+        }
+
+        public static bool GetGpuTimings(out float cullMs, out float sceneMs, out float debugMs, out float uiMs, out float totalMs)
+        {
+            return renderer_get_gpu_timings(out cullMs, out sceneMs, out debugMs, out uiMs, out totalMs) != 0;
+        }
+
+        public static bool GetPipelineStatistics(out ulong vertexInvocations, out ulong clippingPrimitives, out ulong fragmentInvocations)
+        {
+            return renderer_get_pipeline_statistics(out vertexInvocations, out clippingPrimitives, out fragmentInvocations) != 0;
+        }
+
+        // Applies to textures loaded after the call
+        public static void SetTextureMipmaps(bool enabled)
+        {
+            renderer_set_texture_mipmaps(enabled ? 1 : 0);
+        }
+
+        // Applies to meshes added after the call
+        public static void SetMeshOptimization(bool enabled)
+        {
+            renderer_set_mesh_optimization(enabled ? 1 : 0);
+        }
+
+        // Applies to meshes added after the call; 0 merges exact duplicates only
+        public static void SetWeldEpsilon(float epsilon)
+        {
+            renderer_set_weld_epsilon(epsilon);
+        }
+
+        // Applies to meshes added after the call
+        public static void SetMeshLods(bool enabled)
+        {
+            renderer_set_mesh_lods(enabled ? 1 : 0);
+        }
+
+        // Largest on-screen error, in pixels, a LOD may show before a finer
+        // one is picked; 0 always draws the full mesh
+        public static void SetLodBias(float pixels)
+        {
+            renderer_set_lod_bias(pixels);
+        }
+
+        // 0-1; fraction of the bias an entity must cross before switching
+        public static void SetLodHysteresis(float fraction)
+        {
+            renderer_set_lod_hysteresis(fraction);
+        }
+
+        // 1-3; only takes effect before Init
+        public static void SetFramesInFlight(int count)
+        {
+            renderer_set_frames_in_flight(count);
+        }
+
+        public static int GetFramesInFlight()
+        {
+            return renderer_get_frames_in_flight();
+        }
+
+        // Falls back IMMEDIATE -> MAILBOX -> FIFO; may be changed after Init
+        public static void SetPresentMode(PresentMode mode)
+        {
+            renderer_set_present_mode((int)mode);
+        }
+
+        public static PresentMode GetPresentMode()
+        {
+            return (PresentMode)renderer_get_present_mode();
+        }
+
+        public static void SetGpuCulling(bool enabled)
+        {
+            renderer_set_gpu_culling(enabled ? 1 : 0);
+        }
+
+        public static bool IsGpuCullingEnabled()
+        {
+            return renderer_get_gpu_culling() != 0;
+        }
+
+        public static void SetMeshletCulling(bool enabled)
+        {
+            renderer_set_meshlet_culling(enabled ? 1 : 0);
+        }
+
+        // Last frame culled on the CPU; all zero while GPU culling is on
+        public static void GetMeshletStats(out int testedMeshlets, out int frustumCulledMeshlets, out int backfaceCulledMeshlets, out int testedTriangles, out int culledTriangles)
+        {
+            renderer_get_meshlet_stats(out testedMeshlets, out frustumCulledMeshlets, out backfaceCulledMeshlets, out testedTriangles, out culledTriangles);
+        }
+
+        public static void SetRecordThreads(int threadCount)
+        {
+            renderer_set_record_threads(threadCount);
+        }
+
+        public static int GetRecordThreads()
+        {
+            return renderer_get_record_threads();
+        }
+
+        // True while a capture is running; lets callers skip the zone calls
+        public static bool ProfilerEnabled { get; private set; }
+
+        public static bool IsProfilerAvailable()
+        {
+            return renderer_profiler_available() != 0;
+        }
+
+        public static void SetProfilerEnabled(bool enabled)
+        {
+            renderer_profiler_set_enabled(enabled ? 1 : 0);
+            ProfilerEnabled = enabled && IsProfilerAvailable();
+        }
+
+        // Intern once and keep the id; returns -1 if the name table is full
+        public static int ProfilerZoneId(string name)
+        {
+            return renderer_profiler_intern_name(name);
+        }
+
+        public static void BeginProfilerZone(int zoneId)
+        {
+            renderer_profiler_begin_zone(zoneId);
+        }
+
+        public static void EndProfilerZone()
+        {
+            renderer_profiler_end_zone();
+        }
+
+        public static bool WriteProfilerTrace(string path)
+        {
+            return renderer_profiler_write_trace(path) != 0;
+        }
+
+        public static void BenchmarkCulling(int entityCount = 100000, int iterations = 100)
+        {
+            renderer_benchmark_culling(entityCount, iterations);
+        }
+
+        public static void BenchmarkRecording(int drawCount = 100000, int iterations = 50)
+        {
+            renderer_benchmark_recording(drawCount, iterations);
+        }
+
+        // path = null benchmarks a generated grid instead of a glTF file
+        public static void BenchmarkMeshOptimizer(string path = null, int iterations = 20)
+        {
+            renderer_benchmark_mesh_optimizer(path, iterations);
+        }
+
+        public static void BenchmarkLighting(int maxLights = MaxLights, int iterations = 50)
+        {
+            renderer_benchmark_lighting(maxLights, iterations);
+        }
+
         public static bool IsMouseButtonPressed(int button)
         {
             return renderer_is_mouse_button_pressed(button) != 0;
@@ -1,19 +1,122 @@
 using System;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
 using ECS;
 
 class Viewer
 {
+    // --headless [frames]   render offscreen for a fixed number of frames and
+    //                       report throughput (no window, runs on lavapipe)
+    // --dump-frames <dir>   with --headless, write every frame to <dir> as PPM
+    // --frames-in-flight <1-3>
+    //                       override GameConstants.FramesInFlight
+    // --present-mode <fifo|mailbox|immediate>
+    //                       override GameConstants.PresentMode
+    // --no-mipmaps          load textures without mip chains (for comparisons)
+    // --no-mesh-opt         upload meshes in source triangle order (for
+    //                       comparisons)
+    // --no-lods             load meshes without simplified LODs
+    // --lod-bias <pixels>   override GameConstants.LodBias (0 = always LOD 0)
+    // --no-meshlet-cull     draw whole meshes instead of their visible meshlets
+    // --profile <file>      record CPU zones for the whole run and write them
+    //                       to <file> as Chrome trace JSON on exit (needs a
+    //                       native library built with PROFILE=1)
     static void Main(string[] args)
     {
-        if (!NativeBridge.renderer_init(800, 600, "Vulkan glTF Viewer"))
+        bool headless = false;
+        int headlessFrames = 300;
+        string dumpDirectory = null;
+        string profilePath = null;
+        int framesInFlight = GameConstants.FramesInFlight;
+        PresentMode presentMode = GameConstants.PresentMode;
+        for (int i = 0; i < args.Length; i++)
+        {
+            if (args[i] == "--headless")
+            {
+                headless = true;
+                if (i + 1 < args.Length && int.TryParse(args[i + 1], out int frames))
+                {
+                    headlessFrames = frames;
+                    i++;
+                }
+            }
+            else if (args[i] == "--dump-frames" && i + 1 < args.Length)
+            {
+                dumpDirectory = args[++i];
+            }
+            else if (args[i] == "--frames-in-flight" && i + 1 < args.Length)
+            {
+                int.TryParse(args[++i], out framesInFlight);
+            }
+            else if (args[i] == "--present-mode" && i + 1 < args.Length)
+            {
+                if (Enum.TryParse(args[++i], true, out PresentMode mode) &&
+                    Enum.IsDefined(typeof(PresentMode), mode))
+                    presentMode = mode;
+                else
+                    Console.WriteLine($"Unknown present mode '{args[i]}', using {presentMode}");
+            }
+            else if (args[i] == "--no-mipmaps")
+            {
+                GameConstants.TextureMipmaps = false;
+            }
+            else if (args[i] == "--no-mesh-opt")
+            {
+                GameConstants.MeshOptimization = false;
+            }
+            else if (args[i] == "--no-lods")
+            {
+                GameConstants.MeshLods = false;
+            }
+            else if (args[i] == "--no-meshlet-cull")
+            {
+                GameConstants.MeshletCulling = false;
+            }
+            else if (args[i] == "--lod-bias" && i + 1 < args.Length)
+            {
+                if (float.TryParse(args[++i], NumberStyles.Float, CultureInfo.InvariantCulture, out float bias))
+                    GameConstants.LodBias = bias;
+                else
+                    Console.WriteLine($"Invalid LOD bias '{args[i]}', using {GameConstants.LodBias}");
+            }
+            else if (args[i] == "--profile" && i + 1 < args.Length)
+            {
+                profilePath = args[++i];
+            }
+        }
+
+        NativeBridge.SetFramesInFlight(framesInFlight);
+        NativeBridge.SetPresentMode(presentMode);
+        bool initialized = headless
+            ? NativeBridge.renderer_init_headless(800, 600)
+            : NativeBridge.renderer_init(800, 600, "Vulkan glTF Viewer");
+        if (!initialized)
         {
             Console.WriteLine("Failed to initialize renderer");
             return;
         }
 
+        if (profilePath != null)
+        {
+            if (NativeBridge.IsProfilerAvailable())
+                NativeBridge.SetProfilerEnabled(true);
+            else
+                Console.WriteLine("Profiler not compiled in (rebuild with PROFILE=1); ignoring --profile");
+        }
+
         var world = new World();
         Game.Setup(world);
 
+        if (headless)
+        {
+            RunHeadless(world, headlessFrames, dumpDirectory);
+            WriteProfile(profilePath);
+            PhysicsWorld.Instance.Shutdown();
+            NativeBridge.renderer_cleanup();
+            return;
+        }
+
 #if HOT_RELOAD
         HotReload.Start();
 #endif
@@ -32,7 +135,54 @@ class Viewer
 #if HOT_RELOAD
         HotReload.Stop();
 #endif
+        WriteProfile(profilePath);
         PhysicsWorld.Instance.Shutdown();
         NativeBridge.renderer_cleanup();
     }
+
+    static void WriteProfile(string path)
+    {
+        if (path == null || !NativeBridge.ProfilerEnabled)
+            return;
+        NativeBridge.SetProfilerEnabled(false);
+        if (NativeBridge.WriteProfilerTrace(path))
+            Console.WriteLine($"Wrote CPU profile to {path}");
+        else
+            Console.WriteLine($"Failed to write CPU profile to {path}");
+    }
+
+    static void RunHeadless(World world, int frames, string dumpDirectory)
+    {
+        if (dumpDirectory != null)
+        {
+            Directory.CreateDirectory(dumpDirectory);
+            NativeBridge.renderer_set_frame_dump_directory(dumpDirectory);
+        }
+
+        // GPU pass times are averaged over the frames whose queries were read
+        double gpuTotalMs = 0, gpuSceneMs = 0;
+        int gpuFrames = 0;
+        var stopwatch = Stopwatch.StartNew();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            world.UpdateTime();
+            world.RunSystems();
+            NativeBridge.renderer_render_frame();
+            if (NativeBridge.GetGpuTimings(out _, out float sceneMs, out _, out _, out float totalMs))
+            {
+                gpuTotalMs += totalMs;
+                gpuSceneMs += sceneMs;
+                gpuFrames++;
+            }
+        }
+        stopwatch.Stop();
+
+        double ms = stopwatch.Elapsed.TotalMilliseconds;
+        Console.WriteLine($"Headless: {frames} frames in {ms:F1} ms " +
+                          $"({ms / Math.Max(frames, 1):F2} ms/frame, " +
+                          $"{frames * 1000.0 / Math.Max(ms, 0.001):F1} fps)");
+        if (gpuFrames > 0)
+            Console.WriteLine($"GPU: {gpuTotalMs / gpuFrames:F3} ms/frame total, " +
+                              $"{gpuSceneMs / gpuFrames:F3} ms scene");
+    }
 }
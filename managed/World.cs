@@ -7,6 +7,7 @@ namespace ECS
     {
         public string Name;
         public Action<World> Action;
+        public int ZoneId;
     }
 
     public class World
@@ -15,6 +16,7 @@ namespace ECS
         private readonly HashSet<int> aliveEntities_ = new HashSet<int>();
         private readonly Dictionary<string, Dictionary<int, object>> components_ = new Dictionary<string, Dictionary<int, object>>();
         private readonly List<NamedSystem> systems_ = new List<NamedSystem>();
+        private readonly List<int> loadedMeshes_ = new List<int>();
 
         // Time tracking (computed on native side via glfwGetTime)
         public float DeltaTime { get; private set; } = 0.016f;
@@ -73,6 +75,16 @@ namespace ECS
             }
         }
 
+        // Loads a glTF for this world; Reset gives the reference back, so a hot
+        // reload that loads the same unchanged file gets the same mesh for free
+        public int LoadMesh(string path)
+        {
+            int meshId = NativeBridge.LoadMesh(path);
+            if (meshId >= 0)
+                loadedMeshes_.Add(meshId);
+            return meshId;
+        }
+
         public int SpawnMeshEntity(int meshId, Transform transform)
         {
             int entity = Spawn();
@@ -166,7 +178,13 @@ namespace ECS
 
         public void AddSystem(Action<World> system)
         {
-            systems_.Add(new NamedSystem { Name = system.Method.Name, Action = system });
+            string name = system.Method.Name;
+            systems_.Add(new NamedSystem
+            {
+                Name = name,
+                Action = system,
+                ZoneId = NativeBridge.ProfilerZoneId(name)
+            });
         }
 
         public void UpdateTime()
@@ -180,7 +198,21 @@ namespace ECS
         {
             foreach (var sys in systems_)
             {
-                sys.Action(this);
+                if (!NativeBridge.ProfilerEnabled)
+                {
+                    sys.Action(this);
+                    continue;
+                }
+
+                NativeBridge.BeginProfilerZone(sys.ZoneId);
+                try
+                {
+                    sys.Action(this);
+                }
+                finally
+                {
+                    NativeBridge.EndProfilerZone();
+                }
             }
         }
 
@@ -203,10 +235,14 @@ namespace ECS
             // Clear all debug wireframe entities on the native side
             NativeBridge.ClearDebugEntities();
 
-            // Clear all 8 light slots on the native side
-            for (int i = 0; i < 8; i++)
+            // Clear all light slots on the native side
+            for (int i = 0; i < NativeBridge.MaxLights; i++)
                 NativeBridge.ClearLight(i);
 
+            foreach (int meshId in loadedMeshes_)
+                NativeBridge.ReleaseMesh(meshId);
+            loadedMeshes_.Clear();
+
             nextEntityId_ = 0;
         }
 
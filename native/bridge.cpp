@@ -1,4 +1,5 @@
 #include "renderer.h"
+#include "profiler.h"
 #include <iostream>
 
 static VulkanRenderer g_renderer;
@@ -29,6 +30,14 @@ bool renderer_init(int width, int height, const char *title) {
   BRIDGE_GUARD(false, g_renderer.init(width, height, title))
 }
 
+bool renderer_init_headless(int width, int height) {
+  BRIDGE_GUARD(false, g_renderer.initHeadless(width, height))
+}
+
+void renderer_set_frame_dump_directory(const char *directory) {
+  g_renderer.setFrameDumpDirectory(directory);
+}
+
 void renderer_cleanup() { BRIDGE_GUARD_VOID(g_renderer.cleanup()) }
 
 bool renderer_load_model(const char *path) {
@@ -37,7 +46,10 @@ bool renderer_load_model(const char *path) {
 
 bool renderer_should_close() { return g_renderer.shouldClose(); }
 
-void renderer_poll_events() { g_renderer.pollEvents(); }
+void renderer_poll_events() {
+  PROFILE_FUNCTION();
+  g_renderer.pollEvents();
+}
 
 int renderer_is_key_pressed(int glfw_key) {
   return g_renderer.isKeyPressed(glfw_key);
@@ -47,7 +59,10 @@ void renderer_set_rotation(float rx, float ry, float rz) {
   g_renderer.setRotation(rx, ry, rz);
 }
 
-void renderer_render_frame() { BRIDGE_GUARD_VOID(g_renderer.renderFrame()) }
+void renderer_render_frame() {
+  PROFILE_FUNCTION();
+  BRIDGE_GUARD_VOID(g_renderer.renderFrame())
+}
 
 // --- Multi-entity API ---
 
@@ -55,6 +70,14 @@ int renderer_load_mesh(const char *path) {
   BRIDGE_GUARD(-1, g_renderer.loadMesh(path))
 }
 
+void renderer_release_mesh(int mesh_id) {
+  BRIDGE_GUARD_VOID(g_renderer.releaseMesh(mesh_id))
+}
+
+int renderer_get_mesh_ref_count(int mesh_id) {
+  return g_renderer.getMeshRefCount(mesh_id);
+}
+
 int renderer_create_entity(int mesh_id) {
   BRIDGE_GUARD(-1, g_renderer.createEntity(mesh_id))
 }
@@ -100,7 +123,10 @@ void renderer_reset_scroll_offset() { g_renderer.resetScrollOffset(); }
 
 // --- Time API ---
 
-void renderer_update_time() { g_renderer.updateTime(); }
+void renderer_update_time() {
+  PROFILE_FUNCTION();
+  g_renderer.updateTime();
+}
 
 float renderer_get_delta_time() { return g_renderer.getDeltaTime(); }
 
@@ -159,6 +185,109 @@ void renderer_set_debug_overlay(int enabled) {
 
 int renderer_get_entity_count() { return g_renderer.getActiveEntityCount(); }
 
+int renderer_get_culled_entity_count() {
+  return g_renderer.getCulledEntityCount();
+}
+
+void renderer_get_render_stats(int *draw_calls, int *instances,
+                               int *pipeline_binds, int *descriptor_binds,
+                               int *buffer_binds, int *skipped_binds) {
+  RenderStats stats = g_renderer.getRenderStats();
+  *draw_calls = stats.drawCalls;
+  *instances = stats.instances;
+  *pipeline_binds = stats.pipelineBinds;
+  *descriptor_binds = stats.descriptorBinds;
+  *buffer_binds = stats.bufferBinds;
+  *skipped_binds = stats.skippedBinds;
+}
+
+void renderer_print_memory_stats() { g_renderer.printMemoryStats(); }
+
+int renderer_get_gpu_timings(float *cull_ms, float *scene_ms, float *debug_ms,
+                             float *ui_ms, float *total_ms) {
+  GpuTimings timings = g_renderer.getGpuTimings();
+  *cull_ms = timings.cullMs;
+  *scene_ms = timings.sceneMs;
+  *debug_ms = timings.debugMs;
+  *ui_ms = timings.uiMs;
+  *total_ms = timings.totalMs;
+  return timings.valid ? 1 : 0;
+}
+
+int renderer_get_pipeline_statistics(uint64_t *vertex_invocations,
+                                     uint64_t *clipping_primitives,
+                                     uint64_t *fragment_invocations) {
+  GpuTimings timings = g_renderer.getGpuTimings();
+  *vertex_invocations = timings.vertexInvocations;
+  *clipping_primitives = timings.clippingPrimitives;
+  *fragment_invocations = timings.fragmentInvocations;
+  return timings.statisticsValid ? 1 : 0;
+}
+
+void renderer_set_texture_mipmaps(int enabled) {
+  g_renderer.setTextureMipmaps(enabled != 0);
+}
+
+void renderer_set_mesh_optimization(int enabled) {
+  g_renderer.setMeshOptimization(enabled != 0);
+}
+
+void renderer_set_weld_epsilon(float epsilon) {
+  g_renderer.setWeldEpsilon(epsilon);
+}
+
+void renderer_set_mesh_lods(int enabled) {
+  g_renderer.setMeshLods(enabled != 0);
+}
+
+void renderer_set_lod_bias(float pixels) { g_renderer.setLodBias(pixels); }
+
+void renderer_set_lod_hysteresis(float fraction) {
+  g_renderer.setLodHysteresis(fraction);
+}
+
+void renderer_set_frames_in_flight(int count) {
+  g_renderer.setFramesInFlight(count);
+}
+
+int renderer_get_frames_in_flight() { return g_renderer.getFramesInFlight(); }
+
+void renderer_set_present_mode(int mode) {
+  g_renderer.setPresentMode(static_cast<PresentMode>(mode));
+}
+
+int renderer_get_present_mode() { return g_renderer.getPresentMode(); }
+
+void renderer_set_gpu_culling(int enabled) {
+  BRIDGE_GUARD_VOID(g_renderer.setGpuCulling(enabled != 0))
+}
+
+int renderer_get_gpu_culling() {
+  return g_renderer.isGpuCullingEnabled() ? 1 : 0;
+}
+
+void renderer_set_meshlet_culling(int enabled) {
+  g_renderer.setMeshletCulling(enabled != 0);
+}
+
+void renderer_get_meshlet_stats(int *tested_meshlets,
+                                int *frustum_culled_meshlets,
+                                int *backface_culled_meshlets,
+                                int *tested_triangles, int *culled_triangles) {
+  MeshletStats stats = g_renderer.getMeshletStats();
+  *tested_meshlets = stats.testedMeshlets;
+  *frustum_culled_meshlets = stats.frustumCulledMeshlets;
+  *backface_culled_meshlets = stats.backfaceCulledMeshlets;
+  *tested_triangles = stats.testedTriangles;
+  *culled_triangles = stats.culledTriangles;
+}
+
+void renderer_set_record_threads(int thread_count) {
+  BRIDGE_GUARD_VOID(g_renderer.setRecordThreads(thread_count))
+}
+
+int renderer_get_record_threads() { return g_renderer.getRecordThreads(); }
+
 // --- Debug Wireframe Entity API ---
 
 int renderer_create_debug_entity(int mesh_id) {
@@ -177,4 +306,49 @@ void renderer_clear_debug_entities() {
   BRIDGE_GUARD_VOID(g_renderer.clearDebugEntities())
 }
 
+// --- Profiler API ---
+// No-ops unless the library was built with ENABLE_PROFILER
+
+int renderer_profiler_available() {
+#ifdef ENABLE_PROFILER
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+void renderer_profiler_set_enabled(int enabled) {
+  profilerSetEnabled(enabled != 0);
+}
+
+int renderer_profiler_intern_name(const char *name) {
+  return profilerInternName(name);
+}
+
+void renderer_profiler_begin_zone(int name_id) { profilerBeginZone(name_id); }
+
+void renderer_profiler_end_zone() { profilerEndZone(); }
+
+int renderer_profiler_write_trace(const char *path) {
+  return profilerWriteChromeTrace(path) ? 1 : 0;
+}
+
+// --- Benchmarks ---
+
+void renderer_benchmark_culling(int entity_count, int iterations) {
+  BRIDGE_GUARD_VOID(g_renderer.benchmarkCulling(entity_count, iterations))
+}
+
+void renderer_benchmark_recording(int draw_count, int iterations) {
+  BRIDGE_GUARD_VOID(g_renderer.benchmarkRecording(draw_count, iterations))
+}
+
+void renderer_benchmark_mesh_optimizer(const char *path, int iterations) {
+  BRIDGE_GUARD_VOID(g_renderer.benchmarkMeshOptimizer(path, iterations))
+}
+
+void renderer_benchmark_lighting(int max_lights, int iterations) {
+  BRIDGE_GUARD_VOID(g_renderer.benchmarkLighting(max_lights, iterations))
+}
+
 } // extern "C"
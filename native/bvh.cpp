@@ -0,0 +1,372 @@
+#include "bvh.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+// ---------------------------------------------------------------------------
+// Node pool
+// ---------------------------------------------------------------------------
+
+int DynamicAabbTree::allocateNode() {
+  int nodeId;
+  if (freeList_ != NULL_NODE) {
+    nodeId = freeList_;
+    freeList_ = nodes_[nodeId].parent;
+    nodes_[nodeId] = Node{};
+  } else {
+    nodeId = static_cast<int>(nodes_.size());
+    nodes_.push_back(Node{});
+  }
+  nodes_[nodeId].height = 0;
+  return nodeId;
+}
+
+void DynamicAabbTree::freeNode(int nodeId) {
+  nodes_[nodeId].parent = freeList_;
+  nodes_[nodeId].height = -1;
+  freeList_ = nodeId;
+}
+
+Aabb DynamicAabbTree::fatten(const Aabb &box) const {
+  glm::vec3 extent = box.max - box.min;
+  glm::vec3 margin(std::max(extent.x * marginScale, marginMin),
+                   std::max(extent.y * marginScale, marginMin),
+                   std::max(extent.z * marginScale, marginMin));
+  return {box.min - margin, box.max + margin};
+}
+
+// ---------------------------------------------------------------------------
+// Proxy API
+// ---------------------------------------------------------------------------
+
+int DynamicAabbTree::createProxy(const Aabb &box, int userData) {
+  int proxyId = allocateNode();
+  nodes_[proxyId].box = fatten(box);
+  nodes_[proxyId].userData = userData;
+  insertLeaf(proxyId);
+  proxyCount_++;
+  return proxyId;
+}
+
+void DynamicAabbTree::destroyProxy(int proxyId) {
+  if (proxyId < 0 || proxyId >= static_cast<int>(nodes_.size()) ||
+      !nodes_[proxyId].isLeaf() || nodes_[proxyId].height != 0)
+    return;
+  removeLeaf(proxyId);
+  freeNode(proxyId);
+  proxyCount_--;
+}
+
+bool DynamicAabbTree::moveProxy(int proxyId, const Aabb &box) {
+  if (nodes_[proxyId].box.contains(box))
+    return false;
+
+  removeLeaf(proxyId);
+  nodes_[proxyId].box = fatten(box);
+  insertLeaf(proxyId);
+  return true;
+}
+
+void DynamicAabbTree::clear() {
+  nodes_.clear();
+  root_ = NULL_NODE;
+  freeList_ = NULL_NODE;
+  proxyCount_ = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Insertion / removal
+// ---------------------------------------------------------------------------
+
+void DynamicAabbTree::insertLeaf(int leaf) {
+  if (root_ == NULL_NODE) {
+    root_ = leaf;
+    nodes_[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  // Descend towards the sibling with the lowest surface-area cost
+  Aabb leafBox = nodes_[leaf].box;
+  int index = root_;
+  while (!nodes_[index].isLeaf()) {
+    int child1 = nodes_[index].child1;
+    int child2 = nodes_[index].child2;
+
+    float area = nodes_[index].box.surfaceArea();
+    float combinedArea = Aabb::merge(nodes_[index].box, leafBox).surfaceArea();
+
+    // Cost of creating a new parent for this node and the new leaf
+    float cost = 2.0f * combinedArea;
+    // Minimum cost of pushing the leaf further down the tree
+    float inheritanceCost = 2.0f * (combinedArea - area);
+
+    auto descendCost = [&](int child) {
+      const Node &c = nodes_[child];
+      float merged = Aabb::merge(leafBox, c.box).surfaceArea();
+      if (c.isLeaf())
+        return merged + inheritanceCost;
+      return (merged - c.box.surfaceArea()) + inheritanceCost;
+    };
+    float cost1 = descendCost(child1);
+    float cost2 = descendCost(child2);
+
+    if (cost < cost1 && cost < cost2)
+      break;
+    index = (cost1 < cost2) ? child1 : child2;
+  }
+
+  int sibling = index;
+  int oldParent = nodes_[sibling].parent;
+  int newParent = allocateNode();
+  nodes_[newParent].parent = oldParent;
+  nodes_[newParent].box = Aabb::merge(leafBox, nodes_[sibling].box);
+  nodes_[newParent].height = nodes_[sibling].height + 1;
+  nodes_[newParent].child1 = sibling;
+  nodes_[newParent].child2 = leaf;
+  nodes_[sibling].parent = newParent;
+  nodes_[leaf].parent = newParent;
+
+  if (oldParent != NULL_NODE) {
+    if (nodes_[oldParent].child1 == sibling)
+      nodes_[oldParent].child1 = newParent;
+    else
+      nodes_[oldParent].child2 = newParent;
+  } else {
+    root_ = newParent;
+  }
+
+  // Walk back up, rebalancing and refitting ancestors
+  index = nodes_[leaf].parent;
+  while (index != NULL_NODE) {
+    index = balance(index);
+    Node &node = nodes_[index];
+    const Node &c1 = nodes_[node.child1];
+    const Node &c2 = nodes_[node.child2];
+    node.height = 1 + std::max(c1.height, c2.height);
+    node.box = Aabb::merge(c1.box, c2.box);
+    index = node.parent;
+  }
+}
+
+void DynamicAabbTree::removeLeaf(int leaf) {
+  if (leaf == root_) {
+    root_ = NULL_NODE;
+    return;
+  }
+
+  int parent = nodes_[leaf].parent;
+  int grandParent = nodes_[parent].parent;
+  int sibling = (nodes_[parent].child1 == leaf) ? nodes_[parent].child2
+                                                : nodes_[parent].child1;
+
+  if (grandParent == NULL_NODE) {
+    root_ = sibling;
+    nodes_[sibling].parent = NULL_NODE;
+    freeNode(parent);
+    return;
+  }
+
+  // Replace the parent with the sibling, then refit upwards
+  if (nodes_[grandParent].child1 == parent)
+    nodes_[grandParent].child1 = sibling;
+  else
+    nodes_[grandParent].child2 = sibling;
+  nodes_[sibling].parent = grandParent;
+  freeNode(parent);
+
+  int index = grandParent;
+  while (index != NULL_NODE) {
+    index = balance(index);
+    Node &node = nodes_[index];
+    const Node &c1 = nodes_[node.child1];
+    const Node &c2 = nodes_[node.child2];
+    node.height = 1 + std::max(c1.height, c2.height);
+    node.box = Aabb::merge(c1.box, c2.box);
+    index = node.parent;
+  }
+}
+
+// Performs a left or right rotation if node A is imbalanced. Returns the index
+// of the node that now occupies A's position in the tree.
+int DynamicAabbTree::balance(int iA) {
+  Node *A = &nodes_[iA];
+  if (A->isLeaf() || A->height < 2)
+    return iA;
+
+  int iB = A->child1;
+  int iC = A->child2;
+  Node *B = &nodes_[iB];
+  Node *C = &nodes_[iC];
+
+  auto replaceChild = [this](int parent, int oldChild, int newChild) {
+    if (parent == NULL_NODE) {
+      root_ = newChild;
+    } else if (nodes_[parent].child1 == oldChild) {
+      nodes_[parent].child1 = newChild;
+    } else {
+      nodes_[parent].child2 = newChild;
+    }
+  };
+
+  int bal = C->height - B->height;
+
+  // Rotate C up
+  if (bal > 1) {
+    int iF = C->child1;
+    int iG = C->child2;
+    Node *F = &nodes_[iF];
+    Node *G = &nodes_[iG];
+
+    C->child1 = iA;
+    C->parent = A->parent;
+    A->parent = iC;
+    replaceChild(C->parent, iA, iC);
+
+    if (F->height > G->height) {
+      C->child2 = iF;
+      A->child2 = iG;
+      G->parent = iA;
+      A->box = Aabb::merge(B->box, G->box);
+      C->box = Aabb::merge(A->box, F->box);
+      A->height = 1 + std::max(B->height, G->height);
+      C->height = 1 + std::max(A->height, F->height);
+    } else {
+      C->child2 = iG;
+      A->child2 = iF;
+      F->parent = iA;
+      A->box = Aabb::merge(B->box, F->box);
+      C->box = Aabb::merge(A->box, G->box);
+      A->height = 1 + std::max(B->height, F->height);
+      C->height = 1 + std::max(A->height, G->height);
+    }
+    return iC;
+  }
+
+  // Rotate B up
+  if (bal < -1) {
+    int iD = B->child1;
+    int iE = B->child2;
+    Node *D = &nodes_[iD];
+    Node *E = &nodes_[iE];
+
+    B->child1 = iA;
+    B->parent = A->parent;
+    A->parent = iB;
+    replaceChild(B->parent, iA, iB);
+
+    if (D->height > E->height) {
+      B->child2 = iD;
+      A->child1 = iE;
+      E->parent = iA;
+      A->box = Aabb::merge(C->box, E->box);
+      B->box = Aabb::merge(A->box, D->box);
+      A->height = 1 + std::max(C->height, E->height);
+      B->height = 1 + std::max(A->height, D->height);
+    } else {
+      B->child2 = iE;
+      A->child1 = iD;
+      D->parent = iA;
+      A->box = Aabb::merge(C->box, D->box);
+      B->box = Aabb::merge(A->box, E->box);
+      A->height = 1 + std::max(C->height, D->height);
+      B->height = 1 + std::max(A->height, E->height);
+    }
+    return iB;
+  }
+
+  return iA;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+CullingBenchmarkResult runCullingBenchmark(int entityCount, int iterations) {
+  using Clock = std::chrono::steady_clock;
+  auto msSince = [](Clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(Clock::now() - start)
+        .count();
+  };
+
+  CullingBenchmarkResult result{};
+  result.entityCount = entityCount;
+  if (entityCount <= 0 || iterations <= 0)
+    return result;
+
+  // Open-world style layout: a wide, shallow field of small boxes
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> posXZ(-500.0f, 500.0f);
+  std::uniform_real_distribution<float> posY(0.0f, 20.0f);
+  std::uniform_real_distribution<float> size(0.5f, 2.0f);
+  std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+
+  std::vector<Aabb> boxes(static_cast<size_t>(entityCount));
+  for (auto &box : boxes) {
+    glm::vec3 center(posXZ(rng), posY(rng), posXZ(rng));
+    glm::vec3 half(size(rng) * 0.5f);
+    box = {center - half, center + half};
+  }
+
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f),
+                               glm::vec3(100.0f, 0.0f, 100.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 proj =
+      glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+  proj[1][1] *= -1;
+  Frustum frustum = Frustum::fromMatrix(proj * view);
+
+  DynamicAabbTree tree;
+  std::vector<int> proxies(boxes.size());
+  auto start = Clock::now();
+  for (size_t i = 0; i < boxes.size(); i++)
+    proxies[i] = tree.createProxy(boxes[i], static_cast<int>(i));
+  result.buildMs = msSince(start);
+
+  int movingCount = std::max(1, entityCount / 10);
+  std::vector<int> visible;
+  visible.reserve(boxes.size());
+  float linearTotal = 0.0f, treeTotal = 0.0f, updateTotal = 0.0f;
+
+  for (int frame = 0; frame < iterations; frame++) {
+    // Move a subset of entities by a small amount, as a game would
+    start = Clock::now();
+    for (int m = 0; m < movingCount; m++) {
+      size_t i = static_cast<size_t>((frame * movingCount + m) % entityCount);
+      glm::vec3 delta(jitter(rng), 0.0f, jitter(rng));
+      boxes[i].min += delta;
+      boxes[i].max += delta;
+      tree.moveProxy(proxies[i], boxes[i]);
+    }
+    updateTotal += msSince(start);
+
+    start = Clock::now();
+    int linearVisible = 0;
+    for (const auto &box : boxes) {
+      if (frustum.intersectsAabb(box.min, box.max))
+        linearVisible++;
+    }
+    linearTotal += msSince(start);
+
+    start = Clock::now();
+    visible.clear();
+    tree.query(frustum, [&](int id, bool fullyInside) {
+      const Aabb &box = boxes[static_cast<size_t>(id)];
+      if (fullyInside || frustum.intersectsAabb(box.min, box.max))
+        visible.push_back(id);
+    });
+    treeTotal += msSince(start);
+
+    result.visibleCount = linearVisible;
+    if (static_cast<int>(visible.size()) != linearVisible)
+      result.visibleCount = -1; // mismatch between tree and linear scan
+  }
+
+  result.linearMs = linearTotal / static_cast<float>(iterations);
+  result.treeMs = treeTotal / static_cast<float>(iterations);
+  result.updateMs = updateTotal / static_cast<float>(iterations);
+  result.treeHeight = tree.getHeight();
+  return result;
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct Aabb {
+  glm::vec3 min = glm::vec3(0.0f);
+  glm::vec3 max = glm::vec3(0.0f);
+
+  bool contains(const Aabb &other) const {
+    return min.x <= other.min.x && min.y <= other.min.y &&
+           min.z <= other.min.z && other.max.x <= max.x &&
+           other.max.y <= max.y && other.max.z <= max.z;
+  }
+
+  float surfaceArea() const {
+    glm::vec3 d = max - min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+  }
+
+  static Aabb merge(const Aabb &a, const Aabb &b) {
+    return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+  }
+};
+
+enum class FrustumTest { Outside, Intersecting, Inside };
+
+// View frustum as six inward-facing planes (xyz = normal, w = distance)
+struct Frustum {
+  glm::vec4 planes[6];
+
+  // Gribb/Hartmann extraction for a [0,1] depth range clip space
+  static Frustum fromMatrix(const glm::mat4 &m) {
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum f;
+    f.planes[0] = row3 + row0; // left
+    f.planes[1] = row3 - row0; // right
+    f.planes[2] = row3 + row1; // bottom
+    f.planes[3] = row3 - row1; // top
+    f.planes[4] = row2;        // near
+    f.planes[5] = row3 - row2; // far
+    for (auto &p : f.planes)
+      p = p / glm::length(glm::vec3(p));
+    return f;
+  }
+
+  bool intersectsSphere(const glm::vec3 &center, float radius) const {
+    for (const auto &p : planes) {
+      if (glm::dot(glm::vec3(p), center) + p.w < -radius)
+        return false;
+    }
+    return true;
+  }
+
+  bool intersectsAabb(const glm::vec3 &bmin, const glm::vec3 &bmax) const {
+    for (const auto &p : planes) {
+      // Test the corner furthest along the plane normal
+      glm::vec3 positive(p.x >= 0.0f ? bmax.x : bmin.x,
+                         p.y >= 0.0f ? bmax.y : bmin.y,
+                         p.z >= 0.0f ? bmax.z : bmin.z);
+      if (glm::dot(glm::vec3(p), positive) + p.w < 0.0f)
+        return false;
+    }
+    return true;
+  }
+
+  // Three-way test used by the BVH to accept whole subtrees
+  FrustumTest classifyAabb(const Aabb &box) const {
+    FrustumTest result = FrustumTest::Inside;
+    for (const auto &p : planes) {
+      glm::vec3 n(p);
+      glm::vec3 positive(p.x >= 0.0f ? box.max.x : box.min.x,
+                         p.y >= 0.0f ? box.max.y : box.min.y,
+                         p.z >= 0.0f ? box.max.z : box.min.z);
+      if (glm::dot(n, positive) + p.w < 0.0f)
+        return FrustumTest::Outside;
+      glm::vec3 negative(p.x >= 0.0f ? box.min.x : box.max.x,
+                         p.y >= 0.0f ? box.min.y : box.max.y,
+                         p.z >= 0.0f ? box.min.z : box.max.z);
+      if (glm::dot(n, negative) + p.w < 0.0f)
+        result = FrustumTest::Intersecting;
+    }
+    return result;
+  }
+};
+
+// Dynamic AABB tree (incrementally balanced BVH) over renderer entities.
+// Leaves store a "fat" AABB enlarged by a margin so small movements do not
+// touch the tree; moveProxy only reinserts a leaf once it leaves its fat box.
+class DynamicAabbTree {
+public:
+  static const int NULL_NODE = -1;
+
+  int createProxy(const Aabb &box, int userData);
+  void destroyProxy(int proxyId);
+  // Returns true if the leaf had to be reinserted
+  bool moveProxy(int proxyId, const Aabb &box);
+  void clear();
+
+  int getUserData(int proxyId) const { return nodes_[proxyId].userData; }
+  const Aabb &getFatAabb(int proxyId) const { return nodes_[proxyId].box; }
+  int getProxyCount() const { return proxyCount_; }
+  int getHeight() const {
+    return root_ == NULL_NODE ? 0 : nodes_[root_].height;
+  }
+
+  // Visits every leaf whose fat AABB touches the frustum. The callback gets
+  // (userData, fullyInside); leaves under a subtree that is entirely inside
+  // the frustum are reported with fullyInside = true and need no further
+  // testing.
+  template <typename Callback>
+  void query(const Frustum &frustum, Callback &&callback) const {
+    if (root_ == NULL_NODE)
+      return;
+    stack_.clear();
+    stack_.push_back(root_);
+    while (!stack_.empty()) {
+      int nodeId = stack_.back();
+      stack_.pop_back();
+      const Node &node = nodes_[nodeId];
+
+      FrustumTest test = frustum.classifyAabb(node.box);
+      if (test == FrustumTest::Outside)
+        continue;
+      if (test == FrustumTest::Inside) {
+        reportSubtree(nodeId, callback);
+        continue;
+      }
+      if (node.isLeaf()) {
+        callback(node.userData, false);
+      } else {
+        stack_.push_back(node.child1);
+        stack_.push_back(node.child2);
+      }
+    }
+  }
+
+  // Fat-box margin as a fraction of the box extent, plus a fixed minimum
+  float marginScale = 0.1f;
+  float marginMin = 0.05f;
+
+private:
+  struct Node {
+    Aabb box;
+    int parent = NULL_NODE; // doubles as the free-list link
+    int child1 = NULL_NODE;
+    int child2 = NULL_NODE;
+    int height = -1; // -1 = free, 0 = leaf
+    int userData = -1;
+
+    bool isLeaf() const { return child1 == NULL_NODE; }
+  };
+
+  std::vector<Node> nodes_;
+  int root_ = NULL_NODE;
+  int freeList_ = NULL_NODE;
+  int proxyCount_ = 0;
+  mutable std::vector<int> stack_;
+  mutable std::vector<int> subtreeStack_;
+
+  int allocateNode();
+  void freeNode(int nodeId);
+  void insertLeaf(int leaf);
+  void removeLeaf(int leaf);
+  int balance(int nodeId);
+  Aabb fatten(const Aabb &box) const;
+
+  template <typename Callback>
+  void reportSubtree(int nodeId, Callback &callback) const {
+    subtreeStack_.clear();
+    subtreeStack_.push_back(nodeId);
+    while (!subtreeStack_.empty()) {
+      const Node &node = nodes_[subtreeStack_.back()];
+      subtreeStack_.pop_back();
+      if (node.isLeaf()) {
+        callback(node.userData, true);
+      } else {
+        subtreeStack_.push_back(node.child1);
+        subtreeStack_.push_back(node.child2);
+      }
+    }
+  }
+};
+
+struct CullingBenchmarkResult {
+  int entityCount;
+  int visibleCount;
+  float buildMs;      // inserting every entity into the tree
+  float linearMs;     // average per-frame linear scan
+  float treeMs;       // average per-frame tree query
+  float updateMs;     // average per-frame moveProxy for the moving subset
+  int treeHeight;
+};
+
+// Builds a synthetic scene of entityCount boxes and compares a linear frustum
+// scan against the tree query over `iterations` frames (10% of entities move
+// each frame).
+CullingBenchmarkResult runCullingBenchmark(int entityCount, int iterations);
@@ -0,0 +1,132 @@
+#include "ktx2.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K',  'T',  'X', ' ',  '2',
+                                            '0',  0xBB, '\r', '\n', 0x1A, '\n'};
+static const size_t KTX2_HEADER_BYTES = 80;     // identifier + header + index
+static const size_t KTX2_LEVEL_INDEX_BYTES = 24; // offset, length, uncompressed
+
+struct Ktx2Format {
+  VkFormat format;
+  TexelBlock block;
+  const char *name;
+};
+
+static const Ktx2Format KTX2_FORMATS[] = {
+    {VK_FORMAT_R8G8B8A8_UNORM, {1, 1, 4}, "RGBA8_UNORM"},
+    {VK_FORMAT_R8G8B8A8_SRGB, {1, 1, 4}, "RGBA8_SRGB"},
+    {VK_FORMAT_BC1_RGB_UNORM_BLOCK, {4, 4, 8}, "BC1_RGB_UNORM"},
+    {VK_FORMAT_BC1_RGB_SRGB_BLOCK, {4, 4, 8}, "BC1_RGB_SRGB"},
+    {VK_FORMAT_BC1_RGBA_UNORM_BLOCK, {4, 4, 8}, "BC1_RGBA_UNORM"},
+    {VK_FORMAT_BC1_RGBA_SRGB_BLOCK, {4, 4, 8}, "BC1_RGBA_SRGB"},
+    {VK_FORMAT_BC3_UNORM_BLOCK, {4, 4, 16}, "BC3_UNORM"},
+    {VK_FORMAT_BC3_SRGB_BLOCK, {4, 4, 16}, "BC3_SRGB"},
+    {VK_FORMAT_BC5_UNORM_BLOCK, {4, 4, 16}, "BC5_UNORM"},
+    {VK_FORMAT_BC5_SNORM_BLOCK, {4, 4, 16}, "BC5_SNORM"},
+    {VK_FORMAT_BC7_UNORM_BLOCK, {4, 4, 16}, "BC7_UNORM"},
+    {VK_FORMAT_BC7_SRGB_BLOCK, {4, 4, 16}, "BC7_SRGB"},
+    {VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, {4, 4, 8}, "ETC2_RGB8_UNORM"},
+    {VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK, {4, 4, 8}, "ETC2_RGB8_SRGB"},
+    {VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, {4, 4, 16}, "ETC2_RGBA8_UNORM"},
+    {VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, {4, 4, 16}, "ETC2_RGBA8_SRGB"},
+    {VK_FORMAT_ASTC_4x4_UNORM_BLOCK, {4, 4, 16}, "ASTC_4x4_UNORM"},
+    {VK_FORMAT_ASTC_4x4_SRGB_BLOCK, {4, 4, 16}, "ASTC_4x4_SRGB"},
+};
+
+static const Ktx2Format *findFormat(VkFormat format) {
+  for (const auto &entry : KTX2_FORMATS) {
+    if (entry.format == format)
+      return &entry;
+  }
+  return nullptr;
+}
+
+// KTX2 is little-endian, like every host this builds for
+template <typename T> static T readLE(const uint8_t *p) {
+  T value;
+  memcpy(&value, p, sizeof(T));
+  return value;
+}
+
+VkDeviceSize texelBlockLevelBytes(const TexelBlock &block, uint32_t width,
+                                  uint32_t height) {
+  VkDeviceSize blocksX = (width + block.width - 1) / block.width;
+  VkDeviceSize blocksY = (height + block.height - 1) / block.height;
+  return blocksX * blocksY * block.bytes;
+}
+
+bool isKtx2(const uint8_t *data, size_t size) {
+  return size >= sizeof(KTX2_IDENTIFIER) &&
+         memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+}
+
+bool parseKtx2(const uint8_t *data, size_t size, Ktx2Texture &texture,
+               std::string &error) {
+  if (!isKtx2(data, size) || size < KTX2_HEADER_BYTES) {
+    error = "not a KTX2 file";
+    return false;
+  }
+
+  uint32_t vkFormat = readLE<uint32_t>(data + 12);
+  uint32_t width = readLE<uint32_t>(data + 20);
+  uint32_t height = readLE<uint32_t>(data + 24);
+  uint32_t depth = readLE<uint32_t>(data + 28);
+  uint32_t layerCount = readLE<uint32_t>(data + 32);
+  uint32_t faceCount = readLE<uint32_t>(data + 36);
+  uint32_t levelCount = std::max(readLE<uint32_t>(data + 40), 1u);
+  uint32_t supercompression = readLE<uint32_t>(data + 44);
+
+  if (supercompression != 0) {
+    // 1 = BasisLZ, 2 = Zstandard, 3 = ZLIB
+    error = "supercompression scheme " + std::to_string(supercompression) +
+            " is not supported";
+    return false;
+  }
+  if (width == 0 || height == 0 || depth > 1 || layerCount > 1 ||
+      faceCount != 1) {
+    error = "only single 2D images are supported";
+    return false;
+  }
+  const Ktx2Format *format = findFormat(static_cast<VkFormat>(vkFormat));
+  if (!format) {
+    error = "VkFormat " + std::to_string(vkFormat) + " is not supported";
+    return false;
+  }
+
+  uint32_t fullChain = 1;
+  for (uint32_t extent = std::max(width, height); extent > 1; extent /= 2)
+    fullChain++;
+  if (levelCount > fullChain ||
+      KTX2_HEADER_BYTES + levelCount * KTX2_LEVEL_INDEX_BYTES > size) {
+    error = "bad level count";
+    return false;
+  }
+
+  texture.format = format->format;
+  texture.width = width;
+  texture.height = height;
+  texture.block = format->block;
+  texture.levels.assign(levelCount, Ktx2Level{});
+  for (uint32_t level = 0; level < levelCount; level++) {
+    const uint8_t *entry =
+        data + KTX2_HEADER_BYTES + level * KTX2_LEVEL_INDEX_BYTES;
+    uint64_t offset = readLE<uint64_t>(entry);
+    uint64_t length = readLE<uint64_t>(entry + 8);
+    VkDeviceSize expected =
+        texelBlockLevelBytes(format->block, std::max(width >> level, 1u),
+                             std::max(height >> level, 1u));
+    if (length < expected || offset > size || size - offset < length) {
+      error = "level " + std::to_string(level) + " is truncated";
+      return false;
+    }
+    texture.levels[level] = {data + offset, expected};
+  }
+  return true;
+}
+
+const char *ktx2FormatName(VkFormat format) {
+  const Ktx2Format *entry = findFormat(format);
+  return entry ? entry->name : "unknown";
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Smallest addressable unit of an image format: one texel for plain formats,
+// a 4x4 block for the block-compressed ones
+struct TexelBlock {
+  uint32_t width = 1;
+  uint32_t height = 1;
+  uint32_t bytes = 4;
+};
+
+// Bytes of a width x height level stored as tightly packed blocks
+VkDeviceSize texelBlockLevelBytes(const TexelBlock &block, uint32_t width,
+                                  uint32_t height);
+
+struct Ktx2Level {
+  const uint8_t *data = nullptr; // points into the parsed file
+  VkDeviceSize size = 0;
+};
+
+// A 2D texture stored in a KTX2 container, ready to copy straight into a
+// VkImage of `format`. Levels are largest first.
+struct Ktx2Texture {
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  TexelBlock block;
+  std::vector<Ktx2Level> levels;
+};
+
+bool isKtx2(const uint8_t *data, size_t size);
+
+// Parses the container without copying or decoding any image data. Only
+// what can be uploaded as is gets accepted: a single 2D image (no arrays,
+// cubemaps or depth) without supercompression, in RGBA8, BC1/3/5/7, ETC2 or
+// ASTC 4x4. Anything else (including Basis Universal payloads, which need a
+// transcoder) returns false with `error` set.
+bool parseKtx2(const uint8_t *data, size_t size, Ktx2Texture &texture,
+               std::string &error);
+
+// Short name for log output, e.g. "BC7_SRGB"
+const char *ktx2FormatName(VkFormat format);
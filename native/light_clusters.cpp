@@ -0,0 +1,212 @@
+#include "light_clusters.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+
+// ---------------------------------------------------------------------------
+// Cluster bounds
+// ---------------------------------------------------------------------------
+
+void LightClusterGrid::setProjection(uint32_t width, uint32_t height,
+                                     float fovYRadians, float zNear,
+                                     float zFar) {
+  if (width == width_ && height == height_ && fovYRadians == fovY_ &&
+      zNear == zNear_ && zFar == zFar_ && !bounds_.empty())
+    return;
+  width_ = std::max(width, 1u);
+  height_ = std::max(height, 1u);
+  fovY_ = fovYRadians;
+  zNear_ = zNear;
+  zFar_ = zFar;
+  tanHalfFovY_ = std::tan(fovYRadians * 0.5f);
+  tanHalfFovX_ = tanHalfFovY_ * static_cast<float>(width_) /
+                 static_cast<float>(height_);
+
+  float logDepthRange = std::log(zFar_ / zNear_);
+  shaderParams_ = glm::vec4(
+      static_cast<float>(CLUSTER_GRID_X) / static_cast<float>(width_),
+      static_cast<float>(CLUSTER_GRID_Y) / static_cast<float>(height_),
+      CLUSTER_GRID_Z / logDepthRange,
+      CLUSTER_GRID_Z * std::log(zNear_) / logDepthRange);
+
+  // Each cluster is a frustum slab; its AABB covers the four corner rays of
+  // the tile at the slice's near and far depths. View space looks down -z,
+  // and with the flipped projection NDC y grows downwards.
+  bounds_.resize(CLUSTER_COUNT);
+  for (uint32_t z = 0; z < CLUSTER_GRID_Z; z++) {
+    float depth0 = zNear_ * std::pow(zFar_ / zNear_,
+                                     static_cast<float>(z) / CLUSTER_GRID_Z);
+    float depth1 = zNear_ * std::pow(zFar_ / zNear_, static_cast<float>(z + 1) /
+                                                         CLUSTER_GRID_Z);
+    for (uint32_t y = 0; y < CLUSTER_GRID_Y; y++) {
+      for (uint32_t x = 0; x < CLUSTER_GRID_X; x++) {
+        Bounds &b = bounds_[x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z)];
+        b.min = glm::vec3(std::numeric_limits<float>::max());
+        b.max = glm::vec3(std::numeric_limits<float>::lowest());
+        for (uint32_t corner = 0; corner < 4; corner++) {
+          float ndcX = 2.0f * static_cast<float>(x + (corner & 1)) /
+                           CLUSTER_GRID_X -
+                       1.0f;
+          float ndcY = 2.0f * static_cast<float>(y + (corner >> 1)) /
+                           CLUSTER_GRID_Y -
+                       1.0f;
+          glm::vec3 ray(ndcX * tanHalfFovX_, -ndcY * tanHalfFovY_, -1.0f);
+          for (float depth : {depth0, depth1}) {
+            b.min = glm::min(b.min, ray * depth);
+            b.max = glm::max(b.max, ray * depth);
+          }
+        }
+      }
+    }
+  }
+}
+
+uint32_t LightClusterGrid::sliceForDepth(float depth) const {
+  depth = std::min(std::max(depth, zNear_), zFar_);
+  float slice = std::log(depth) * shaderParams_.z - shaderParams_.w;
+  return std::min(static_cast<uint32_t>(std::max(slice, 0.0f)),
+                  static_cast<uint32_t>(CLUSTER_GRID_Z - 1));
+}
+
+// ---------------------------------------------------------------------------
+// Light assignment
+// ---------------------------------------------------------------------------
+
+void LightClusterGrid::build(const std::vector<ClusterLight> &lights,
+                             const glm::mat4 &view, uint32_t firstIndex) {
+  ranges_.assign(CLUSTER_COUNT, ClusterRange{0, 0});
+  indices_.clear();
+  pairClusters_.clear();
+  pairLights_.clear();
+  maxClusterLights_ = 0;
+  if (bounds_.empty())
+    return;
+
+  auto tileRange = [](float ndcMin, float ndcMax, uint32_t tiles,
+                      uint32_t &first, uint32_t &last) {
+    float lo = (ndcMin * 0.5f + 0.5f) * tiles;
+    float hi = (ndcMax * 0.5f + 0.5f) * tiles;
+    if (hi < 0.0f || lo >= static_cast<float>(tiles))
+      return false;
+    first = static_cast<uint32_t>(std::max(lo, 0.0f));
+    last = std::min(static_cast<uint32_t>(hi), tiles - 1);
+    return true;
+  };
+
+  for (size_t i = 0; i < lights.size(); i++) {
+    glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+    float radius = lights[i].radius;
+    float depth = -center.z;
+    if (depth + radius < zNear_ || depth - radius > zFar_)
+      continue;
+
+    // Screen rectangle of the sphere's view-space box: x / depth is extreme
+    // at one of the box corners. A sphere reaching the near plane may cover
+    // anything.
+    uint32_t x0 = 0, x1 = CLUSTER_GRID_X - 1;
+    uint32_t y0 = 0, y1 = CLUSTER_GRID_Y - 1;
+    if (depth - radius > zNear_) {
+      float minX = std::numeric_limits<float>::max(), maxX = -minX;
+      float minY = minX, maxY = -minX;
+      for (float d : {depth - radius, depth + radius}) {
+        for (float sign : {-1.0f, 1.0f}) {
+          float ndcX = (center.x + sign * radius) / (d * tanHalfFovX_);
+          float ndcY = -(center.y + sign * radius) / (d * tanHalfFovY_);
+          minX = std::min(minX, ndcX);
+          maxX = std::max(maxX, ndcX);
+          minY = std::min(minY, ndcY);
+          maxY = std::max(maxY, ndcY);
+        }
+      }
+      if (!tileRange(minX, maxX, CLUSTER_GRID_X, x0, x1) ||
+          !tileRange(minY, maxY, CLUSTER_GRID_Y, y0, y1))
+        continue;
+    }
+
+    uint32_t z0 = sliceForDepth(depth - radius);
+    uint32_t z1 = sliceForDepth(depth + radius);
+    float radiusSq = radius * radius;
+    for (uint32_t z = z0; z <= z1; z++) {
+      for (uint32_t y = y0; y <= y1; y++) {
+        for (uint32_t x = x0; x <= x1; x++) {
+          uint32_t cluster = x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z);
+          const Bounds &b = bounds_[cluster];
+          glm::vec3 d = center - glm::clamp(center, b.min, b.max);
+          if (glm::dot(d, d) > radiusSq)
+            continue;
+          pairClusters_.push_back(cluster);
+          pairLights_.push_back(firstIndex + static_cast<uint32_t>(i));
+          ranges_[cluster].count++;
+        }
+      }
+    }
+  }
+
+  // Counting sort by cluster; lights keep their order inside a cluster
+  uint32_t offset = 0;
+  for (auto &range : ranges_) {
+    range.offset = offset;
+    offset += range.count;
+    maxClusterLights_ = std::max(maxClusterLights_, range.count);
+    range.count = 0;
+  }
+  indices_.resize(offset);
+  for (size_t p = 0; p < pairClusters_.size(); p++) {
+    ClusterRange &range = ranges_[pairClusters_[p]];
+    indices_[range.offset + range.count++] = pairLights_[p];
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+std::vector<LightClusterBenchmarkResult>
+runLightClusterBenchmark(int maxLights, int iterations) {
+  using Clock = std::chrono::steady_clock;
+  std::vector<LightClusterBenchmarkResult> results;
+  if (maxLights <= 0 || iterations <= 0)
+    return results;
+
+  // A street of lamps in front of the camera, most of them in view
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> posX(-40.0f, 40.0f);
+  std::uniform_real_distribution<float> posY(0.0f, 10.0f);
+  std::uniform_real_distribution<float> posZ(2.0f, 100.0f);
+  std::uniform_real_distribution<float> radius(2.0f, 8.0f);
+  std::vector<ClusterLight> allLights(static_cast<size_t>(maxLights));
+  for (auto &light : allLights)
+    light = {glm::vec3(posX(rng), posY(rng), posZ(rng)), radius(rng)};
+
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 5.0f, 0.0f),
+                               glm::vec3(0.0f, 3.0f, 50.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  LightClusterGrid grid;
+  grid.setProjection(1280, 720, glm::radians(60.0f), 0.1f, 100.0f);
+
+  for (int count = std::min(8, maxLights);; count = std::min(count * 2, maxLights)) {
+    std::vector<ClusterLight> lights(allLights.begin(),
+                                     allLights.begin() + count);
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++)
+      grid.build(lights, view, 0);
+    float totalMs =
+        std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+    LightClusterBenchmarkResult r;
+    r.lightCount = count;
+    r.buildMs = totalMs / iterations;
+    r.indexCount = grid.getIndices().size();
+    r.avgClusterLights = static_cast<float>(r.indexCount) / CLUSTER_COUNT;
+    r.maxClusterLights = grid.getMaxClusterLights();
+    results.push_back(r);
+    if (count == maxLights)
+      break;
+  }
+  return results;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Clustered forward lighting (Olsson, Billeter and Assarsson, "Clustered
+// Deferred and Forward Shading", 2012). The view frustum is cut into a grid
+// of froxels: CLUSTER_GRID_X x CLUSTER_GRID_Y screen tiles, each split into
+// CLUSTER_GRID_Z depth slices spaced exponentially between the near and far
+// planes. Every light with a finite radius is listed in each cluster its
+// sphere touches, and shader.frag shades only the lights of the fragment's
+// cluster. The grid size must match the defines in shader.frag.
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+static const uint32_t CLUSTER_COUNT =
+    CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+
+// Where a cluster's lights start in the index list, and how many there are
+struct ClusterRange {
+  uint32_t offset;
+  uint32_t count;
+};
+
+// A point or spot light as far as clustering is concerned: its range as a
+// world-space sphere (spot lights are bounded by their whole sphere)
+struct ClusterLight {
+  glm::vec3 position;
+  float radius;
+};
+
+class LightClusterGrid {
+public:
+  // Recomputes the view-space bounds of every cluster; cheap to call every
+  // frame, it only does work when something changed. The projection is
+  // glm::perspective with Vulkan's flipped Y, as in updateUniformBuffer.
+  void setProjection(uint32_t width, uint32_t height, float fovYRadians,
+                     float zNear, float zFar);
+
+  // Lists every light in each cluster its sphere overlaps. Entry i of
+  // `lights` is written as firstIndex + i.
+  void build(const std::vector<ClusterLight> &lights, const glm::mat4 &view,
+             uint32_t firstIndex);
+
+  // One range per cluster, x fastest, then y, then z
+  const std::vector<ClusterRange> &getRanges() const { return ranges_; }
+  const std::vector<uint32_t> &getIndices() const { return indices_; }
+  // Largest light list of the last build
+  uint32_t getMaxClusterLights() const { return maxClusterLights_; }
+
+  // xy = clusters per pixel, z and w = slice scale and bias:
+  // slice = floor(log(viewDepth) * z - w)
+  glm::vec4 getShaderParams() const { return shaderParams_; }
+
+private:
+  struct Bounds {
+    glm::vec3 min;
+    glm::vec3 max;
+  };
+
+  uint32_t sliceForDepth(float depth) const;
+
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  float fovY_ = 0.0f;
+  float zNear_ = 0.0f;
+  float zFar_ = 0.0f;
+  float tanHalfFovX_ = 0.0f;
+  float tanHalfFovY_ = 0.0f;
+  glm::vec4 shaderParams_ = glm::vec4(0.0f);
+  std::vector<Bounds> bounds_; // view space, same order as ranges_
+
+  std::vector<ClusterRange> ranges_;
+  std::vector<uint32_t> indices_;
+  uint32_t maxClusterLights_ = 0;
+  // (cluster, light) pairs of the current build, before sorting by cluster
+  std::vector<uint32_t> pairClusters_;
+  std::vector<uint32_t> pairLights_;
+};
+
+struct LightClusterBenchmarkResult {
+  int lightCount = 0;
+  float buildMs = 0.0f;           // average per build
+  float avgClusterLights = 0.0f;  // list length averaged over all clusters
+  uint32_t maxClusterLights = 0;
+  size_t indexCount = 0;
+};
+
+// Builds the grid for growing numbers of random point lights in front of a
+// fixed camera, doubling from 8 up to maxLights
+std::vector<LightClusterBenchmarkResult>
+runLightClusterBenchmark(int maxLights, int iterations);
@@ -0,0 +1,269 @@
+#include "memory_allocator.h"
+
+#include <stdexcept>
+#include <string>
+
+const char *memoryCategoryName(MemoryCategory category) {
+  switch (category) {
+  case MEMORY_GEOMETRY:
+    return "geometry";
+  case MEMORY_TEXTURE:
+    return "texture";
+  case MEMORY_ATTACHMENT:
+    return "attachment";
+  case MEMORY_STAGING:
+    return "staging";
+  case MEMORY_FRAME_DATA:
+    return "frame data";
+  default:
+    return "unknown";
+  }
+}
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+void MemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device) {
+  device_ = device;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties_);
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  maxAllocationCount_ = properties.limits.maxMemoryAllocationCount;
+  nonCoherentAtomSize_ = properties.limits.nonCoherentAtomSize;
+  if (nonCoherentAtomSize_ == 0)
+    nonCoherentAtomSize_ = 1;
+}
+
+void MemoryAllocator::destroy() {
+  for (auto &pool : pools_) {
+    for (auto &block : pool.blocks) {
+      if (block.memory)
+        releaseBlock(block);
+    }
+    pool.blocks.clear();
+  }
+  stats_ = MemoryStats{};
+  device_ = VK_NULL_HANDLE;
+}
+
+MemoryAllocation
+MemoryAllocator::allocate(const VkMemoryRequirements &requirements,
+                          VkMemoryPropertyFlags properties,
+                          MemoryCategory category, bool linear) {
+  uint32_t memoryType =
+      findMemoryType(requirements.memoryTypeBits, properties);
+  int poolIndex = static_cast<int>(memoryType * 2 + (linear ? 0 : 1));
+  Pool &pool = pools_[poolIndex];
+
+  // Non-coherent ranges are flushed in atom-sized units, so neighbouring
+  // allocations must not share an atom
+  VkDeviceSize alignment = requirements.alignment ? requirements.alignment : 1;
+  VkMemoryPropertyFlags typeFlags =
+      memoryProperties_.memoryTypes[memoryType].propertyFlags;
+  if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+      !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) &&
+      alignment < nonCoherentAtomSize_)
+    alignment = nonCoherentAtomSize_;
+  VkDeviceSize size = alignUp(requirements.size, alignment);
+
+  VkDeviceSize blockSize = blockSizeFor(memoryType);
+  int blockIndex = -1;
+  VkDeviceSize offset = 0;
+  if (size > blockSize / 2) {
+    blockIndex = createBlock(poolIndex, memoryType, size, true);
+    carve(pool.blocks[blockIndex], size, alignment, offset);
+  } else {
+    for (size_t i = 0; i < pool.blocks.size(); i++) {
+      Block &block = pool.blocks[i];
+      if (block.memory && !block.dedicated &&
+          carve(block, size, alignment, offset)) {
+        blockIndex = static_cast<int>(i);
+        break;
+      }
+    }
+    if (blockIndex < 0) {
+      blockIndex = createBlock(poolIndex, memoryType, blockSize, false);
+      carve(pool.blocks[blockIndex], size, alignment, offset);
+    }
+  }
+
+  Block &block = pool.blocks[blockIndex];
+  block.allocationCount++;
+
+  MemoryAllocation allocation;
+  allocation.memory = block.memory;
+  allocation.offset = offset;
+  allocation.size = size;
+  if (block.mapped)
+    allocation.mapped = static_cast<uint8_t *>(block.mapped) + offset;
+  allocation.category = category;
+  allocation.pool = poolIndex;
+  allocation.block = blockIndex;
+
+  stats_.categories[category].allocationCount++;
+  stats_.categories[category].bytes += size;
+  stats_.usedBytes += size;
+  return allocation;
+}
+
+void MemoryAllocator::free(MemoryAllocation &allocation) {
+  if (allocation.pool < 0)
+    return;
+
+  Pool &pool = pools_[allocation.pool];
+  Block &block = pool.blocks[allocation.block];
+
+  // Insert in offset order, merging with the neighbours it touches
+  auto &ranges = block.freeRanges;
+  size_t i = 0;
+  while (i < ranges.size() && ranges[i].offset < allocation.offset)
+    i++;
+  FreeRange range{allocation.offset, allocation.size};
+  bool mergePrev = i > 0 && ranges[i - 1].offset + ranges[i - 1].size ==
+                                range.offset;
+  bool mergeNext =
+      i < ranges.size() && range.offset + range.size == ranges[i].offset;
+  if (mergePrev && mergeNext) {
+    ranges[i - 1].size += range.size + ranges[i].size;
+    ranges.erase(ranges.begin() + static_cast<std::ptrdiff_t>(i));
+  } else if (mergePrev) {
+    ranges[i - 1].size += range.size;
+  } else if (mergeNext) {
+    ranges[i].offset = range.offset;
+    ranges[i].size += range.size;
+  } else {
+    ranges.insert(ranges.begin() + static_cast<std::ptrdiff_t>(i), range);
+  }
+  block.allocationCount--;
+
+  MemoryCategoryStats &category = stats_.categories[allocation.category];
+  category.allocationCount--;
+  category.bytes -= allocation.size;
+  stats_.usedBytes -= allocation.size;
+
+  // Keep one empty shared block per pool around so a resource that is freed
+  // and recreated every resize doesn't round-trip through the driver
+  if (block.allocationCount == 0) {
+    bool keep = false;
+    if (!block.dedicated) {
+      keep = true;
+      for (const auto &other : pool.blocks) {
+        if (&other != &block && other.memory && !other.dedicated) {
+          keep = false;
+          break;
+        }
+      }
+    }
+    if (!keep)
+      releaseBlock(block);
+  }
+
+  allocation = MemoryAllocation{};
+}
+
+uint32_t MemoryAllocator::findMemoryType(
+    uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+  for (uint32_t i = 0; i < memoryProperties_.memoryTypeCount; i++) {
+    if ((typeFilter & (1u << i)) &&
+        (memoryProperties_.memoryTypes[i].propertyFlags & properties) ==
+            properties) {
+      return i;
+    }
+  }
+  throw std::runtime_error("Failed to find suitable memory type");
+}
+
+// Small heaps (integrated GPUs' host-visible windows, BAR memory) get
+// proportionally smaller blocks so one block can't exhaust them
+VkDeviceSize MemoryAllocator::blockSizeFor(uint32_t memoryType) const {
+  uint32_t heap = memoryProperties_.memoryTypes[memoryType].heapIndex;
+  VkDeviceSize heapSize = memoryProperties_.memoryHeaps[heap].size;
+  VkDeviceSize size = DEFAULT_BLOCK_BYTES;
+  if (heapSize / 8 < size)
+    size = alignUp(heapSize / 8, 1ull << 20);
+  return size;
+}
+
+int MemoryAllocator::createBlock(int poolIndex, uint32_t memoryType,
+                                 VkDeviceSize size, bool dedicated) {
+  if (maxAllocationCount_ && stats_.blockCount >= maxAllocationCount_)
+    throw std::runtime_error("Exceeded maxMemoryAllocationCount (" +
+                             std::to_string(maxAllocationCount_) + ")");
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = memoryType;
+
+  Block block;
+  block.size = size;
+  block.dedicated = dedicated;
+  if (vkAllocateMemory(device_, &allocInfo, nullptr, &block.memory) !=
+      VK_SUCCESS)
+    throw std::runtime_error("Failed to allocate device memory block");
+  if (memoryProperties_.memoryTypes[memoryType].propertyFlags &
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    if (vkMapMemory(device_, block.memory, 0, VK_WHOLE_SIZE, 0,
+                    &block.mapped) != VK_SUCCESS) {
+      vkFreeMemory(device_, block.memory, nullptr);
+      throw std::runtime_error("Failed to map device memory block");
+    }
+  }
+  block.freeRanges.push_back({0, size});
+
+  stats_.blockCount++;
+  stats_.blockBytes += size;
+
+  auto &blocks = pools_[poolIndex].blocks;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    if (!blocks[i].memory) {
+      blocks[i] = std::move(block);
+      return static_cast<int>(i);
+    }
+  }
+  blocks.push_back(std::move(block));
+  return static_cast<int>(blocks.size() - 1);
+}
+
+void MemoryAllocator::releaseBlock(Block &block) {
+  if (block.mapped)
+    vkUnmapMemory(device_, block.memory);
+  vkFreeMemory(device_, block.memory, nullptr);
+  stats_.blockCount--;
+  stats_.blockBytes -= block.size;
+  block = Block{};
+}
+
+// First fit: takes the lowest-offset free range that can hold `size` bytes at
+// `alignment`. Alignment padding in front of the allocation stays free.
+bool MemoryAllocator::carve(Block &block, VkDeviceSize size,
+                            VkDeviceSize alignment, VkDeviceSize &offset) {
+  auto &ranges = block.freeRanges;
+  for (size_t i = 0; i < ranges.size(); i++) {
+    FreeRange range = ranges[i];
+    VkDeviceSize start = alignUp(range.offset, alignment);
+    VkDeviceSize end = range.offset + range.size;
+    if (start + size > end)
+      continue;
+
+    offset = start;
+    auto it = ranges.begin() + static_cast<std::ptrdiff_t>(i);
+    bool hasHead = start > range.offset;
+    bool hasTail = start + size < end;
+    if (hasHead && hasTail) {
+      it->size = start - range.offset;
+      ranges.insert(it + 1, {start + size, end - start - size});
+    } else if (hasHead) {
+      it->size = start - range.offset;
+    } else if (hasTail) {
+      it->offset = start + size;
+      it->size = end - start - size;
+    } else {
+      ranges.erase(it);
+    }
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// What a piece of device memory is used for; only affects the statistics
+enum MemoryCategory {
+  MEMORY_GEOMETRY,   // vertex/index arenas
+  MEMORY_TEXTURE,    // material textures, font atlas
+  MEMORY_ATTACHMENT, // depth buffer
+  MEMORY_STAGING,    // upload staging ring
+  MEMORY_FRAME_DATA, // per-frame UBOs, instance/cull/UI buffers
+  MEMORY_CATEGORY_COUNT
+};
+
+const char *memoryCategoryName(MemoryCategory category);
+
+// A range inside one of the allocator's VkDeviceMemory blocks. Resources are
+// bound at `offset`; host-visible ranges come pre-mapped (blocks are mapped
+// once for their whole lifetime, so never call vkMapMemory on `memory`).
+struct MemoryAllocation {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize size = 0;
+  void *mapped = nullptr;
+  MemoryCategory category = MEMORY_FRAME_DATA;
+  int pool = -1; // -1 = empty
+  int block = -1;
+};
+
+struct MemoryCategoryStats {
+  uint32_t allocationCount = 0;
+  VkDeviceSize bytes = 0;
+};
+
+struct MemoryStats {
+  std::array<MemoryCategoryStats, MEMORY_CATEGORY_COUNT> categories{};
+  uint32_t blockCount = 0;       // live vkAllocateMemory allocations
+  VkDeviceSize blockBytes = 0;   // bytes reserved from the driver
+  VkDeviceSize usedBytes = 0;    // bytes handed out, excluding padding
+};
+
+// Sub-allocates buffers and images out of large VkDeviceMemory blocks, one
+// set of blocks per memory type. Each block keeps an offset-sorted free list;
+// freed ranges are merged with their neighbours so the space is reused.
+// Buffers and optimal-tiling images never share a block, which keeps them
+// bufferImageGranularity apart without padding every allocation.
+class MemoryAllocator {
+public:
+  MemoryAllocator() = default;
+  MemoryAllocator(const MemoryAllocator &) = delete;
+  MemoryAllocator &operator=(const MemoryAllocator &) = delete;
+
+  void init(VkPhysicalDevice physicalDevice, VkDevice device);
+  // Frees every block; all allocations must have been returned first
+  void destroy();
+
+  // Throws std::runtime_error if no memory type matches or the driver is out
+  // of memory
+  MemoryAllocation allocate(const VkMemoryRequirements &requirements,
+                            VkMemoryPropertyFlags properties,
+                            MemoryCategory category, bool linear);
+  // No-op on an empty allocation; resets `allocation` to empty
+  void free(MemoryAllocation &allocation);
+
+  const MemoryStats &getStats() const { return stats_; }
+
+  // Requests larger than half a block get a block of their own
+  static const VkDeviceSize DEFAULT_BLOCK_BYTES = 64ull << 20;
+
+private:
+  struct FreeRange {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+  };
+
+  struct Block {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    void *mapped = nullptr;
+    std::vector<FreeRange> freeRanges; // sorted by offset, never adjacent
+    uint32_t allocationCount = 0;
+    bool dedicated = false;
+  };
+
+  // One per (memory type, linear) pair. Block indices are stable; released
+  // blocks leave an empty slot that the next new block reuses.
+  struct Pool {
+    std::vector<Block> blocks;
+  };
+
+  VkDevice device_ = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties memoryProperties_{};
+  uint32_t maxAllocationCount_ = 0;
+  VkDeviceSize nonCoherentAtomSize_ = 1;
+  std::array<Pool, VK_MAX_MEMORY_TYPES * 2> pools_;
+  MemoryStats stats_;
+
+  uint32_t findMemoryType(uint32_t typeFilter,
+                          VkMemoryPropertyFlags properties) const;
+  VkDeviceSize blockSizeFor(uint32_t memoryType) const;
+  int createBlock(int pool, uint32_t memoryType, VkDeviceSize size,
+                  bool dedicated);
+  void releaseBlock(Block &block);
+  static bool carve(Block &block, VkDeviceSize size, VkDeviceSize alignment,
+                    VkDeviceSize &offset);
+};
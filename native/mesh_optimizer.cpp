@@ -0,0 +1,632 @@
+#include "mesh_optimizer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// ---------------------------------------------------------------------------
+// Analysis
+// ---------------------------------------------------------------------------
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount,
+                                    size_t vertexCount, uint32_t cacheSize) {
+  VertexCacheStats stats;
+  if (indexCount < 3 || vertexCount == 0)
+    return stats;
+
+  // A vertex is in the FIFO while fewer than cacheSize misses happened
+  // since it was last loaded
+  std::vector<uint32_t> loadedAt(vertexCount, 0);
+  std::vector<bool> referenced(vertexCount, false);
+  uint32_t misses = 0;
+  size_t referencedCount = 0;
+  for (size_t i = 0; i < indexCount; i++) {
+    uint32_t v = indices[i];
+    if (!referenced[v]) {
+      referenced[v] = true;
+      referencedCount++;
+    }
+    if (loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize) {
+      misses++;
+      loadedAt[v] = misses;
+    }
+  }
+
+  stats.acmr = static_cast<float>(misses) /
+               static_cast<float>(indexCount / 3);
+  stats.atvr =
+      static_cast<float>(misses) / static_cast<float>(referencedCount);
+  return stats;
+}
+
+// ---------------------------------------------------------------------------
+// Vertex cache (Tipsify)
+// ---------------------------------------------------------------------------
+
+std::vector<uint32_t> optimizeVertexCache(uint32_t *indices, size_t indexCount,
+                                          size_t vertexCount,
+                                          uint32_t cacheSize) {
+  std::vector<uint32_t> clusters;
+  size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0 || vertexCount == 0)
+    return clusters;
+
+  // Vertex -> triangle adjacency, packed as one array plus offsets
+  std::vector<uint32_t> liveCount(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; i++)
+    liveCount[indices[i]]++;
+  std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v++)
+    adjacencyOffset[v + 1] = adjacencyOffset[v] + liveCount[v];
+  std::vector<uint32_t> adjacency(adjacencyOffset[vertexCount]);
+  std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+  for (size_t t = 0; t < triangleCount; t++) {
+    for (int k = 0; k < 3; k++)
+      adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+  }
+
+  std::vector<uint32_t> cacheTime(vertexCount, 0);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> deadEnd; // recently used vertices, most recent last
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> output;
+  output.reserve(triangleCount * 3);
+  uint32_t timestamp = cacheSize + 1;
+  size_t cursor = 0;
+
+  // Falls back to recently touched vertices, then to the next vertex in
+  // input order that still has triangles left
+  auto skipDeadEnd = [&]() -> int64_t {
+    while (!deadEnd.empty()) {
+      uint32_t v = deadEnd.back();
+      deadEnd.pop_back();
+      if (liveCount[v] > 0)
+        return v;
+    }
+    for (; cursor < vertexCount; cursor++) {
+      if (liveCount[cursor] > 0)
+        return static_cast<int64_t>(cursor);
+    }
+    return -1;
+  };
+
+  int64_t fan = skipDeadEnd();
+  clusters.push_back(0);
+  while (fan >= 0) {
+    candidates.clear();
+    for (uint32_t a = adjacencyOffset[fan]; a < adjacencyOffset[fan + 1]; a++) {
+      uint32_t t = adjacency[a];
+      if (emitted[t])
+        continue;
+      for (int k = 0; k < 3; k++) {
+        uint32_t v = indices[t * 3 + k];
+        output.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        liveCount[v]--;
+        if (timestamp - cacheTime[v] > cacheSize)
+          cacheTime[v] = timestamp++;
+      }
+      emitted[t] = true;
+    }
+
+    // Prefer the candidate that has been in the cache longest while still
+    // being certain to stay there for all of its remaining triangles
+    int64_t next = -1;
+    uint32_t best = 0;
+    for (uint32_t v : candidates) {
+      if (liveCount[v] == 0)
+        continue;
+      uint32_t priority = 0;
+      if (timestamp - cacheTime[v] + 2 * liveCount[v] <= cacheSize)
+        priority = timestamp - cacheTime[v];
+      if (priority > best) {
+        best = priority;
+        next = v;
+      }
+    }
+    if (next < 0) {
+      next = skipDeadEnd();
+      if (next >= 0 && output.size() < triangleCount * 3)
+        clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+    }
+    fan = next;
+  }
+
+  memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+  return clusters;
+}
+
+// ---------------------------------------------------------------------------
+// Overdraw
+// ---------------------------------------------------------------------------
+
+void optimizeOverdraw(uint32_t *indices, size_t indexCount,
+                      const std::vector<uint32_t> &clusters,
+                      const float *positions, size_t positionStride,
+                      size_t vertexCount) {
+  size_t triangleCount = indexCount / 3;
+  if (clusters.size() < 2 || vertexCount == 0)
+    return;
+
+  auto position = [&](uint32_t v) {
+    const float *p = reinterpret_cast<const float *>(
+        reinterpret_cast<const uint8_t *>(positions) + v * positionStride);
+    return glm::vec3(p[0], p[1], p[2]);
+  };
+
+  // Area-weighted centroid and summed (area-weighted) normal per cluster
+  struct Cluster {
+    uint32_t first, last; // triangle range [first, last)
+    glm::vec3 centroid;
+    glm::vec3 normal;
+    float area;
+    float sortKey;
+  };
+  std::vector<Cluster> list(clusters.size());
+  glm::vec3 meshCentroid(0.0f);
+  float meshArea = 0.0f;
+  for (size_t c = 0; c < clusters.size(); c++) {
+    Cluster &cluster = list[c];
+    cluster.first = clusters[c];
+    cluster.last = c + 1 < clusters.size()
+                       ? clusters[c + 1]
+                       : static_cast<uint32_t>(triangleCount);
+    cluster.centroid = glm::vec3(0.0f);
+    cluster.normal = glm::vec3(0.0f);
+    cluster.area = 0.0f;
+    for (uint32_t t = cluster.first; t < cluster.last; t++) {
+      glm::vec3 p0 = position(indices[t * 3 + 0]);
+      glm::vec3 p1 = position(indices[t * 3 + 1]);
+      glm::vec3 p2 = position(indices[t * 3 + 2]);
+      glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+      float area = glm::length(n);
+      cluster.centroid += (p0 + p1 + p2) * (area / 3.0f);
+      cluster.normal += n;
+      cluster.area += area;
+    }
+    meshCentroid += cluster.centroid;
+    meshArea += cluster.area;
+  }
+  if (meshArea <= 0.0f)
+    return;
+  meshCentroid /= meshArea;
+
+  for (auto &cluster : list) {
+    float normalLength = glm::length(cluster.normal);
+    if (cluster.area <= 0.0f || normalLength <= 0.0f) {
+      cluster.sortKey = 0.0f;
+      continue;
+    }
+    glm::vec3 centroid = cluster.centroid / cluster.area;
+    cluster.sortKey =
+        glm::dot(centroid - meshCentroid, cluster.normal / normalLength);
+  }
+  std::stable_sort(list.begin(), list.end(),
+                   [](const Cluster &a, const Cluster &b) {
+                     return a.sortKey > b.sortKey;
+                   });
+
+  std::vector<uint32_t> output;
+  output.reserve(triangleCount * 3);
+  for (const auto &cluster : list)
+    output.insert(output.end(), indices + cluster.first * 3,
+                  indices + cluster.last * 3);
+  memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+// ---------------------------------------------------------------------------
+// Vertex fetch
+// ---------------------------------------------------------------------------
+
+size_t optimizeVertexFetch(uint32_t *indices, size_t indexCount,
+                           size_t vertexCount, std::vector<uint32_t> &remap) {
+  remap.assign(vertexCount, ~0u);
+  uint32_t next = 0;
+  for (size_t i = 0; i < indexCount; i++) {
+    uint32_t &mapped = remap[indices[i]];
+    if (mapped == ~0u)
+      mapped = next++;
+    indices[i] = mapped;
+  }
+  return next;
+}
+
+// ---------------------------------------------------------------------------
+// Simplification
+// ---------------------------------------------------------------------------
+
+// Sum of squared distances to a set of planes, weighted by triangle area:
+// error(p) = p^T A p + 2 b.p + c, stored as the 10 unique terms
+struct Quadric {
+  double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+  double b0 = 0, b1 = 0, b2 = 0;
+  double c = 0;
+  double weight = 0;
+
+  void addPlane(glm::dvec3 n, double d, double w) {
+    a00 += w * n.x * n.x;
+    a11 += w * n.y * n.y;
+    a22 += w * n.z * n.z;
+    a01 += w * n.x * n.y;
+    a02 += w * n.x * n.z;
+    a12 += w * n.y * n.z;
+    b0 += w * n.x * d;
+    b1 += w * n.y * d;
+    b2 += w * n.z * d;
+    c += w * d * d;
+    weight += w;
+  }
+
+  Quadric &operator+=(const Quadric &q) {
+    a00 += q.a00;
+    a11 += q.a11;
+    a22 += q.a22;
+    a01 += q.a01;
+    a02 += q.a02;
+    a12 += q.a12;
+    b0 += q.b0;
+    b1 += q.b1;
+    b2 += q.b2;
+    c += q.c;
+    weight += q.weight;
+    return *this;
+  }
+
+  // Mean squared distance, so the cost doesn't depend on triangle sizes
+  double evaluate(glm::dvec3 p) const {
+    double e = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+               2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) +
+               2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+    return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+  }
+};
+
+std::vector<uint32_t> simplifyMesh(const uint32_t *indices, size_t indexCount,
+                                   const float *positions,
+                                   size_t positionStride, size_t vertexCount,
+                                   size_t targetIndexCount, float &resultError) {
+  std::vector<uint32_t> result(indices, indices + indexCount / 3 * 3);
+  resultError = 0.0f;
+  if (result.size() <= targetIndexCount || vertexCount == 0)
+    return result;
+
+  std::vector<glm::dvec3> points(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++) {
+    const float *p = reinterpret_cast<const float *>(
+        reinterpret_cast<const uint8_t *>(positions) + v * positionStride);
+    points[v] = glm::dvec3(p[0], p[1], p[2]);
+  }
+
+  // An edge with no opposite half-edge is open: lock both ends
+  std::vector<bool> locked(vertexCount, false);
+  {
+    std::vector<uint64_t> halfEdges;
+    halfEdges.reserve(result.size());
+    for (size_t t = 0; t < result.size(); t += 3) {
+      for (int k = 0; k < 3; k++) {
+        uint64_t a = result[t + k], b = result[t + (k + 1) % 3];
+        halfEdges.push_back(a << 32 | b);
+      }
+    }
+    std::sort(halfEdges.begin(), halfEdges.end());
+    for (uint64_t edge : halfEdges) {
+      uint64_t a = edge >> 32, b = edge & 0xFFFFFFFFu;
+      if (!std::binary_search(halfEdges.begin(), halfEdges.end(),
+                              b << 32 | a)) {
+        locked[a] = true;
+        locked[b] = true;
+      }
+    }
+  }
+
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t t = 0; t < result.size(); t += 3) {
+    glm::dvec3 p0 = points[result[t]], p1 = points[result[t + 1]],
+               p2 = points[result[t + 2]];
+    glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+    double area = glm::length(n);
+    if (area <= 0.0)
+      continue;
+    n /= area;
+    double d = -glm::dot(n, p0);
+    for (int k = 0; k < 3; k++)
+      quadrics[result[t + k]].addPlane(n, d, area);
+  }
+
+  struct Collapse {
+    uint32_t from, to;
+    double cost;
+  };
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> adjacencyOffset(vertexCount + 1);
+  std::vector<uint32_t> adjacency;
+  std::vector<uint32_t> remap(vertexCount);
+  std::vector<bool> touched(vertexCount);
+  double maxCost = 0.0;
+
+  // Moving `from` onto `to` must not turn any remaining triangle around
+  auto flips = [&](uint32_t from, uint32_t to) {
+    for (uint32_t a = adjacencyOffset[from]; a < adjacencyOffset[from + 1];
+         a++) {
+      const uint32_t *tri = &result[adjacency[a] * 3];
+      if (tri[0] == to || tri[1] == to || tri[2] == to)
+        continue; // collapses away
+      glm::dvec3 p[3], q[3];
+      for (int k = 0; k < 3; k++) {
+        p[k] = points[tri[k]];
+        q[k] = tri[k] == from ? points[to] : p[k];
+      }
+      glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+      glm::dvec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+      if (glm::dot(before, after) <= 0.0)
+        return true;
+    }
+    return false;
+  };
+
+  while (result.size() > targetIndexCount) {
+    size_t triangleCount = result.size() / 3;
+
+    std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+    for (uint32_t v : result)
+      adjacencyOffset[v + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+      adjacencyOffset[v + 1] += adjacencyOffset[v];
+    adjacency.resize(result.size());
+    std::vector<uint32_t> fill(adjacencyOffset.begin(),
+                               adjacencyOffset.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+      for (int k = 0; k < 3; k++)
+        adjacency[fill[result[t * 3 + k]]++] = static_cast<uint32_t>(t);
+    }
+
+    // Cheaper direction of every edge (each interior edge shows up twice)
+    collapses.clear();
+    for (size_t t = 0; t < triangleCount; t++) {
+      for (int k = 0; k < 3; k++) {
+        uint32_t a = result[t * 3 + k], b = result[t * 3 + (k + 1) % 3];
+        Quadric q = quadrics[a];
+        q += quadrics[b];
+        double costAB = locked[a] ? -1.0 : q.evaluate(points[b]);
+        double costBA = locked[b] ? -1.0 : q.evaluate(points[a]);
+        if (costAB >= 0.0 && (costBA < 0.0 || costAB <= costBA))
+          collapses.push_back({a, b, costAB});
+        else if (costBA >= 0.0)
+          collapses.push_back({b, a, costBA});
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse &x, const Collapse &y) {
+                return x.cost < y.cost;
+              });
+
+    // Each collapse removes about two triangles. Neighbourhoods touched in
+    // this pass are left alone so the flip tests stay valid.
+    size_t goal = std::max<size_t>((result.size() - targetIndexCount) / 6, 1);
+    for (size_t v = 0; v < vertexCount; v++)
+      remap[v] = static_cast<uint32_t>(v);
+    std::fill(touched.begin(), touched.end(), false);
+    size_t applied = 0;
+    for (const Collapse &c : collapses) {
+      if (applied >= goal)
+        break;
+      if (touched[c.from] || touched[c.to] || flips(c.from, c.to))
+        continue;
+      remap[c.from] = c.to;
+      quadrics[c.to] += quadrics[c.from];
+      for (uint32_t a = adjacencyOffset[c.from];
+           a < adjacencyOffset[c.from + 1]; a++) {
+        for (int k = 0; k < 3; k++)
+          touched[result[adjacency[a] * 3 + k]] = true;
+      }
+      maxCost = std::max(maxCost, c.cost);
+      applied++;
+    }
+    if (applied == 0)
+      break;
+
+    size_t write = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+      uint32_t a = remap[result[t * 3]], b = remap[result[t * 3 + 1]],
+               c = remap[result[t * 3 + 2]];
+      if (a == b || b == c || a == c)
+        continue;
+      result[write++] = a;
+      result[write++] = b;
+      result[write++] = c;
+    }
+    result.resize(write);
+  }
+
+  resultError = static_cast<float>(std::sqrt(maxCost));
+  return result;
+}
+
+// ---------------------------------------------------------------------------
+// Meshlets
+// ---------------------------------------------------------------------------
+
+// Bounding sphere around the AABB center, and the normal cone from the mean
+// of the unit triangle normals (Wihlidal, "Optimizing the Graphics Pipeline
+// with Compute", 2016)
+static void computeMeshletBounds(Meshlet &meshlet, const uint32_t *indices,
+                                 const float *positions,
+                                 size_t positionStride) {
+  auto position = [&](uint32_t v) {
+    const float *p = reinterpret_cast<const float *>(
+        reinterpret_cast<const uint8_t *>(positions) + v * positionStride);
+    return glm::vec3(p[0], p[1], p[2]);
+  };
+
+  const uint32_t *first = indices + meshlet.indexOffset;
+  size_t indexCount = meshlet.triangleCount * 3;
+  glm::vec3 boundsMin = position(first[0]);
+  glm::vec3 boundsMax = boundsMin;
+  for (size_t i = 1; i < indexCount; i++) {
+    glm::vec3 p = position(first[i]);
+    boundsMin = glm::min(boundsMin, p);
+    boundsMax = glm::max(boundsMax, p);
+  }
+  glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+  float radiusSq = 0.0f;
+  for (size_t i = 0; i < indexCount; i++) {
+    glm::vec3 d = position(first[i]) - center;
+    radiusSq = std::max(radiusSq, glm::dot(d, d));
+  }
+
+  std::vector<glm::vec3> normals;
+  normals.reserve(meshlet.triangleCount);
+  glm::vec3 axis(0.0f);
+  for (size_t t = 0; t < meshlet.triangleCount; t++) {
+    glm::vec3 p0 = position(first[t * 3 + 0]);
+    glm::vec3 n = glm::cross(position(first[t * 3 + 1]) - p0,
+                             position(first[t * 3 + 2]) - p0);
+    float length = glm::length(n);
+    if (length <= 0.0f)
+      continue; // degenerate triangles never rasterize
+    normals.push_back(n / length);
+    axis += normals.back();
+  }
+
+  // Past ~84 degrees of spread the test would almost never pass
+  float cutoff = 1.0f;
+  float axisLength = glm::length(axis);
+  if (axisLength > 0.0f) {
+    axis /= axisLength;
+    float minDot = 1.0f;
+    for (const auto &n : normals)
+      minDot = std::min(minDot, glm::dot(n, axis));
+    if (minDot > 0.1f)
+      cutoff = std::sqrt(1.0f - minDot * minDot);
+  }
+
+  meshlet.center[0] = center.x;
+  meshlet.center[1] = center.y;
+  meshlet.center[2] = center.z;
+  meshlet.radius = std::sqrt(radiusSq);
+  meshlet.coneAxis[0] = axis.x;
+  meshlet.coneAxis[1] = axis.y;
+  meshlet.coneAxis[2] = axis.z;
+  meshlet.coneCutoff = cutoff;
+}
+
+std::vector<Meshlet> buildMeshlets(const uint32_t *indices, size_t indexCount,
+                                   const float *positions,
+                                   size_t positionStride, size_t vertexCount,
+                                   uint32_t maxVertices,
+                                   uint32_t maxTriangles) {
+  std::vector<Meshlet> meshlets;
+  size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0 || vertexCount == 0 || maxVertices < 3 ||
+      maxTriangles == 0)
+    return meshlets;
+
+  // owner[v] is the last meshlet that used v, so membership needs no clearing
+  std::vector<uint32_t> owner(vertexCount, ~0u);
+  Meshlet current{};
+  auto flush = [&]() {
+    if (current.triangleCount == 0)
+      return;
+    computeMeshletBounds(current, indices, positions, positionStride);
+    meshlets.push_back(current);
+    current = Meshlet{};
+  };
+
+  for (size_t t = 0; t < triangleCount; t++) {
+    const uint32_t *tri = indices + t * 3;
+    uint32_t id = static_cast<uint32_t>(meshlets.size());
+    uint32_t added = 0;
+    for (int k = 0; k < 3; k++) {
+      // Repeated corners of a degenerate triangle count once
+      bool repeated = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+      added += owner[tri[k]] != id && !repeated ? 1 : 0;
+    }
+    if (current.vertexCount + added > maxVertices ||
+        current.triangleCount == maxTriangles) {
+      flush();
+      id++;
+      added = 0;
+      for (int k = 0; k < 3; k++) {
+        bool repeated =
+            (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+        added += repeated ? 0 : 1;
+      }
+    }
+    if (current.triangleCount == 0)
+      current.indexOffset = static_cast<uint32_t>(t * 3);
+    for (int k = 0; k < 3; k++)
+      owner[tri[k]] = id;
+    current.vertexCount += added;
+    current.triangleCount++;
+  }
+  flush();
+  return meshlets;
+}
+
+// Conservative sphere form of the cone test: the whole sphere must lie in the
+// region from which every normal in the cone points away
+bool isMeshletBackfacing(const Meshlet &meshlet, const float cameraPos[3]) {
+  if (meshlet.coneCutoff >= 1.0f)
+    return false;
+  glm::vec3 toCenter(meshlet.center[0] - cameraPos[0],
+                     meshlet.center[1] - cameraPos[1],
+                     meshlet.center[2] - cameraPos[2]);
+  glm::vec3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1],
+                 meshlet.coneAxis[2]);
+  return glm::dot(toCenter, axis) >=
+         meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+MeshOptimizerBenchmarkResult
+runMeshOptimizerBenchmark(const float *positions, size_t positionStride,
+                          size_t vertexCount, const uint32_t *indices,
+                          size_t indexCount, int iterations) {
+  using Clock = std::chrono::steady_clock;
+  auto msSince = [](Clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(Clock::now() - start)
+        .count();
+  };
+
+  MeshOptimizerBenchmarkResult result;
+  result.vertexCount = vertexCount;
+  result.triangleCount = indexCount / 3;
+  if (indexCount < 3 || vertexCount == 0 || iterations <= 0)
+    return result;
+  result.before = analyzeVertexCache(indices, indexCount, vertexCount);
+
+  std::vector<uint32_t> work;
+  std::vector<uint32_t> remap;
+  float cacheTotal = 0.0f, overdrawTotal = 0.0f, fetchTotal = 0.0f;
+  for (int i = 0; i < iterations; i++) {
+    work.assign(indices, indices + indexCount);
+
+    auto start = Clock::now();
+    std::vector<uint32_t> clusters =
+        optimizeVertexCache(work.data(), work.size(), vertexCount);
+    cacheTotal += msSince(start);
+
+    start = Clock::now();
+    optimizeOverdraw(work.data(), work.size(), clusters, positions,
+                     positionStride, vertexCount);
+    overdrawTotal += msSince(start);
+
+    start = Clock::now();
+    optimizeVertexFetch(work.data(), work.size(), vertexCount, remap);
+    fetchTotal += msSince(start);
+  }
+
+  // Fetch remapping only renames vertices, so it doesn't change the stats
+  result.after = analyzeVertexCache(work.data(), work.size(), vertexCount);
+  result.cacheMs = cacheTotal / iterations;
+  result.overdrawMs = overdrawTotal / iterations;
+  result.fetchMs = fetchTotal / iterations;
+  return result;
+}
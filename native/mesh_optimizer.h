@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Index and vertex reordering run on every mesh before upload, so triangles
+// reach the GPU in an order that reuses post-transform results and draws
+// likely occluders first. All functions work on plain triangle lists with
+// 0-based indices; none of them change which triangles are drawn.
+//
+// Pipeline (see VulkanRenderer::addMesh):
+//   1. optimizeVertexCache  - Tipsify triangle order, returns its clusters
+//   2. optimizeOverdraw     - sorts those clusters front-to-back-ish
+//   3. optimizeVertexFetch  - renumbers vertices in order of first use
+
+// FIFO size the statistics and Tipsify model. Real post-transform caches
+// vary by vendor; 16 is a conservative middle that orders well for all.
+static const uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+  float acmr = 0.0f; // vertex shader runs per triangle (3 = no reuse)
+  float atvr = 0.0f; // vertex shader runs per referenced vertex (1 = ideal)
+};
+
+// Simulates a FIFO cache of cacheSize entries over the index stream
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount,
+                                    size_t vertexCount,
+                                    uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex
+// Locality and Reduced Overdraw", 2007). Reorders the triangles in place and
+// returns the first triangle of every cluster, i.e. each point where the
+// walk had to jump to a vertex that isn't in the cache any more.
+std::vector<uint32_t> optimizeVertexCache(uint32_t *indices, size_t indexCount,
+                                          size_t vertexCount,
+                                          uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders whole clusters (from optimizeVertexCache) so the ones facing away
+// from the mesh centre come first: on a mostly convex mesh those occlude the
+// rest. Triangle order inside a cluster is kept, so the cache efficiency of
+// the previous pass survives. positions points at the first vertex's xyz and
+// advances by positionStride bytes.
+void optimizeOverdraw(uint32_t *indices, size_t indexCount,
+                      const std::vector<uint32_t> &clusters,
+                      const float *positions, size_t positionStride,
+                      size_t vertexCount);
+
+// Renumbers vertices in the order the index buffer first uses them, so
+// vertex fetches walk memory forwards. Rewrites indices in place and fills
+// remap[old] = new (~0u for vertices no triangle uses). Returns the number
+// of vertices that are still referenced.
+size_t optimizeVertexFetch(uint32_t *indices, size_t indexCount,
+                           size_t vertexCount, std::vector<uint32_t> &remap);
+
+// Quadric error metric edge collapse (Garland and Heckbert, "Surface
+// Simplification Using Quadric Error Metrics", 1997), as index-only
+// half-edge collapses: every vertex stays where it is and the result indexes
+// the same vertex buffer, so LODs are just extra index ranges. Vertices on
+// an open edge in index space (mesh borders, and UV or normal seams, where
+// the triangles on either side use different vertices) are never moved.
+// Collapses run in cheapest-first passes until the index count drops to
+// targetIndexCount or nothing more can collapse without flipping a
+// triangle. resultError receives the largest deviation introduced, in the
+// units of the positions.
+std::vector<uint32_t> simplifyMesh(const uint32_t *indices, size_t indexCount,
+                                   const float *positions,
+                                   size_t positionStride, size_t vertexCount,
+                                   size_t targetIndexCount, float &resultError);
+
+// Meshlet limits, the sizes usually recommended for mesh shaders, so the same
+// clusters could feed one later
+static const uint32_t MESHLET_MAX_VERTICES = 64;
+static const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// A run of consecutive triangles in the index buffer, with bounds for
+// culling it as a whole
+struct Meshlet {
+  uint32_t indexOffset;   // first index of the run
+  uint32_t triangleCount;
+  uint32_t vertexCount;   // distinct vertices the run uses
+  float center[3];        // bounding sphere
+  float radius;
+  // Normal cone: every triangle's normal is within acos(sqrt(1 - cutoff^2))
+  // of coneAxis. A cutoff of 1 means the cone is too wide to cull.
+  float coneAxis[3];
+  float coneCutoff;
+};
+
+// Splits the triangle list into meshlets of at most maxVertices distinct
+// vertices and maxTriangles triangles. Triangles are taken in index order,
+// so the vertex cache and overdraw ordering of the earlier passes is kept and
+// each meshlet is one contiguous index range.
+std::vector<Meshlet> buildMeshlets(const uint32_t *indices, size_t indexCount,
+                                   const float *positions,
+                                   size_t positionStride, size_t vertexCount,
+                                   uint32_t maxVertices = MESHLET_MAX_VERTICES,
+                                   uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+// True when no triangle of the meshlet can face a camera at cameraPos (given
+// in the same space as the meshlet's positions)
+bool isMeshletBackfacing(const Meshlet &meshlet, const float cameraPos[3]);
+
+struct MeshOptimizerBenchmarkResult {
+  size_t vertexCount = 0;
+  size_t triangleCount = 0;
+  VertexCacheStats before; // source order
+  VertexCacheStats after;  // after all three passes
+  float cacheMs = 0.0f;    // average per run of each pass
+  float overdrawMs = 0.0f;
+  float fetchMs = 0.0f;
+};
+
+// Runs the whole pipeline `iterations` times on copies of the given mesh
+MeshOptimizerBenchmarkResult
+runMeshOptimizerBenchmark(const float *positions, size_t positionStride,
+                          size_t vertexCount, const uint32_t *indices,
+                          size_t indexCount, int iterations);
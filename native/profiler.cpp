@@ -0,0 +1,220 @@
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ProfileEvent {
+  const char *name;
+  uint64_t startNs;
+  uint64_t endNs;
+};
+
+// One per thread that has recorded a zone. Only the owning thread writes
+// events and head; the trace writer reads them concurrently.
+struct ThreadRing {
+  std::unique_ptr<ProfileEvent[]> events{
+      new ProfileEvent[PROFILER_RING_EVENTS]};
+  std::atomic<uint64_t> head{0}; // total events ever written
+  uint32_t threadId = 0;
+  std::string threadName;
+};
+
+struct OpenZone {
+  const char *name;
+  uint64_t startNs;
+};
+
+static const int MAX_OPEN_ZONES = 64;
+static const int MAX_NAMES = 4096;
+
+// Rings outlive their threads (TaskPool workers come and go on resize) so a
+// trace can still show what a finished thread did
+static std::mutex g_ringsMutex;
+static std::vector<std::unique_ptr<ThreadRing>> g_rings;
+
+static std::atomic<bool> g_enabled{false};
+static std::atomic<uint64_t> g_captureStartNs{0};
+
+static std::mutex g_namesMutex;
+static std::deque<std::string> g_nameStorage;
+static std::unordered_map<std::string, int> g_nameIds;
+static std::array<const char *, MAX_NAMES> g_names{};
+static std::atomic<int> g_nameCount{0};
+
+static thread_local ThreadRing *t_ring = nullptr;
+static thread_local OpenZone t_openZones[MAX_OPEN_ZONES];
+static thread_local int t_openZoneCount = 0;
+
+static ThreadRing &threadRing() {
+  if (!t_ring) {
+    auto ring = std::make_unique<ThreadRing>();
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+    ring->threadId = static_cast<uint32_t>(g_rings.size() + 1);
+    t_ring = ring.get();
+    g_rings.push_back(std::move(ring));
+  }
+  return *t_ring;
+}
+
+static void writeJsonString(FILE *file, const char *text) {
+  fputc('"', file);
+  for (const char *p = text; *p; p++) {
+    unsigned char c = static_cast<unsigned char>(*p);
+    if (c == '"' || c == '\\')
+      fprintf(file, "\\%c", c);
+    else if (c < 0x20)
+      fprintf(file, "\\u%04x", c);
+    else
+      fputc(c, file);
+  }
+  fputc('"', file);
+}
+
+void profilerSetEnabled(bool enabled) {
+  if (enabled && !g_enabled.load(std::memory_order_relaxed))
+    g_captureStartNs.store(profilerNowNs(), std::memory_order_relaxed);
+  g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool profilerIsEnabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+uint64_t profilerNowNs() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+void profilerRecord(const char *name, uint64_t startNs, uint64_t endNs) {
+  if (!profilerIsEnabled())
+    return;
+  ThreadRing &ring = threadRing();
+  uint64_t head = ring.head.load(std::memory_order_relaxed);
+  ring.events[head % PROFILER_RING_EVENTS] = {name, startNs, endNs};
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+void profilerSetThreadName(const char *name) {
+  ThreadRing &ring = threadRing();
+  std::lock_guard<std::mutex> lock(g_ringsMutex);
+  ring.threadName = name;
+}
+
+int profilerInternName(const char *name) {
+  std::lock_guard<std::mutex> lock(g_namesMutex);
+  auto it = g_nameIds.find(name);
+  if (it != g_nameIds.end())
+    return it->second;
+  int id = g_nameCount.load(std::memory_order_relaxed);
+  if (id >= MAX_NAMES)
+    return -1;
+  g_nameStorage.emplace_back(name);
+  g_names[id] = g_nameStorage.back().c_str();
+  g_nameIds.emplace(g_nameStorage.back(), id);
+  g_nameCount.store(id + 1, std::memory_order_release);
+  return id;
+}
+
+// Zones begun while recording was off (or with a bad id) still take a stack
+// slot, so begin/end stay paired when recording toggles mid-zone
+void profilerBeginZone(int nameId) {
+  if (t_openZoneCount >= MAX_OPEN_ZONES) {
+    t_openZoneCount++;
+    return;
+  }
+  const char *name = nullptr;
+  if (nameId >= 0 && nameId < g_nameCount.load(std::memory_order_acquire))
+    name = g_names[nameId];
+  t_openZones[t_openZoneCount++] = {
+      name, name && profilerIsEnabled() ? profilerNowNs() : 0};
+}
+
+void profilerEndZone() {
+  if (t_openZoneCount == 0)
+    return;
+  t_openZoneCount--;
+  if (t_openZoneCount >= MAX_OPEN_ZONES)
+    return;
+  const OpenZone &zone = t_openZones[t_openZoneCount];
+  if (zone.startNs)
+    profilerRecord(zone.name, zone.startNs, profilerNowNs());
+}
+
+bool profilerWriteChromeTrace(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (!file)
+    return false;
+
+  uint64_t captureStart = g_captureStartNs.load(std::memory_order_relaxed);
+  std::vector<ProfileEvent> events;
+  bool first = true;
+  fprintf(file, "{\"traceEvents\":[\n");
+
+  std::lock_guard<std::mutex> lock(g_ringsMutex);
+  for (const auto &ring : g_rings) {
+    // Copy the live window, then drop whatever the owner may have
+    // overwritten while we were copying
+    uint64_t end = ring->head.load(std::memory_order_acquire);
+    uint64_t begin =
+        end > PROFILER_RING_EVENTS ? end - PROFILER_RING_EVENTS : 0;
+    events.clear();
+    for (uint64_t i = begin; i < end; i++)
+      events.push_back(ring->events[i % PROFILER_RING_EVENTS]);
+    uint64_t after = ring->head.load(std::memory_order_acquire);
+    size_t overwritten = 0;
+    if (after > PROFILER_RING_EVENTS && after - PROFILER_RING_EVENTS > begin)
+      overwritten = static_cast<size_t>(std::min<uint64_t>(
+          after - PROFILER_RING_EVENTS - begin, events.size()));
+
+    if (!ring->threadName.empty()) {
+      fprintf(file,
+              "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+              "\"tid\":%u,\"args\":{\"name\":",
+              first ? "" : ",\n", ring->threadId);
+      writeJsonString(file, ring->threadName.c_str());
+      fprintf(file, "}}");
+      first = false;
+    }
+
+    for (size_t i = overwritten; i < events.size(); i++) {
+      const ProfileEvent &event = events[i];
+      if (event.startNs < captureStart)
+        continue;
+      fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+      writeJsonString(file, event.name);
+      fprintf(file,
+              ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+              ring->threadId, (event.startNs - captureStart) / 1000.0,
+              (event.endNs - event.startNs) / 1000.0);
+      first = false;
+    }
+  }
+
+  fprintf(file, "\n]}\n");
+  return fclose(file) == 0;
+}
+
+#else
+
+void profilerSetEnabled(bool) {}
+bool profilerIsEnabled() { return false; }
+uint64_t profilerNowNs() { return 0; }
+void profilerRecord(const char *, uint64_t, uint64_t) {}
+void profilerSetThreadName(const char *) {}
+int profilerInternName(const char *) { return -1; }
+void profilerBeginZone(int) {}
+void profilerEndZone() {}
+bool profilerWriteChromeTrace(const char *) { return false; }
+
+#endif
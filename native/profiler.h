@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+// Scoped CPU zones for finding where frame time goes. Each thread records
+// completed zones into its own fixed-size ring (single writer, no locks on
+// the hot path); profilerWriteChromeTrace() merges the rings into a Chrome
+// trace JSON file for chrome://tracing or ui.perfetto.dev.
+//
+// Everything compiles out unless ENABLE_PROFILER is defined (CMake option
+// ENABLE_PROFILER, `make PROFILE=1`). The functions below still exist in that
+// case so the bridge links, but they do nothing.
+//
+// Zones are only kept while recording is enabled. Each ring holds the most
+// recent PROFILER_RING_EVENTS zones of its thread, so long captures keep the
+// tail end.
+
+static const uint32_t PROFILER_RING_EVENTS = 1u << 16;
+
+// Zone names must outlive the profiler (string literals, or the result of
+// profilerInternName)
+void profilerSetEnabled(bool enabled);
+bool profilerIsEnabled();
+uint64_t profilerNowNs();
+void profilerRecord(const char *name, uint64_t startNs, uint64_t endNs);
+// Shown as the thread's name in the trace; call once from the thread itself
+void profilerSetThreadName(const char *name);
+
+// Returns a stable id for `name` (same name, same id), or -1 if the name
+// table is full. Zones begun by id are for callers that can't use RAII, such
+// as the C# bridge; they nest per thread and must be ended in LIFO order.
+int profilerInternName(const char *name);
+void profilerBeginZone(int nameId);
+void profilerEndZone();
+
+// Writes every zone recorded since recording was last enabled. Safe to call
+// while other threads are recording; zones that get overwritten during the
+// copy are dropped. Returns false if the file can't be written or the
+// profiler is compiled out.
+bool profilerWriteChromeTrace(const char *path);
+
+#ifdef ENABLE_PROFILER
+
+class ProfileZone {
+public:
+  explicit ProfileZone(const char *name)
+      : name_(name), startNs_(profilerIsEnabled() ? profilerNowNs() : 0) {}
+  ~ProfileZone() {
+    if (startNs_)
+      profilerRecord(name_, startNs_, profilerNowNs());
+  }
+  ProfileZone(const ProfileZone &) = delete;
+  ProfileZone &operator=(const ProfileZone &) = delete;
+
+private:
+  const char *name_;
+  uint64_t startNs_;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name)                                                     \
+  ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#define PROFILE_THREAD_NAME(name) profilerSetThreadName(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+
+#endif
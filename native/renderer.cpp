@@ -8,13 +8,17 @@
 #include "vendor/stb_image.h"
 
 #include "renderer.h"
+#include "profiler.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <set>
@@ -31,6 +35,442 @@ static void checkVk(VkResult result, const char *msg) {
   }
 }
 
+// Pipeline statistics queried over the render pass. Results come back in bit
+// order: vertex invocations, clipping primitives, fragment invocations.
+static const VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+static const char *presentModeName(PresentMode mode) {
+  switch (mode) {
+  case PRESENT_MODE_FIFO:
+    return "FIFO";
+  case PRESENT_MODE_MAILBOX:
+    return "MAILBOX";
+  case PRESENT_MODE_IMMEDIATE:
+    return "IMMEDIATE";
+  default:
+    return "unknown";
+  }
+}
+
+// Box-filters an sRGB RGBA8 image down the mip chain. Returns every level
+// tightly packed, base level first. Color is averaged in linear space so
+// distant textures don't darken; alpha is averaged as stored.
+static std::vector<uint8_t> buildMipChain(const uint8_t *pixels,
+                                          uint32_t width, uint32_t height,
+                                          uint32_t mipLevels) {
+  static const std::array<float, 256> toLinear = [] {
+    std::array<float, 256> table{};
+    for (int i = 0; i < 256; i++) {
+      float c = i / 255.0f;
+      table[i] = c <= 0.04045f ? c / 12.92f
+                               : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    return table;
+  }();
+  auto toSrgb = [](float linear) {
+    float c = linear <= 0.0031308f
+                  ? linear * 12.92f
+                  : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+  };
+
+  size_t total = 0;
+  for (uint32_t level = 0, w = width, h = height; level < mipLevels; level++) {
+    total += static_cast<size_t>(w) * h * 4;
+    w = std::max(w / 2, 1u);
+    h = std::max(h / 2, 1u);
+  }
+  std::vector<uint8_t> chain(total);
+  memcpy(chain.data(), pixels, static_cast<size_t>(width) * height * 4);
+
+  size_t srcOffset = 0;
+  size_t dstOffset = static_cast<size_t>(width) * height * 4;
+  uint32_t srcW = width, srcH = height;
+  for (uint32_t level = 1; level < mipLevels; level++) {
+    uint32_t dstW = std::max(srcW / 2, 1u);
+    uint32_t dstH = std::max(srcH / 2, 1u);
+    const uint8_t *src = chain.data() + srcOffset;
+    uint8_t *dst = chain.data() + dstOffset;
+    for (uint32_t y = 0; y < dstH; y++) {
+      size_t y0 = std::min(y * 2, srcH - 1);
+      size_t y1 = std::min(y * 2 + 1, srcH - 1);
+      const uint8_t *row0 = src + y0 * srcW * 4;
+      const uint8_t *row1 = src + y1 * srcW * 4;
+      for (uint32_t x = 0; x < dstW; x++) {
+        uint32_t x0 = std::min(x * 2, srcW - 1) * 4;
+        uint32_t x1 = std::min(x * 2 + 1, srcW - 1) * 4;
+        uint8_t *out = dst + (static_cast<size_t>(y) * dstW + x) * 4;
+        for (int c = 0; c < 3; c++)
+          out[c] = toSrgb((toLinear[row0[x0 + c]] + toLinear[row0[x1 + c]] +
+                           toLinear[row1[x0 + c]] + toLinear[row1[x1 + c]]) *
+                          0.25f);
+        out[3] = static_cast<uint8_t>(
+            (row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) /
+            4);
+      }
+    }
+    srcOffset = dstOffset;
+    dstOffset += static_cast<size_t>(dstW) * dstH * 4;
+    srcW = dstW;
+    srcH = dstH;
+  }
+  return chain;
+}
+
+// FNV-1a; chained through `hash` to fold several inputs into one key
+static uint64_t hashBytes(const void *data, size_t size,
+                          uint64_t hash = 14695981039346656037ull) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// MurmurHash3-style block hash, eight bytes at a time. Shares nothing with
+// FNV-1a, so it can confirm a hashBytes match.
+static uint64_t hashBytesMix(const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+  auto mixBlock = [&](uint64_t k, uint64_t h) {
+    k *= 0x87c37b91114253d5ull;
+    k = rotl(k, 31);
+    k *= 0x4cf5ad432745937full;
+    h ^= k;
+    return rotl(h, 27) * 5 + 0x52dce729;
+  };
+  uint64_t hash = size;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t block;
+    memcpy(&block, bytes + i, sizeof(block));
+    hash = mixBlock(block, hash);
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, bytes + i, size - i);
+  hash = mixBlock(tail, hash);
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// Octahedral normal encoding: project onto the L1 unit octahedron and fold
+// the lower hemisphere over the upper one. Decoded by octDecode() in
+// shader.vert.
+static glm::vec2 octEncode(glm::vec3 n) {
+  float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+  if (l1 == 0.0f)
+    return glm::vec2(0.0f, 1.0f);
+  glm::vec2 p(n.x / l1, n.y / l1);
+  if (n.z < 0.0f) {
+    glm::vec2 folded((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                     (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+    p = folded;
+  }
+  return p;
+}
+
+PackedVertex PackedVertex::pack(const Vertex &v) {
+  PackedVertex packed;
+  packed.pos = v.pos;
+  packed.normal = glm::packSnorm2x16(octEncode(v.normal));
+  packed.color = glm::packUnorm4x8(glm::vec4(v.color, 1.0f));
+  packed.uv = glm::packHalf2x16(v.uv);
+  return packed;
+}
+
+// Parses a .gltf/.glb and loads its buffers; nullptr (after logging) on
+// failure. Free the result with cgltf_free.
+static cgltf_data *parseGltf(const char *path) {
+  cgltf_options options = {};
+  cgltf_data *data = nullptr;
+  cgltf_result result = cgltf_parse_file(&options, path, &data);
+  if (result != cgltf_result_success) {
+    std::cerr << "Failed to parse glTF: " << path << std::endl;
+    return nullptr;
+  }
+
+  result = cgltf_load_buffers(&options, data, path);
+  if (result != cgltf_result_success) {
+    std::cerr << "Failed to load glTF buffers" << std::endl;
+    cgltf_free(data);
+    return nullptr;
+  }
+  return data;
+}
+
+// Appends every triangle primitive of every mesh in the file as one mesh
+// (0-based indices), colored by each primitive's base color factor
+static void readGltfGeometry(const cgltf_data *data,
+                             std::vector<Vertex> &vertices,
+                             std::vector<uint32_t> &indices) {
+  for (cgltf_size mi = 0; mi < data->meshes_count; mi++) {
+    const cgltf_mesh &mesh = data->meshes[mi];
+    for (cgltf_size pi = 0; pi < mesh.primitives_count; pi++) {
+      const cgltf_primitive &prim = mesh.primitives[pi];
+      if (prim.type != cgltf_primitive_type_triangles)
+        continue;
+
+      uint32_t vertexOffset = static_cast<uint32_t>(vertices.size());
+
+      cgltf_accessor *posAccessor = nullptr;
+      cgltf_accessor *normAccessor = nullptr;
+      cgltf_accessor *uvAccessor = nullptr;
+      for (cgltf_size ai = 0; ai < prim.attributes_count; ai++) {
+        if (prim.attributes[ai].type == cgltf_attribute_type_position)
+          posAccessor = prim.attributes[ai].data;
+        else if (prim.attributes[ai].type == cgltf_attribute_type_normal)
+          normAccessor = prim.attributes[ai].data;
+        else if (prim.attributes[ai].type == cgltf_attribute_type_texcoord)
+          uvAccessor = prim.attributes[ai].data;
+      }
+
+      if (!posAccessor)
+        continue;
+
+      glm::vec3 baseColor(0.7f, 0.7f, 0.8f);
+      if (prim.material && prim.material->has_pbr_metallic_roughness) {
+        const float *c = prim.material->pbr_metallic_roughness.base_color_factor;
+        baseColor = glm::vec3(c[0], c[1], c[2]);
+      }
+
+      for (cgltf_size vi = 0; vi < posAccessor->count; vi++) {
+        Vertex v{};
+        cgltf_accessor_read_float(posAccessor, vi, &v.pos.x, 3);
+        if (normAccessor)
+          cgltf_accessor_read_float(normAccessor, vi, &v.normal.x, 3);
+        else
+          v.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        v.color = baseColor;
+        if (uvAccessor)
+          cgltf_accessor_read_float(uvAccessor, vi, &v.uv.x, 2);
+        else
+          v.uv = glm::vec2(0.0f, 0.0f);
+        vertices.push_back(v);
+      }
+
+      if (prim.indices) {
+        for (cgltf_size ii = 0; ii < prim.indices->count; ii++) {
+          uint32_t idx = static_cast<uint32_t>(
+              cgltf_accessor_read_index(prim.indices, ii));
+          indices.push_back(vertexOffset + idx);
+        }
+      } else {
+        for (uint32_t vi = 0; vi < static_cast<uint32_t>(posAccessor->count);
+             vi++)
+          indices.push_back(vertexOffset + vi);
+      }
+    }
+  }
+}
+
+// Welding key: a vertex's attributes as raw float bits (epsilon 0, with -0
+// folded into +0) or snapped to a grid of epsilon-sized cells
+using WeldKey = std::array<int64_t, 11>;
+
+// FNV-1a a word at a time, with a final mix so the low bits (used for the
+// partition and table slot) depend on every word
+static uint64_t hashWeldKey(const WeldKey &key) {
+  uint64_t hash = 14695981039346656037ull;
+  for (int64_t word : key) {
+    hash ^= static_cast<uint64_t>(word);
+    hash *= 1099511628211ull;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+static WeldKey makeWeldKey(const Vertex &v, float epsilon) {
+  const float values[11] = {v.pos.x,    v.pos.y,    v.pos.z,   v.normal.x,
+                            v.normal.y, v.normal.z, v.color.x, v.color.y,
+                            v.color.z,  v.uv.x,     v.uv.y};
+  WeldKey key;
+  for (size_t i = 0; i < key.size(); i++) {
+    if (epsilon > 0.0f) {
+      double cell = std::floor(static_cast<double>(values[i]) / epsilon);
+      key[i] = static_cast<int64_t>(std::clamp(cell, -9.0e18, 9.0e18));
+    } else {
+      float value = values[i] + 0.0f;
+      uint32_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      key[i] = bits;
+    }
+  }
+  return key;
+}
+
+// Meshes at least this big are welded on the mesh worker threads
+static const size_t WELD_PARALLEL_MIN_VERTICES = 1 << 16;
+
+// Smaller meshes keep their single instanced draw: culling a few meshlets
+// wouldn't pay for drawing every instance separately
+static const size_t MESHLET_MIN_TRIANGLES = 1024;
+
+// Depth range of the camera projection; the light clusters span the same
+static const float CAMERA_NEAR = 0.1f;
+static const float CAMERA_FAR = 100.0f;
+
+// Merges vertices with equal keys into the first of them and remaps the
+// indices (which must all be in range). Vertices are split into one hash
+// partition per task, so each task owns its map and the result doesn't
+// depend on the thread count. Returns the unique vertex count.
+static size_t weldVertices(std::vector<Vertex> &vertices,
+                           std::vector<uint32_t> &indices, float epsilon,
+                           TaskPool &pool) {
+  size_t vertexCount = vertices.size();
+  int taskCount = vertexCount >= WELD_PARALLEL_MIN_VERTICES
+                      ? pool.getWorkerCount() + 1
+                      : 1;
+  auto forEachTask = [&](const std::function<void(int)> &task) {
+    if (taskCount == 1)
+      task(0);
+    else
+      pool.parallelFor(taskCount, [&](int taskIndex, int) { task(taskIndex); });
+  };
+  auto taskRange = [&](int taskIndex, size_t count) {
+    return std::make_pair(count * taskIndex / taskCount,
+                          count * (taskIndex + 1) / taskCount);
+  };
+
+  std::vector<WeldKey> keys(vertexCount);
+  std::vector<uint64_t> hashes(vertexCount);
+  forEachTask([&](int taskIndex) {
+    auto [begin, end] = taskRange(taskIndex, vertexCount);
+    for (size_t v = begin; v < end; v++) {
+      keys[v] = makeWeldKey(vertices[v], epsilon);
+      hashes[v] = hashWeldKey(keys[v]);
+    }
+  });
+
+  // canonical[v] = first vertex with the same key (v itself if unique).
+  // Each partition gets an open-addressed table of vertex indices, so
+  // nothing is allocated per vertex.
+  std::vector<uint32_t> canonical(vertexCount);
+  forEachTask([&](int taskIndex) {
+    auto inPartition = [&](size_t v) {
+      return static_cast<int>(hashes[v] % taskCount) == taskIndex;
+    };
+    size_t partitionSize = 0;
+    for (size_t v = 0; v < vertexCount; v++)
+      partitionSize += inPartition(v) ? 1 : 0;
+    size_t capacity = 1;
+    while (capacity < partitionSize * 2)
+      capacity <<= 1;
+    std::vector<uint32_t> table(capacity, ~0u);
+
+    for (size_t v = 0; v < vertexCount; v++) {
+      if (!inPartition(v))
+        continue;
+      size_t slot = (hashes[v] / taskCount) & (capacity - 1);
+      while (true) {
+        uint32_t entry = table[slot];
+        if (entry == ~0u) {
+          table[slot] = static_cast<uint32_t>(v);
+          canonical[v] = static_cast<uint32_t>(v);
+          break;
+        }
+        if (hashes[entry] == hashes[v] && keys[entry] == keys[v]) {
+          canonical[v] = entry;
+          break;
+        }
+        slot = (slot + 1) & (capacity - 1);
+      }
+    }
+  });
+
+  std::vector<uint32_t> remap(vertexCount);
+  uint32_t uniqueCount = 0;
+  for (size_t v = 0; v < vertexCount; v++)
+    remap[v] = canonical[v] == v ? uniqueCount++ : remap[canonical[v]];
+  if (uniqueCount == vertexCount)
+    return vertexCount;
+
+  // remap[v] <= v, so compacting in place never overwrites a vertex that
+  // is still to be moved
+  for (size_t v = 0; v < vertexCount; v++) {
+    if (canonical[v] == v)
+      vertices[remap[v]] = vertices[v];
+  }
+  vertices.resize(uniqueCount);
+  forEachTask([&](int taskIndex) {
+    auto [begin, end] = taskRange(taskIndex, indices.size());
+    for (size_t i = begin; i < end; i++)
+      indices[i] = remap[indices[i]];
+  });
+  return uniqueCount;
+}
+
+// Reorders a mesh for the post-transform cache and overdraw, then renumbers
+// its vertices by first use (see mesh_optimizer.h). The indices must be an
+// in-range triangle list.
+static void optimizeMeshOrder(std::vector<Vertex> &vertices,
+                              std::vector<uint32_t> &indices,
+                              VertexCacheStats &before,
+                              VertexCacheStats &after) {
+  before = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+  std::vector<uint32_t> clusters =
+      optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+  optimizeOverdraw(indices.data(), indices.size(), clusters,
+                   &vertices[0].pos.x, sizeof(Vertex), vertices.size());
+  after = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+  std::vector<uint32_t> remap;
+  size_t usedCount = optimizeVertexFetch(indices.data(), indices.size(),
+                                         vertices.size(), remap);
+  std::vector<Vertex> reordered(usedCount);
+  for (size_t i = 0; i < vertices.size(); i++) {
+    if (remap[i] != ~0u)
+      reordered[remap[i]] = vertices[i];
+  }
+  vertices.swap(reordered);
+}
+
+static uint64_t makeSortKey(uint32_t pipeline, uint32_t material,
+                            uint32_t mesh, uint32_t lod, float depth) {
+  // Non-negative floats order the same as their bit patterns
+  uint32_t depthBits;
+  depth = std::max(depth, 0.0f);
+  memcpy(&depthBits, &depth, sizeof(depthBits));
+  return (static_cast<uint64_t>(pipeline & 0x3u) << 62) |
+         (static_cast<uint64_t>(material & 0x3FFFu) << 48) |
+         (static_cast<uint64_t>(mesh & 0x3FFFu) << 34) |
+         (static_cast<uint64_t>(lod & 0x3u) << 32) | depthBits;
+}
+
+// LSD radix sort on the 64-bit key, one byte per pass. Passes where every key
+// shares the same byte (e.g. pipeline/material with few materials) are
+// skipped. Stable, so equal keys keep their insertion order.
+static void radixSortDrawItems(std::vector<DrawItem> &items,
+                               std::vector<DrawItem> &scratch) {
+  scratch.resize(items.size());
+  for (int shift = 0; shift < 64; shift += 8) {
+    uint32_t counts[256] = {};
+    for (const auto &item : items)
+      counts[(item.sortKey >> shift) & 0xFF]++;
+    if (counts[(items.front().sortKey >> shift) & 0xFF] == items.size())
+      continue;
+
+    uint32_t offset = 0;
+    for (auto &count : counts) {
+      uint32_t c = count;
+      count = offset;
+      offset += c;
+    }
+    for (const auto &item : items)
+      scratch[counts[(item.sortKey >> shift) & 0xFF]++] = item;
+    items.swap(scratch);
+  }
+}
+
 void VulkanRenderer::framebufferResizeCallback(GLFWwindow *window, int /*w*/,
                                                int /*h*/) {
   auto *app =
@@ -80,21 +520,48 @@ bool VulkanRenderer::init(int width, int height, const char *title) {
   glfwSetFramebufferSizeCallback(window_, framebufferResizeCallback);
   glfwSetScrollCallback(window_, scrollCallback);
 
+  return initVulkan();
+}
+
+bool VulkanRenderer::initHeadless(int width, int height) {
+  width_ = width;
+  height_ = height;
+  headless_ = true;
+  return initVulkan();
+}
+
+bool VulkanRenderer::initVulkan() {
+  PROFILE_THREAD_NAME("main");
   try {
     createInstance();
-    createSurface();
+    if (!headless_)
+      createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
-    createSwapchain();
-    createImageViews();
+    memoryAllocator_.init(physicalDevice_, device_);
+    if (headless_) {
+      createOffscreenTargets();
+    } else {
+      createSwapchain();
+      createImageViews();
+    }
     createRenderPass();
     createDescriptorSetLayout();
     createMaterialDescriptorSetLayout();
+    createPipelineCache();
+    auto pipelineStart = std::chrono::steady_clock::now();
     createGraphicsPipeline();
+    createCullPipeline();
+    pipelineBuildMs_ += std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - pipelineStart)
+                            .count();
     createCommandPool();
+    createStagingRing(STAGING_RING_BYTES);
     createDepthResources();
     createFramebuffers();
     createUniformBuffers();
+    createInstanceBuffers();
+    createGpuCullBuffers();
     createDescriptorPool();
     createDescriptorSets();
     createTextureSampler();
@@ -102,15 +569,31 @@ bool VulkanRenderer::init(int width, int height, const char *title) {
     createMaterialDescriptorPool();
     defaultMaterialId_ = createMaterial(defaultTextureView_);
     createCommandBuffers();
+    createRecordContexts();
     createSyncObjects();
+    createQueryPools();
+    retiredBuffers_.resize(framesInFlight_);
+    uploadSemaphoresInUse_.resize(framesInFlight_);
 
     // UI overlay pipeline
     createUIDescriptorSetLayout();
+    pipelineStart = std::chrono::steady_clock::now();
     createUIPipeline();
+    pipelineBuildMs_ += std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - pipelineStart)
+                            .count();
+    std::cout << "Pipelines built in " << pipelineBuildMs_ << " ms ("
+              << (pipelineCacheWarm_ ? "warm" : "cold") << " cache)"
+              << std::endl;
     createUIVertexBuffers();
     createFontResources();
     createUIDescriptorPool();
     createUIDescriptorSets();
+
+    // Default texture and font atlas must have landed before the first frame
+    // acquires them, since they are the fallbacks for everything else
+    submitUploads();
+    waitForUploads();
   } catch (const std::exception &e) {
     std::cerr << "Vulkan init failed: " << e.what() << std::endl;
     return false;
@@ -122,18 +605,48 @@ void VulkanRenderer::cleanup() {
   if (device_)
     vkDeviceWaitIdle(device_);
 
+  recordPool_.resize(0);
+  meshPool_.resize(0);
+  destroyRecordContexts();
+  destroyUploadBatches();
+  destroyStagingRing();
+  destroyReadbackBuffers();
+  destroyQueryPools();
   cleanupUIResources();
   cleanupMaterialResources();
   cleanupSwapchain();
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < static_cast<size_t>(framesInFlight_); i++) {
     if (uniformBuffers_.size() > i) {
       vkDestroyBuffer(device_, uniformBuffers_[i], nullptr);
-      vkFreeMemory(device_, uniformBuffersMemory_[i], nullptr);
+      memoryAllocator_.free(uniformBuffersMemory_[i]);
     }
     if (lightBuffers_.size() > i) {
       vkDestroyBuffer(device_, lightBuffers_[i], nullptr);
-      vkFreeMemory(device_, lightBuffersMemory_[i], nullptr);
+      memoryAllocator_.free(lightBuffersMemory_[i]);
+    }
+    if (lightStorageBuffers_.size() > i)
+      destroyMappedBuffer(lightStorageBuffers_[i],
+                          lightStorageBuffersMemory_[i],
+                          lightStorageBuffersMapped_[i]);
+    if (clusterBuffers_.size() > i)
+      destroyMappedBuffer(clusterBuffers_[i], clusterBuffersMemory_[i],
+                          clusterBuffersMapped_[i]);
+    if (instanceBuffers_.size() > i) {
+      vkDestroyBuffer(device_, instanceBuffers_[i], nullptr);
+      memoryAllocator_.free(instanceBuffersMemory_[i]);
+    }
+    if (meshletCommandBuffers_.size() > i)
+      destroyMappedBuffer(meshletCommandBuffers_[i],
+                          meshletCommandBuffersMemory_[i],
+                          meshletCommandBuffersMapped_[i]);
+    if (gpuEntityBuffers_.size() > i) {
+      destroyMappedBuffer(gpuEntityBuffers_[i], gpuEntityBuffersMemory_[i],
+                          gpuEntityBuffersMapped_[i]);
+      destroyMappedBuffer(gpuMeshBuffers_[i], gpuMeshBuffersMemory_[i],
+                          gpuMeshBuffersMapped_[i]);
+      destroyMappedBuffer(indirectBuffers_[i], indirectBuffersMemory_[i],
+                          indirectBuffersMapped_[i]);
     }
     if (imageAvailableSemaphores_.size() > i)
       vkDestroySemaphore(device_, imageAvailableSemaphores_[i], nullptr);
@@ -143,19 +656,26 @@ void VulkanRenderer::cleanup() {
       vkDestroyFence(device_, inFlightFences_[i], nullptr);
   }
 
-  if (indexBuffer_)
-    vkDestroyBuffer(device_, indexBuffer_, nullptr);
-  if (indexBufferMemory_)
-    vkFreeMemory(device_, indexBufferMemory_, nullptr);
-  if (vertexBuffer_)
-    vkDestroyBuffer(device_, vertexBuffer_, nullptr);
-  if (vertexBufferMemory_)
-    vkFreeMemory(device_, vertexBufferMemory_, nullptr);
+  destroyGeometryArena(indexArena_);
+  destroyGeometryArena(vertexArena_);
+  meshAssets_.clear();
+  currentMeshAssets_.clear();
+  for (uint32_t i = 0; i < retiredBuffers_.size(); i++)
+    releaseRetiredBuffers(i);
+  destroyMappedBuffer(gpuLodStateBuffer_, gpuLodStateMemory_,
+                      gpuLodStateMapped_);
+  gpuLodStateCapacity_ = 0;
 
   if (descriptorPool_)
     vkDestroyDescriptorPool(device_, descriptorPool_, nullptr);
   if (descriptorSetLayout_)
     vkDestroyDescriptorSetLayout(device_, descriptorSetLayout_, nullptr);
+  if (cullPipeline_)
+    vkDestroyPipeline(device_, cullPipeline_, nullptr);
+  if (cullPipelineLayout_)
+    vkDestroyPipelineLayout(device_, cullPipelineLayout_, nullptr);
+  if (cullDescriptorSetLayout_)
+    vkDestroyDescriptorSetLayout(device_, cullDescriptorSetLayout_, nullptr);
   if (debugPipeline_)
     vkDestroyPipeline(device_, debugPipeline_, nullptr);
   if (graphicsPipeline_)
@@ -164,8 +684,15 @@ void VulkanRenderer::cleanup() {
     vkDestroyPipelineLayout(device_, pipelineLayout_, nullptr);
   if (renderPass_)
     vkDestroyRenderPass(device_, renderPass_, nullptr);
+  if (pipelineCache_) {
+    savePipelineCache();
+    vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
+  }
+  if (uploadCommandPool_)
+    vkDestroyCommandPool(device_, uploadCommandPool_, nullptr);
   if (commandPool_)
     vkDestroyCommandPool(device_, commandPool_, nullptr);
+  memoryAllocator_.destroy();
   if (device_)
     vkDestroyDevice(device_, nullptr);
   if (surface_)
@@ -175,91 +702,105 @@ void VulkanRenderer::cleanup() {
 
   if (window_)
     glfwDestroyWindow(window_);
-  glfwTerminate();
+  if (!headless_)
+    glfwTerminate();
 }
 
 // ---------------------------------------------------------------------------
 // Multi-entity API
 // ---------------------------------------------------------------------------
 
+// Hot reload re-runs Game.Setup, so the same paths come through here on
+// every code change; unchanged files cost a stat() instead of a re-parse and
+// re-upload. Only the glTF/GLB's own mtime is checked, not external buffers
+// or images it references.
 int VulkanRenderer::loadMesh(const char *path) {
-  cgltf_options options = {};
-  cgltf_data *data = nullptr;
-  cgltf_result result = cgltf_parse_file(&options, path, &data);
-  if (result != cgltf_result_success) {
-    std::cerr << "Failed to parse glTF: " << path << std::endl;
-    return -1;
+  std::error_code ec;
+  std::filesystem::path canonical = std::filesystem::canonical(path, ec);
+  if (ec)
+    return loadMeshFile(path); // reports the error
+  auto mtime = std::filesystem::last_write_time(canonical, ec);
+  std::string key = canonical.string();
+  MeshImportSettings settings{meshOptimization_, meshLods_, weldEpsilon_,
+                              textureMipmaps_};
+
+  auto current = currentMeshAssets_.find(key);
+  if (current != currentMeshAssets_.end() && !ec) {
+    MeshAsset &asset = meshAssets_[current->second];
+    if (asset.mtime == mtime && asset.settings == settings) {
+      asset.refCount++;
+      return asset.meshId;
+    }
   }
 
-  result = cgltf_load_buffers(&options, data, path);
-  if (result != cgltf_result_success) {
-    std::cerr << "Failed to load glTF buffers" << std::endl;
-    cgltf_free(data);
+  int meshId = loadMeshFile(path);
+  if (meshId < 0)
+    return meshId;
+  if (current != currentMeshAssets_.end())
+    std::cout << "Reloaded changed asset " << key << " as mesh " << meshId
+              << " (mesh " << current->second << " stays resident)"
+              << std::endl;
+  // A failed stat leaves mtime unset, so the next load re-reads the file
+  meshAssets_[meshId] = {key, meshId, ec ? decltype(mtime){} : mtime, settings,
+                         1};
+  currentMeshAssets_[key] = meshId;
+  return meshId;
+}
+
+void VulkanRenderer::releaseMesh(int meshId) {
+  auto it = meshAssets_.find(meshId);
+  if (it != meshAssets_.end() && it->second.refCount > 0)
+    it->second.refCount--;
+}
+
+int VulkanRenderer::getMeshRefCount(int meshId) const {
+  auto it = meshAssets_.find(meshId);
+  if (it == meshAssets_.end())
+    return -1;
+  return static_cast<int>(it->second.refCount);
+}
+
+int VulkanRenderer::loadMeshFile(const char *path) {
+  cgltf_data *data = parseGltf(path);
+  if (!data)
     return -1;
-  }
 
   // Temporary buffers for this mesh (0-based indices)
   std::vector<Vertex> meshVertices;
   std::vector<uint32_t> meshIndices;
+  readGltfGeometry(data, meshVertices, meshIndices);
+
+  // Embedded (GLB buffer view) or external (URI relative to the glTF path).
+  // KTX2 data is recognised by its header, whatever the URI or MIME type.
+  auto loadImage = [&](const cgltf_image *image) {
+    if (image->buffer_view && image->buffer_view->buffer) {
+      const uint8_t *texData = reinterpret_cast<const uint8_t *>(
+                                   image->buffer_view->buffer->data) +
+                               image->buffer_view->offset;
+      size_t texSize = image->buffer_view->size;
+      return loadTextureFromMemory(texData, texSize);
+    }
+    if (!image->uri)
+      return defaultMaterialId_;
 
-  for (cgltf_size mi = 0; mi < data->meshes_count; mi++) {
-    cgltf_mesh &mesh = data->meshes[mi];
-    for (cgltf_size pi = 0; pi < mesh.primitives_count; pi++) {
-      cgltf_primitive &prim = mesh.primitives[pi];
-      if (prim.type != cgltf_primitive_type_triangles)
-        continue;
-
-      uint32_t vertexOffset = static_cast<uint32_t>(meshVertices.size());
-
-      cgltf_accessor *posAccessor = nullptr;
-      cgltf_accessor *normAccessor = nullptr;
-      cgltf_accessor *uvAccessor = nullptr;
-      for (cgltf_size ai = 0; ai < prim.attributes_count; ai++) {
-        if (prim.attributes[ai].type == cgltf_attribute_type_position)
-          posAccessor = prim.attributes[ai].data;
-        else if (prim.attributes[ai].type == cgltf_attribute_type_normal)
-          normAccessor = prim.attributes[ai].data;
-        else if (prim.attributes[ai].type == cgltf_attribute_type_texcoord)
-          uvAccessor = prim.attributes[ai].data;
-      }
-
-      if (!posAccessor)
-        continue;
-
-      glm::vec3 baseColor(0.7f, 0.7f, 0.8f);
-      if (prim.material && prim.material->has_pbr_metallic_roughness) {
-        float *c = prim.material->pbr_metallic_roughness.base_color_factor;
-        baseColor = glm::vec3(c[0], c[1], c[2]);
-      }
-
-      for (cgltf_size vi = 0; vi < posAccessor->count; vi++) {
-        Vertex v{};
-        cgltf_accessor_read_float(posAccessor, vi, &v.pos.x, 3);
-        if (normAccessor)
-          cgltf_accessor_read_float(normAccessor, vi, &v.normal.x, 3);
-        else
-          v.normal = glm::vec3(0.0f, 1.0f, 0.0f);
-        v.color = baseColor;
-        if (uvAccessor)
-          cgltf_accessor_read_float(uvAccessor, vi, &v.uv.x, 2);
-        else
-          v.uv = glm::vec2(0.0f, 0.0f);
-        meshVertices.push_back(v);
-      }
+    std::string gltfPath(path);
+    std::string dir = gltfPath.substr(0, gltfPath.find_last_of("/\\") + 1);
+    std::string texPath = dir + image->uri;
 
-      if (prim.indices) {
-        for (cgltf_size ii = 0; ii < prim.indices->count; ii++) {
-          uint32_t idx = static_cast<uint32_t>(
-              cgltf_accessor_read_index(prim.indices, ii));
-          meshIndices.push_back(vertexOffset + idx);
-        }
-      } else {
-        for (uint32_t vi = 0; vi < static_cast<uint32_t>(posAccessor->count);
-             vi++)
-          meshIndices.push_back(vertexOffset + vi);
-      }
+    std::ifstream texFile(texPath, std::ios::ate | std::ios::binary);
+    if (!texFile.is_open()) {
+      std::cerr << "Warning: Could not open texture file: " << texPath
+                << std::endl;
+      return defaultMaterialId_;
     }
-  }
+    size_t fileSize = static_cast<size_t>(texFile.tellg());
+    texFile.seekg(0);
+    std::vector<uint8_t> texFileData(fileSize);
+    texFile.read(reinterpret_cast<char *>(texFileData.data()),
+                 static_cast<std::streamsize>(fileSize));
+    texFile.close();
+    return loadTextureFromMemory(texFileData.data(), texFileData.size());
+  };
 
   // Load base_color_texture from the first material that has one
   int meshMaterialId = defaultMaterialId_;
@@ -273,41 +814,18 @@ int VulkanRenderer::loadMesh(const char *path) {
       if (!prim.material || !prim.material->has_pbr_metallic_roughness)
         continue;
 
-      cgltf_texture_view &texView =
-          prim.material->pbr_metallic_roughness.base_color_texture;
-      if (!texView.texture || !texView.texture->image)
+      cgltf_texture *texture =
+          prim.material->pbr_metallic_roughness.base_color_texture.texture;
+      if (!texture)
         continue;
 
-      cgltf_image *image = texView.texture->image;
-
-      if (image->buffer_view && image->buffer_view->buffer) {
-        // Embedded texture data (GLB)
-        const uint8_t *texData = reinterpret_cast<const uint8_t *>(
-                                     image->buffer_view->buffer->data) +
-                                 image->buffer_view->offset;
-        size_t texSize = image->buffer_view->size;
-        meshMaterialId = loadTextureFromMemory(texData, texSize);
-      } else if (image->uri) {
-        // External file URI relative to glTF path
-        std::string gltfPath(path);
-        std::string dir = gltfPath.substr(0, gltfPath.find_last_of("/\\") + 1);
-        std::string texPath = dir + image->uri;
-
-        std::ifstream texFile(texPath, std::ios::ate | std::ios::binary);
-        if (texFile.is_open()) {
-          size_t fileSize = static_cast<size_t>(texFile.tellg());
-          texFile.seekg(0);
-          std::vector<uint8_t> texFileData(fileSize);
-          texFile.read(reinterpret_cast<char *>(texFileData.data()),
-                       static_cast<std::streamsize>(fileSize));
-          texFile.close();
-          meshMaterialId =
-              loadTextureFromMemory(texFileData.data(), texFileData.size());
-        } else {
-          std::cerr << "Warning: Could not open texture file: " << texPath
-                    << std::endl;
-        }
-      }
+      // KHR_texture_basisu points at a KTX2 image and keeps `image` as the
+      // fallback for when that can't be used (supercompressed, or a format
+      // the device can't sample)
+      if (texture->has_basisu && texture->basisu_image)
+        meshMaterialId = loadImage(texture->basisu_image);
+      if (meshMaterialId == defaultMaterialId_ && texture->image)
+        meshMaterialId = loadImage(texture->image);
     }
   }
 
@@ -332,35 +850,170 @@ int VulkanRenderer::loadMesh(const char *path) {
     v.pos = (v.pos - center) * scale;
   }
 
-  int meshId = addMesh(meshVertices, meshIndices);
+  int meshId = addMesh(std::move(meshVertices), std::move(meshIndices));
   if (meshId >= 0) {
     meshes_[meshId].materialId = meshMaterialId;
   }
   return meshId;
 }
 
-int VulkanRenderer::addMesh(const std::vector<Vertex> &vertices,
-                            const std::vector<uint32_t> &indices) {
+int VulkanRenderer::addMesh(std::vector<Vertex> vertices,
+                            std::vector<uint32_t> indices) {
   if (vertices.empty() || indices.empty()) {
     std::cerr << "Cannot add empty mesh" << std::endl;
     return -1;
   }
 
+  size_t sourceVertexCount = vertices.size();
+  bool indicesValid = true;
+  for (uint32_t index : indices) {
+    if (index >= sourceVertexCount) {
+      std::cerr << "Warning: mesh index " << index << " out of range ("
+                << sourceVertexCount << " vertices), uploading as is"
+                << std::endl;
+      indicesValid = false;
+      break;
+    }
+  }
+
+  // glTF primitives without indices, and exporters that split every corner,
+  // repeat identical vertices; merging them is lossless at epsilon 0
+  if (indicesValid) {
+    if (sourceVertexCount >= WELD_PARALLEL_MIN_VERTICES &&
+        meshPool_.getWorkerCount() == 0) {
+      meshPool_.resize(static_cast<int>(
+          std::max(1u, std::thread::hardware_concurrency()) - 1));
+    }
+    weldVertices(vertices, indices, weldEpsilon_, meshPool_);
+  }
+
+  // Loaders and generators emit triangles in source order; only the order
+  // changes here, never which triangles get drawn
+  VertexCacheStats cacheBefore, cacheAfter;
+  bool triangleList = indicesValid && indices.size() % 3 == 0;
+  bool optimized = triangleList && meshOptimization_;
+  if (optimized)
+    optimizeMeshOrder(vertices, indices, cacheBefore, cacheAfter);
+
+  std::vector<PackedVertex> packed(vertices.size());
+  for (size_t i = 0; i < vertices.size(); i++)
+    packed[i] = PackedVertex::pack(vertices[i]);
+
   MeshData md{};
-  md.vertexOffset = static_cast<int32_t>(allVertices_.size());
-  md.indexOffset = static_cast<uint32_t>(allIndices_.size());
+  md.vertexOffset = static_cast<int32_t>(
+      appendGeometry(vertexArena_, packed.data(),
+                     sizeof(PackedVertex) * packed.size()) /
+      sizeof(PackedVertex));
+
+  // Indices are relative to vertexOffset, so any mesh that small fits
+  // 16 bits regardless of where it lands in the arena
+  md.indexType = vertices.size() <= 0x10000 ? VK_INDEX_TYPE_UINT16
+                                            : VK_INDEX_TYPE_UINT32;
+  VkDeviceSize indexBytes = 0;
+  auto appendIndices = [&](const std::vector<uint32_t> &source) {
+    if (md.indexType == VK_INDEX_TYPE_UINT16) {
+      std::vector<uint16_t> indices16(source.begin(), source.end());
+      VkDeviceSize bytes = sizeof(uint16_t) * indices16.size();
+      indexBytes += bytes;
+      return static_cast<uint32_t>(
+          appendGeometry(indexArena_, indices16.data(), bytes,
+                         sizeof(uint16_t)) /
+          sizeof(uint16_t));
+    }
+    VkDeviceSize bytes = sizeof(uint32_t) * source.size();
+    indexBytes += bytes;
+    return static_cast<uint32_t>(
+        appendGeometry(indexArena_, source.data(), bytes, sizeof(uint32_t)) /
+        sizeof(uint32_t));
+  };
+  md.indexOffset = appendIndices(indices);
   md.indexCount = static_cast<uint32_t>(indices.size());
+  md.lods[0] = {md.indexOffset, md.indexCount, 0.0f};
+  // What the same mesh would have taken on the GPU without welding
+  VkDeviceSize unweldedBytes =
+      sizeof(PackedVertex) * sourceVertexCount +
+      (sourceVertexCount <= 0x10000 ? sizeof(uint16_t) : sizeof(uint32_t)) *
+          indices.size();
+  VkDeviceSize weldedBytes = sizeof(PackedVertex) * packed.size() + indexBytes;
+
+  // Each level halves the previous one until simplification stalls (borders
+  // and seams are locked, so flat-shaded meshes stop early)
+  size_t lodIndexCount = 0;
+  if (meshLods_ && triangleList) {
+    std::vector<uint32_t> previous = indices;
+    float error = 0.0f;
+    while (md.lodCount < MAX_MESH_LODS) {
+      float levelError;
+      std::vector<uint32_t> simplified = simplifyMesh(
+          previous.data(), previous.size(), &vertices[0].pos.x, sizeof(Vertex),
+          vertices.size(), previous.size() / 2, levelError);
+      if (simplified.empty() || simplified.size() > previous.size() * 3 / 4)
+        break;
+      if (meshOptimization_)
+        optimizeVertexCache(simplified.data(), simplified.size(),
+                            vertices.size());
+      // Each level's error is measured against the one before it
+      error += levelError;
+      md.lods[md.lodCount++] = {appendIndices(simplified),
+                                static_cast<uint32_t>(simplified.size()),
+                                error};
+      lodIndexCount += simplified.size();
+      previous.swap(simplified);
+    }
+  }
+  // Meshlets cover LOD 0 in its final order, so each is one index range
+  if (triangleList && indices.size() / 3 >= MESHLET_MIN_TRIANGLES) {
+    std::vector<Meshlet> meshlets =
+        buildMeshlets(indices.data(), indices.size(), &vertices[0].pos.x,
+                      sizeof(Vertex), vertices.size());
+    md.meshletOffset = static_cast<uint32_t>(meshlets_.size());
+    md.meshletCount = static_cast<uint32_t>(meshlets.size());
+    meshlets_.insert(meshlets_.end(), meshlets.begin(), meshlets.end());
+  }
+
+  geometryBytes_ += sizeof(PackedVertex) * packed.size() + indexBytes;
+  unpackedGeometryBytes_ +=
+      sizeof(Vertex) * sourceVertexCount +
+      sizeof(uint32_t) * (indices.size() + lodIndexCount);
   md.materialId = defaultMaterialId_;
 
-  allVertices_.insert(allVertices_.end(), vertices.begin(), vertices.end());
-  allIndices_.insert(allIndices_.end(), indices.begin(), indices.end());
+  // Object-space AABB, plus a bounding sphere around its center
+  md.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+  md.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+  for (const auto &v : vertices) {
+    md.boundsMin = glm::min(md.boundsMin, v.pos);
+    md.boundsMax = glm::max(md.boundsMax, v.pos);
+  }
+  md.boundsCenter = (md.boundsMin + md.boundsMax) * 0.5f;
+  float radiusSq = 0.0f;
+  for (const auto &v : vertices) {
+    glm::vec3 d = v.pos - md.boundsCenter;
+    radiusSq = std::max(radiusSq, glm::dot(d, d));
+  }
+  md.boundsRadius = std::sqrt(radiusSq);
 
   int meshId = static_cast<int>(meshes_.size());
   meshes_.push_back(md);
-  buffersNeedRebuild_ = true;
-
-  std::cout << "Added mesh " << meshId << ": " << vertices.size()
-            << " vertices, " << indices.size() << " indices" << std::endl;
+  meshEntityCounts_.push_back(0);
+
+  std::cout << "Added mesh " << meshId << ": " << sourceVertexCount << " -> "
+            << vertices.size() << " unique vertices ("
+            << unweldedBytes - weldedBytes << " bytes saved), "
+            << indices.size()
+            << (md.indexType == VK_INDEX_TYPE_UINT16 ? " 16-bit" : " 32-bit")
+            << " indices";
+  if (optimized)
+    std::cout << ", ACMR " << cacheBefore.acmr << " -> " << cacheAfter.acmr
+              << ", ATVR " << cacheBefore.atvr << " -> " << cacheAfter.atvr;
+  if (md.meshletCount > 0)
+    std::cout << ", " << md.meshletCount << " meshlets";
+  if (md.lodCount > 1) {
+    std::cout << ", LODs";
+    for (uint32_t lod = 1; lod < md.lodCount; lod++)
+      std::cout << " " << md.lods[lod].indexCount << " (error "
+                << md.lods[lod].error << ")";
+  }
+  std::cout << std::endl;
   return meshId;
 }
 
@@ -413,7 +1066,7 @@ int VulkanRenderer::createBoxMesh(float width, float height, float length,
   addFace({-hw, -hh, -hl}, {-hw, -hh, hl}, {-hw, hh, hl}, {-hw, hh, -hl},
           {-1, 0, 0});
 
-  return addMesh(verts, inds);
+  return addMesh(std::move(verts), std::move(inds));
 }
 
 int VulkanRenderer::createSphereMesh(float radius, int segments, int rings,
@@ -457,7 +1110,7 @@ int VulkanRenderer::createSphereMesh(float radius, int segments, int rings,
     }
   }
 
-  return addMesh(verts, inds);
+  return addMesh(std::move(verts), std::move(inds));
 }
 
 int VulkanRenderer::createPlaneMesh(float width, float height, float r, float g,
@@ -474,7 +1127,7 @@ int VulkanRenderer::createPlaneMesh(float width, float height, float r, float g,
   };
   std::vector<uint32_t> inds = {0, 1, 2, 0, 2, 3};
 
-  return addMesh(verts, inds);
+  return addMesh(std::move(verts), std::move(inds));
 }
 
 int VulkanRenderer::createCylinderMesh(float radius, float height, int segments,
@@ -561,7 +1214,7 @@ int VulkanRenderer::createCylinderMesh(float radius, float height, int segments,
     inds.push_back(botRimStart + static_cast<uint32_t>(next));
   }
 
-  return addMesh(verts, inds);
+  return addMesh(std::move(verts), std::move(inds));
 }
 
 int VulkanRenderer::createCapsuleMesh(float radius, float height, int segments,
@@ -648,7 +1301,7 @@ int VulkanRenderer::createCapsuleMesh(float radius, float height, int segments,
     }
   }
 
-  return addMesh(verts, inds);
+  return addMesh(std::move(verts), std::move(inds));
 }
 
 int VulkanRenderer::allocateEntity(std::vector<EntityData> &pool,
@@ -677,7 +1330,14 @@ int VulkanRenderer::allocateEntity(std::vector<EntityData> &pool,
 }
 
 int VulkanRenderer::createEntity(int meshId) {
-  return allocateEntity(entities_, freeEntitySlots_, meshId);
+  int entityId = allocateEntity(entities_, freeEntitySlots_, meshId);
+  if (entityId >= 0) {
+    EntityData &ent = entities_[entityId];
+    ent.proxyId = entityTree_.createProxy(computeWorldBounds(ent), entityId);
+    meshEntityCounts_[meshId]++;
+    markGpuEntityDirty(entityId);
+  }
+  return entityId;
 }
 
 void VulkanRenderer::setEntityTransform(int entityId, const float *mat4x4) {
@@ -685,91 +1345,162 @@ void VulkanRenderer::setEntityTransform(int entityId, const float *mat4x4) {
       !entities_[entityId].active) {
     return;
   }
-  memcpy(&entities_[entityId].transform, mat4x4, sizeof(float) * 16);
+  EntityData &ent = entities_[entityId];
+  memcpy(&ent.transform, mat4x4, sizeof(float) * 16);
+  entityTree_.moveProxy(ent.proxyId, computeWorldBounds(ent));
+  markGpuEntityDirty(entityId);
 }
 
 void VulkanRenderer::removeEntity(int entityId) {
-  if (entityId < 0 || entityId >= static_cast<int>(entities_.size()))
+  if (entityId < 0 || entityId >= static_cast<int>(entities_.size()) ||
+      !entities_[entityId].active)
     return;
-  entities_[entityId].active = false;
+  EntityData &ent = entities_[entityId];
+  entityTree_.destroyProxy(ent.proxyId);
+  ent.proxyId = -1;
+  ent.active = false;
+  meshEntityCounts_[ent.meshId]--;
+  markGpuEntityDirty(entityId);
   freeEntitySlots_.push_back(entityId);
 }
 
-void VulkanRenderer::rebuildGeometryBuffers() {
-  if (allVertices_.empty() || allIndices_.empty())
-    return;
-
-  vkDeviceWaitIdle(device_);
+// ---------------------------------------------------------------------------
+// Geometry arena
+// ---------------------------------------------------------------------------
 
-  if (vertexBuffer_) {
-    vkDestroyBuffer(device_, vertexBuffer_, nullptr);
-    vertexBuffer_ = VK_NULL_HANDLE;
-  }
-  if (vertexBufferMemory_) {
-    vkFreeMemory(device_, vertexBufferMemory_, nullptr);
-    vertexBufferMemory_ = VK_NULL_HANDLE;
-  }
-  if (indexBuffer_) {
-    vkDestroyBuffer(device_, indexBuffer_, nullptr);
-    indexBuffer_ = VK_NULL_HANDLE;
-  }
-  if (indexBufferMemory_) {
-    vkFreeMemory(device_, indexBufferMemory_, nullptr);
-    indexBufferMemory_ = VK_NULL_HANDLE;
-  }
+// Queues bytes for upload and returns their offset in the arena buffer
+// `alignment` pads the arena first, so the returned offset can be addressed
+// in whole elements (index ranges of different widths share one arena)
+VkDeviceSize VulkanRenderer::appendGeometry(GeometryArena &arena,
+                                            const void *data, VkDeviceSize size,
+                                            VkDeviceSize alignment) {
+  VkDeviceSize offset = arena.uploaded + arena.pending.size();
+  VkDeviceSize padding = (alignment - offset % alignment) % alignment;
+  arena.pending.insert(arena.pending.end(), static_cast<size_t>(padding), 0);
+  offset += padding;
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  arena.pending.insert(arena.pending.end(), bytes, bytes + size);
+  return offset;
+}
 
-  // Build vertex buffer from allVertices_
-  {
-    VkDeviceSize bufferSize = sizeof(Vertex) * allVertices_.size();
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer, stagingBufferMemory);
+bool VulkanRenderer::hasPendingGeometry() const {
+  return !vertexArena_.pending.empty() || !indexArena_.pending.empty();
+}
 
-    void *data;
-    vkMapMemory(device_, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, allVertices_.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(device_, stagingBufferMemory);
+// Records copies of the mesh data added since the last frame into the arenas.
+// Earlier ranges are never rewritten, so frames still in flight can keep
+// drawing from them.
+void VulkanRenderer::recordGeometryUploads() {
+  PROFILE_FUNCTION();
+  struct {
+    GeometryArena *arena;
+    VkBufferUsageFlags usage;
+  } uploads[] = {{&vertexArena_, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT},
+                 {&indexArena_, VK_BUFFER_USAGE_INDEX_BUFFER_BIT}};
+
+  for (const auto &upload : uploads) {
+    GeometryArena &arena = *upload.arena;
+    VkDeviceSize size = arena.pending.size();
+    if (size == 0)
+      continue;
 
-    createBuffer(bufferSize,
-                 VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                     VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer_,
-                 vertexBufferMemory_);
-    copyBuffer(stagingBuffer, vertexBuffer_, bufferSize);
+    // Staging may submit the open batch when the ring is full, so the
+    // command buffer is fetched afterwards
+    VkDeviceSize offset = stageUpload(arena.pending.data(), size);
+    VkCommandBuffer cmd = uploadCommands();
+    growGeometryArena(cmd, arena, arena.uploaded + size, upload.usage);
 
-    vkDestroyBuffer(device_, stagingBuffer, nullptr);
-    vkFreeMemory(device_, stagingBufferMemory, nullptr);
+    VkBufferCopy region{offset, arena.uploaded, size};
+    vkCmdCopyBuffer(cmd, stagingRing_.buffer, arena.buffer, 1, &region);
+    arena.uploaded += size;
+    arena.pending.clear();
   }
 
-  // Build index buffer from allIndices_
-  {
-    VkDeviceSize bufferSize = sizeof(uint32_t) * allIndices_.size();
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer, stagingBufferMemory);
-
-    void *data;
-    vkMapMemory(device_, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, allIndices_.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(device_, stagingBufferMemory);
+  VkCommandBuffer cmd = uploadCommands();
+  uploadBatch_.acquire.meshCount = meshes_.size();
 
-    createBuffer(
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer_, indexBufferMemory_);
-    copyBuffer(stagingBuffer, indexBuffer_, bufferSize);
+  // A transfer queue has no vertex input stage; recordUploadAcquires()
+  // makes the data visible on the graphics queue instead
+  if (dedicatedTransfer_)
+    return;
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask =
+      VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+}
+
+// Reallocates the arena with at least `required` bytes, doubling its size so
+// that a series of mesh loads only grows it O(log n) times. The old contents
+// are copied on the GPU; frames keep drawing from the old buffer until the
+// batch is acquired, and it is retired after that.
+void VulkanRenderer::growGeometryArena(VkCommandBuffer commandBuffer,
+                                       GeometryArena &arena,
+                                       VkDeviceSize required,
+                                       VkBufferUsageFlags usage) {
+  if (required <= arena.capacity)
+    return;
 
-    vkDestroyBuffer(device_, stagingBuffer, nullptr);
-    vkFreeMemory(device_, stagingBufferMemory, nullptr);
+  VkDeviceSize capacity = arena.capacity * 2;
+  if (capacity < GEOMETRY_ARENA_MIN_BYTES)
+    capacity = GEOMETRY_ARENA_MIN_BYTES;
+  if (capacity < required)
+    capacity = required;
+
+  VkBuffer buffer;
+  MemoryAllocation memory;
+  createBuffer(capacity,
+               VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                   VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_GEOMETRY, buffer,
+               memory, true);
+
+  if (arena.buffer) {
+    if (arena.uploaded > 0) {
+      // An earlier upload batch may still be writing it
+      VkMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0,
+                           nullptr, 0, nullptr);
+
+      VkBufferCopy region{0, 0, arena.uploaded};
+      vkCmdCopyBuffer(commandBuffer, arena.buffer, buffer, 1, &region);
+    }
+    // Drawing switches to the new buffer when this batch is acquired
+    uploadBatch_.acquire.replaced.push_back({arena.buffer, arena.memory});
   }
 
-  buffersNeedRebuild_ = false;
+  arena.buffer = buffer;
+  arena.memory = memory;
+  arena.capacity = capacity;
+}
+
+void VulkanRenderer::destroyGeometryArena(GeometryArena &arena) {
+  if (arena.buffer)
+    vkDestroyBuffer(device_, arena.buffer, nullptr);
+  memoryAllocator_.free(arena.memory);
+  arena = GeometryArena{};
+}
+
+void VulkanRenderer::retireBuffer(VkBuffer buffer,
+                                  const MemoryAllocation &memory) {
+  retiredBuffers_[currentFrame_].push_back({buffer, memory});
+}
+
+// Called after waiting on the frame's fence, so nothing retired while
+// recording that frame is still in use
+void VulkanRenderer::releaseRetiredBuffers(uint32_t frame) {
+  for (auto &retired : retiredBuffers_[frame]) {
+    vkDestroyBuffer(device_, retired.buffer, nullptr);
+    memoryAllocator_.free(retired.memory);
+  }
+  retiredBuffers_[frame].clear();
 }
 
 // ---------------------------------------------------------------------------
@@ -803,71 +1534,121 @@ void VulkanRenderer::setRotation(float rx, float ry, float rz) {
   }
 }
 
+// Headless runs have no window: the caller decides when to stop, and input
+// queries report nothing pressed
 bool VulkanRenderer::shouldClose() const {
-  return glfwWindowShouldClose(window_);
+  return window_ && glfwWindowShouldClose(window_);
 }
 
-void VulkanRenderer::pollEvents() { glfwPollEvents(); }
+void VulkanRenderer::pollEvents() {
+  if (window_)
+    glfwPollEvents();
+}
 
 int VulkanRenderer::isKeyPressed(int glfwKey) const {
+  if (!window_)
+    return 0;
   return glfwGetKey(window_, glfwKey) == GLFW_PRESS ? 1 : 0;
 }
 
 void VulkanRenderer::renderFrame() {
+  PROFILE_FUNCTION();
   if (entities_.empty())
     return;
 
-  // Rebuild geometry buffers if meshes were added
-  if (buffersNeedRebuild_) {
-    rebuildGeometryBuffers();
-  }
-
-  if (!vertexBuffer_ || !indexBuffer_)
+  if (meshes_.empty())
     return;
 
-  vkWaitForFences(device_, 1, &inFlightFences_[currentFrame_], VK_TRUE,
-                  UINT64_MAX);
-
-  uint32_t imageIndex;
-  VkResult result = vkAcquireNextImageKHR(
-      device_, swapchain_, UINT64_MAX, imageAvailableSemaphores_[currentFrame_],
-      VK_NULL_HANDLE, &imageIndex);
-  if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-    recreateSwapchain();
-    return;
+  {
+    PROFILE_ZONE("waitForFrameFence");
+    vkWaitForFences(device_, 1, &inFlightFences_[currentFrame_], VK_TRUE,
+                    UINT64_MAX);
   }
-  if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-    throw std::runtime_error("Failed to acquire swap chain image");
+  releaseRetiredBuffers(currentFrame_);
+  for (VkSemaphore semaphore : uploadSemaphoresInUse_[currentFrame_])
+    freeUploadSemaphores_.push_back(semaphore);
+  uploadSemaphoresInUse_[currentFrame_].clear();
+  reclaimUploads(false);
+  readGpuTimings(currentFrame_);
+
+  // Headless: each frame in flight owns one offscreen image
+  uint32_t imageIndex = currentFrame_;
+  if (!headless_) {
+    PROFILE_ZONE("acquireNextImage");
+    VkResult result = vkAcquireNextImageKHR(
+        device_, swapchain_, UINT64_MAX,
+        imageAvailableSemaphores_[currentFrame_], VK_NULL_HANDLE, &imageIndex);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+      recreateSwapchain();
+      return;
+    }
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+      throw std::runtime_error("Failed to acquire swap chain image");
+    }
   }
 
   vkResetFences(device_, 1, &inFlightFences_[currentFrame_]);
 
   updateUniformBuffer(currentFrame_);
+  acquireUploads();
+  prepareInstances(currentFrame_);
 
   if (debugOverlayEnabled_) {
     buildDebugOverlayGeometry();
   }
 
+  // Everything staged since the last frame (new meshes, textures) goes out in
+  // one submission ahead of the frame's own
+  if (hasPendingGeometry())
+    recordGeometryUploads();
+  submitUploads();
+
   vkResetCommandBuffer(commandBuffers_[currentFrame_], 0);
   recordCommandBuffer(commandBuffers_[currentFrame_], imageIndex);
 
+  // Landed transfer-queue uploads are handed over through their semaphores;
+  // they have already completed, so the wait costs nothing
+  std::vector<VkSemaphore> waitSemaphores;
+  std::vector<VkPipelineStageFlags> waitStages;
+  if (!headless_) {
+    waitSemaphores.push_back(imageAvailableSemaphores_[currentFrame_]);
+    waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+  }
+  for (VkSemaphore semaphore : uploadWaitSemaphores_) {
+    waitSemaphores.push_back(semaphore);
+    waitStages.push_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+  }
+
   VkSubmitInfo submitInfo{};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores_[currentFrame_]};
-  VkPipelineStageFlags waitStages[] = {
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = waitSemaphores;
-  submitInfo.pWaitDstStageMask = waitStages;
+  submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+  submitInfo.pWaitSemaphores = waitSemaphores.data();
+  submitInfo.pWaitDstStageMask = waitStages.data();
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffers_[currentFrame_];
   VkSemaphore signalSemaphores[] = {renderFinishedSemaphores_[currentFrame_]};
-  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.signalSemaphoreCount = headless_ ? 0 : 1;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
-  checkVk(vkQueueSubmit(graphicsQueue_, 1, &submitInfo,
-                        inFlightFences_[currentFrame_]),
-          "Failed to submit draw command buffer");
+  {
+    PROFILE_ZONE("queueSubmit");
+    checkVk(vkQueueSubmit(graphicsQueue_, 1, &submitInfo,
+                          inFlightFences_[currentFrame_]),
+            "Failed to submit draw command buffer");
+  }
+
+  // Reusable once this frame's fence has signaled
+  auto &inUse = uploadSemaphoresInUse_[currentFrame_];
+  inUse.insert(inUse.end(), uploadWaitSemaphores_.begin(),
+               uploadWaitSemaphores_.end());
+  uploadWaitSemaphores_.clear();
+
+  if (headless_) {
+    if (!frameDumpDirectory_.empty())
+      writeFrameDump(currentFrame_);
+    currentFrame_ = (currentFrame_ + 1) % framesInFlight_;
+    return;
+  }
 
   VkPresentInfoKHR presentInfo{};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -878,7 +1659,11 @@ void VulkanRenderer::renderFrame() {
   presentInfo.pSwapchains = swapchains;
   presentInfo.pImageIndices = &imageIndex;
 
-  result = vkQueuePresentKHR(presentQueue_, &presentInfo);
+  VkResult result;
+  {
+    PROFILE_ZONE("queuePresent");
+    result = vkQueuePresentKHR(presentQueue_, &presentInfo);
+  }
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
       framebufferResized_) {
     framebufferResized_ = false;
@@ -887,7 +1672,7 @@ void VulkanRenderer::renderFrame() {
     throw std::runtime_error("Failed to present swap chain image");
   }
 
-  currentFrame_ = (currentFrame_ + 1) % MAX_FRAMES_IN_FLIGHT;
+  currentFrame_ = (currentFrame_ + 1) % framesInFlight_;
 }
 
 // ---------------------------------------------------------------------------
@@ -903,23 +1688,45 @@ void VulkanRenderer::createInstance() {
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.apiVersion = VK_API_VERSION_1_0;
 
-  uint32_t glfwExtCount = 0;
-  const char **glfwExts = glfwGetRequiredInstanceExtensions(&glfwExtCount);
-  if (!glfwExts || glfwExtCount == 0)
-    throw std::runtime_error(
-        "GLFW cannot find Vulkan loader. "
-        "Ensure DYLD_LIBRARY_PATH includes /opt/homebrew/lib");
-  std::vector<const char *> extensions(glfwExts, glfwExts + glfwExtCount);
+  // Headless instances need no surface extensions at all
+  std::vector<const char *> extensions;
+  if (!headless_) {
+    uint32_t glfwExtCount = 0;
+    const char **glfwExts = glfwGetRequiredInstanceExtensions(&glfwExtCount);
+    if (!glfwExts || glfwExtCount == 0)
+      throw std::runtime_error(
+          "GLFW cannot find Vulkan loader. "
+          "Ensure DYLD_LIBRARY_PATH includes /opt/homebrew/lib");
+    extensions.assign(glfwExts, glfwExts + glfwExtCount);
+  }
 
-  extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
-  extensions.push_back("VK_KHR_get_physical_device_properties2");
+  // Portability enumeration is needed for MoltenVK; older Linux loaders
+  // reject it, so only ask for what the loader offers
+  uint32_t availableCount = 0;
+  vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, nullptr);
+  std::vector<VkExtensionProperties> available(availableCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &availableCount,
+                                         available.data());
+  auto hasExtension = [&](const char *name) {
+    for (const auto &ext : available) {
+      if (strcmp(ext.extensionName, name) == 0)
+        return true;
+    }
+    return false;
+  };
 
   VkInstanceCreateInfo createInfo{};
+  if (hasExtension(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME)) {
+    extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+    createInfo.flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
+  }
+  if (hasExtension("VK_KHR_get_physical_device_properties2"))
+    extensions.push_back("VK_KHR_get_physical_device_properties2");
+
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
   createInfo.pApplicationInfo = &appInfo;
   createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
   createInfo.ppEnabledExtensionNames = extensions.data();
-  createInfo.flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
 
   checkVk(vkCreateInstance(&createInfo, nullptr, &instance_),
           "Failed to create Vulkan instance");
@@ -943,14 +1750,33 @@ VulkanRenderer::findQueueFamilies(VkPhysicalDevice device) const {
     if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
       indices.graphicsFamily = i;
 
+    // Headless frames are never presented
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    if (headless_)
+      presentSupport = indices.graphicsFamily == i;
+    else
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_,
+                                           &presentSupport);
     if (presentSupport)
       indices.presentFamily = i;
 
     if (indices.isComplete())
       break;
   }
+
+  // Uploads prefer a transfer-only family (usually a DMA engine), then any
+  // non-graphics family that can transfer
+  for (uint32_t i = 0; i < queueFamilyCount; i++) {
+    VkQueueFlags flags = queueFamilies[i].queueFlags;
+    if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+      continue;
+    if (!(flags & VK_QUEUE_COMPUTE_BIT)) {
+      indices.transferFamily = i;
+      break;
+    }
+    if (!indices.transferFamily)
+      indices.transferFamily = i;
+  }
   return indices;
 }
 
@@ -958,6 +1784,8 @@ bool VulkanRenderer::isDeviceSuitable(VkPhysicalDevice device) const {
   QueueFamilyIndices indices = findQueueFamilies(device);
   if (!indices.isComplete())
     return false;
+  if (headless_)
+    return true;
 
   uint32_t extensionCount;
   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
@@ -1014,6 +1842,8 @@ void VulkanRenderer::createLogicalDevice() {
   std::set<uint32_t> uniqueQueueFamilies = {
       queueFamilies_.graphicsFamily.value(),
       queueFamilies_.presentFamily.value()};
+  if (queueFamilies_.transferFamily)
+    uniqueQueueFamilies.insert(queueFamilies_.transferFamily.value());
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   float queuePriority = 1.0f;
@@ -1026,11 +1856,80 @@ void VulkanRenderer::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice_, &supportedFeatures);
+
   VkPhysicalDeviceFeatures deviceFeatures{};
   deviceFeatures.fillModeNonSolid = VK_TRUE;
+  // Optional: GPU-driven culling needs non-zero firstInstance in indirect
+  // commands; multi-draw lets one call cover every mesh sharing a material
+  deviceFeatures.drawIndirectFirstInstance =
+      supportedFeatures.drawIndirectFirstInstance;
+  deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+  multiDrawIndirectSupported_ = supportedFeatures.multiDrawIndirect == VK_TRUE;
+  // Optional: pipeline statistics in the debug overlay; inherited queries
+  // let them span secondary command buffers
+  deviceFeatures.pipelineStatisticsQuery =
+      supportedFeatures.pipelineStatisticsQuery;
+  deviceFeatures.inheritedQueries = supportedFeatures.inheritedQueries;
+  pipelineStatisticsSupported_ =
+      supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+  inheritedQueriesSupported_ = supportedFeatures.inheritedQueries == VK_TRUE;
+  // Optional: KTX2 textures in compressed formats; loadTextureKtx2 checks
+  // the individual format before using it
+  deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+  deviceFeatures.textureCompressionETC2 =
+      supportedFeatures.textureCompressionETC2;
+  deviceFeatures.textureCompressionASTC_LDR =
+      supportedFeatures.textureCompressionASTC_LDR;
+
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice_, &queueFamilyCount,
+                                           nullptr);
+  std::vector<VkQueueFamilyProperties> familyProps(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice_, &queueFamilyCount,
+                                           familyProps.data());
+  bool graphicsHasCompute =
+      (familyProps[queueFamilies_.graphicsFamily.value()].queueFlags &
+       VK_QUEUE_COMPUTE_BIT) != 0;
+  drawIndirectFirstInstanceSupported_ =
+      supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+  gpuCullingSupported_ =
+      graphicsHasCompute && drawIndirectFirstInstanceSupported_;
+  timestampValidBits_ =
+      familyProps[queueFamilies_.graphicsFamily.value()].timestampValidBits;
+
+  VkFormatProperties textureFormatProps;
+  vkGetPhysicalDeviceFormatProperties(
+      physicalDevice_, VK_FORMAT_R8G8B8A8_SRGB, &textureFormatProps);
+  const VkFormatFeatureFlags blitFeatures =
+      VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+      VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  linearBlitSupported_ = (textureFormatProps.optimalTilingFeatures &
+                          blitFeatures) == blitFeatures;
+  timestampsSupported_ = timestampValidBits_ > 0;
+
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(physicalDevice_, &props);
+  deviceLimits_ = props.limits;
 
-  std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-                                                "VK_KHR_portability_subset"};
+  std::vector<const char *> deviceExtensions;
+  if (!headless_)
+    deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+  // Required by MoltenVK when exposed, absent on native drivers (lavapipe)
+  uint32_t extensionCount = 0;
+  vkEnumerateDeviceExtensionProperties(physicalDevice_, nullptr,
+                                       &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> available(extensionCount);
+  vkEnumerateDeviceExtensionProperties(physicalDevice_, nullptr,
+                                       &extensionCount, available.data());
+  for (const auto &ext : available) {
+    if (strcmp(ext.extensionName, "VK_KHR_portability_subset") == 0) {
+      deviceExtensions.push_back("VK_KHR_portability_subset");
+      break;
+    }
+  }
 
   VkDeviceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -1049,6 +1948,15 @@ void VulkanRenderer::createLogicalDevice() {
                    &graphicsQueue_);
   vkGetDeviceQueue(device_, queueFamilies_.presentFamily.value(), 0,
                    &presentQueue_);
+
+  // Without a transfer family, uploads share the graphics queue
+  dedicatedTransfer_ = queueFamilies_.transferFamily.has_value();
+  uploadFamily_ = dedicatedTransfer_ ? queueFamilies_.transferFamily.value()
+                                     : queueFamilies_.graphicsFamily.value();
+  vkGetDeviceQueue(device_, uploadFamily_, 0, &uploadQueue_);
+  std::cout << "Uploads on "
+            << (dedicatedTransfer_ ? "dedicated transfer" : "graphics")
+            << " queue family " << uploadFamily_ << std::endl;
 }
 
 void VulkanRenderer::createSwapchain() {
@@ -1079,13 +1987,25 @@ void VulkanRenderer::createSwapchain() {
   vkGetPhysicalDeviceSurfacePresentModesKHR(
       physicalDevice_, surface_, &presentModeCount, presentModes.data());
 
+  // Walk down from the requested mode: IMMEDIATE -> MAILBOX -> FIFO
+  static const VkPresentModeKHR modeFallback[] = {
+      VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+      VK_PRESENT_MODE_IMMEDIATE_KHR};
   VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
-  for (auto &pm : presentModes) {
-    if (pm == VK_PRESENT_MODE_MAILBOX_KHR) {
-      presentMode = pm;
+  PresentMode chosenMode = PRESENT_MODE_FIFO;
+  for (int mode = requestedPresentMode_; mode > PRESENT_MODE_FIFO; mode--) {
+    if (std::find(presentModes.begin(), presentModes.end(),
+                  modeFallback[mode]) != presentModes.end()) {
+      presentMode = modeFallback[mode];
+      chosenMode = static_cast<PresentMode>(mode);
       break;
     }
   }
+  if (chosenMode != activePresentMode_ || swapchainImages_.empty())
+    std::cout << "Present mode: " << presentModeName(chosenMode)
+              << (chosenMode != requestedPresentMode_ ? " (fallback)" : "")
+              << ", " << framesInFlight_ << " frame(s) in flight" << std::endl;
+  activePresentMode_ = chosenMode;
 
   VkExtent2D extent;
   if (capabilities.currentExtent.width != UINT32_MAX) {
@@ -1101,7 +2021,9 @@ void VulkanRenderer::createSwapchain() {
                    capabilities.maxImageExtent.height);
   }
 
-  uint32_t imageCount = capabilities.minImageCount + 1;
+  // Enough images that every frame in flight can hold one
+  uint32_t imageCount = std::max(capabilities.minImageCount + 1,
+                                 static_cast<uint32_t>(framesInFlight_));
   if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount)
     imageCount = capabilities.maxImageCount;
 
@@ -1161,7 +2083,9 @@ void VulkanRenderer::createRenderPass() {
   colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  colorAttachment.finalLayout = headless_
+                                    ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                    : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
   VkAttachmentDescription depthAttachment{};
   depthAttachment.format = findDepthFormat();
@@ -1199,6 +2123,18 @@ void VulkanRenderer::createRenderPass() {
   dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
                              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+  // Headless frames may be copied out after the pass (frame dumps)
+  VkSubpassDependency readbackDependency{};
+  readbackDependency.srcSubpass = 0;
+  readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+  readbackDependency.srcStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  std::array<VkSubpassDependency, 2> dependencies = {dependency,
+                                                     readbackDependency};
+
   std::array<VkAttachmentDescription, 2> attachments = {colorAttachment,
                                                         depthAttachment};
   VkRenderPassCreateInfo renderPassInfo{};
@@ -1207,8 +2143,8 @@ void VulkanRenderer::createRenderPass() {
   renderPassInfo.pAttachments = attachments.data();
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies = &dependency;
+  renderPassInfo.dependencyCount = headless_ ? 2 : 1;
+  renderPassInfo.pDependencies = dependencies.data();
 
   checkVk(vkCreateRenderPass(device_, &renderPassInfo, nullptr, &renderPass_),
           "Failed to create render pass");
@@ -1227,8 +2163,27 @@ void VulkanRenderer::createDescriptorSetLayout() {
   lightBinding.descriptorCount = 1;
   lightBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-  std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboBinding,
-                                                          lightBinding};
+  VkDescriptorSetLayoutBinding instanceBinding{};
+  instanceBinding.binding = 2;
+  instanceBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  instanceBinding.descriptorCount = 1;
+  instanceBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+  VkDescriptorSetLayoutBinding lightStorageBinding{};
+  lightStorageBinding.binding = 3;
+  lightStorageBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  lightStorageBinding.descriptorCount = 1;
+  lightStorageBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutBinding clusterBinding{};
+  clusterBinding.binding = 4;
+  clusterBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  clusterBinding.descriptorCount = 1;
+  clusterBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  std::array<VkDescriptorSetLayoutBinding, 5> bindings = {
+      uboBinding, lightBinding, instanceBinding, lightStorageBinding,
+      clusterBinding};
 
   VkDescriptorSetLayoutCreateInfo layoutInfo{};
   layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -1262,8 +2217,8 @@ void VulkanRenderer::createGraphicsPipeline() {
   VkPipelineShaderStageCreateInfo shaderStages[] = {vertStageInfo,
                                                     fragStageInfo};
 
-  auto bindingDesc = Vertex::getBindingDescription();
-  auto attrDescs = Vertex::getAttributeDescriptions();
+  auto bindingDesc = PackedVertex::getBindingDescription();
+  auto attrDescs = PackedVertex::getAttributeDescriptions();
 
   VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
   vertexInputInfo.sType =
@@ -1330,12 +2285,8 @@ void VulkanRenderer::createGraphicsPipeline() {
   dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
   dynamicState.pDynamicStates = dynamicStates.data();
 
-  // Push constant range for per-entity model matrix
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-  pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(PushConstantData);
-
+  // Per-entity model matrices come from the instance storage buffer (set 0,
+  // binding 2), so no push constant range is needed
   VkDescriptorSetLayout setLayouts[] = {descriptorSetLayout_,
                                         materialDescriptorSetLayout_};
 
@@ -1343,8 +2294,6 @@ void VulkanRenderer::createGraphicsPipeline() {
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount = 2;
   pipelineLayoutInfo.pSetLayouts = setLayouts;
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
   checkVk(vkCreatePipelineLayout(device_, &pipelineLayoutInfo, nullptr,
                                  &pipelineLayout_),
@@ -1366,7 +2315,7 @@ void VulkanRenderer::createGraphicsPipeline() {
   pipelineInfo.renderPass = renderPass_;
   pipelineInfo.subpass = 0;
 
-  checkVk(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &pipelineInfo,
+  checkVk(vkCreateGraphicsPipelines(device_, pipelineCache_, 1, &pipelineInfo,
                                     nullptr, &graphicsPipeline_),
           "Failed to create graphics pipeline");
 
@@ -1376,7 +2325,7 @@ void VulkanRenderer::createGraphicsPipeline() {
   depthStencil.depthWriteEnable = VK_FALSE;
   depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
 
-  checkVk(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &pipelineInfo,
+  checkVk(vkCreateGraphicsPipelines(device_, pipelineCache_, 1, &pipelineInfo,
                                     nullptr, &debugPipeline_),
           "Failed to create debug wireframe pipeline");
 
@@ -1384,6 +2333,83 @@ void VulkanRenderer::createGraphicsPipeline() {
   vkDestroyShaderModule(device_, vertModule, nullptr);
 }
 
+// Vulkan prefixes cache data with a header naming the device it was built
+// for (VkPipelineCacheHeaderVersionOne). Data from another GPU or driver
+// version is discarded rather than handed to the driver.
+void VulkanRenderer::createPipelineCache() {
+  std::vector<char> data;
+  std::ifstream file(PIPELINE_CACHE_PATH, std::ios::ate | std::ios::binary);
+  if (file.is_open()) {
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!file)
+      data.clear();
+  }
+
+  if (!data.empty()) {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice_, &props);
+
+    const size_t headerBytes = 16 + VK_UUID_SIZE;
+    uint32_t headerSize = 0, headerVersion = 0, vendorID = 0, deviceID = 0;
+    bool valid = data.size() >= headerBytes;
+    if (valid) {
+      memcpy(&headerSize, data.data(), 4);
+      memcpy(&headerVersion, data.data() + 4, 4);
+      memcpy(&vendorID, data.data() + 8, 4);
+      memcpy(&deviceID, data.data() + 12, 4);
+      valid = headerSize >= headerBytes && headerSize <= data.size() &&
+              headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+              vendorID == props.vendorID && deviceID == props.deviceID &&
+              memcmp(data.data() + 16, props.pipelineCacheUUID,
+                     VK_UUID_SIZE) == 0;
+    }
+    if (!valid) {
+      std::cout << "Discarding stale pipeline cache " << PIPELINE_CACHE_PATH
+                << std::endl;
+      data.clear();
+    }
+  }
+
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = data.size();
+  cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+  checkVk(vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_),
+          "Failed to create pipeline cache");
+  pipelineCacheWarm_ = !data.empty();
+}
+
+// Written to a temporary file first so a crash mid-write can't leave a
+// truncated cache behind
+void VulkanRenderer::savePipelineCache() {
+  size_t size = 0;
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &size, nullptr) !=
+          VK_SUCCESS ||
+      size == 0)
+    return;
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &size, data.data()) !=
+      VK_SUCCESS)
+    return;
+
+  std::string tmpPath = std::string(PIPELINE_CACHE_PATH) + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      std::cerr << "Warning: could not write " << tmpPath << std::endl;
+      return;
+    }
+    file.write(data.data(), static_cast<std::streamsize>(size));
+    if (!file) {
+      std::cerr << "Warning: could not write " << tmpPath << std::endl;
+      return;
+    }
+  }
+  std::rename(tmpPath.c_str(), PIPELINE_CACHE_PATH);
+}
+
 void VulkanRenderer::createFramebuffers() {
   swapchainFramebuffers_.resize(swapchainImageViews_.size());
   for (size_t i = 0; i < swapchainImageViews_.size(); i++) {
@@ -1413,6 +2439,11 @@ void VulkanRenderer::createCommandPool() {
 
   checkVk(vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool_),
           "Failed to create command pool");
+
+  poolInfo.queueFamilyIndex = uploadFamily_;
+  checkVk(
+      vkCreateCommandPool(device_, &poolInfo, nullptr, &uploadCommandPool_),
+      "Failed to create upload command pool");
 }
 
 void VulkanRenderer::createDepthResources() {
@@ -1420,7 +2451,8 @@ void VulkanRenderer::createDepthResources() {
   createImage(
       swapchainExtent_.width, swapchainExtent_.height, depthFormat,
       VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage_, depthImageMemory_);
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_ATTACHMENT, depthImage_,
+      depthImageMemory_);
   depthImageView_ =
       createImageView(depthImage_, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 }
@@ -1428,68 +2460,106 @@ void VulkanRenderer::createDepthResources() {
 void VulkanRenderer::createUniformBuffers() {
   VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-  uniformBuffers_.resize(MAX_FRAMES_IN_FLIGHT);
-  uniformBuffersMemory_.resize(MAX_FRAMES_IN_FLIGHT);
-  uniformBuffersMapped_.resize(MAX_FRAMES_IN_FLIGHT);
+  uniformBuffers_.resize(framesInFlight_);
+  uniformBuffersMemory_.resize(framesInFlight_);
+  uniformBuffersMapped_.resize(framesInFlight_);
 
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (int i = 0; i < framesInFlight_; i++) {
     createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 uniformBuffers_[i], uniformBuffersMemory_[i]);
-    vkMapMemory(device_, uniformBuffersMemory_[i], 0, bufferSize, 0,
-                &uniformBuffersMapped_[i]);
+                 MEMORY_FRAME_DATA, uniformBuffers_[i],
+                 uniformBuffersMemory_[i]);
+    uniformBuffersMapped_[i] = uniformBuffersMemory_[i].mapped;
   }
 
   // Light UBO buffers
   VkDeviceSize lightSize = sizeof(LightUBO);
 
-  lightBuffers_.resize(MAX_FRAMES_IN_FLIGHT);
-  lightBuffersMemory_.resize(MAX_FRAMES_IN_FLIGHT);
-  lightBuffersMapped_.resize(MAX_FRAMES_IN_FLIGHT);
+  lightBuffers_.resize(framesInFlight_);
+  lightBuffersMemory_.resize(framesInFlight_);
+  lightBuffersMapped_.resize(framesInFlight_);
 
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (int i = 0; i < framesInFlight_; i++) {
     createBuffer(lightSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 lightBuffers_[i], lightBuffersMemory_[i]);
-    vkMapMemory(device_, lightBuffersMemory_[i], 0, lightSize, 0,
-                &lightBuffersMapped_[i]);
+                 MEMORY_FRAME_DATA, lightBuffers_[i], lightBuffersMemory_[i]);
+    lightBuffersMapped_[i] = lightBuffersMemory_[i].mapped;
   }
 
   lightData_.ambientIntensity = 0.15f;
+
+  // Light and cluster storage buffers
+  lightStorageBuffers_.assign(framesInFlight_, VK_NULL_HANDLE);
+  lightStorageBuffersMemory_.assign(framesInFlight_, MemoryAllocation{});
+  lightStorageBuffersMapped_.assign(framesInFlight_, nullptr);
+  clusterBuffers_.assign(framesInFlight_, VK_NULL_HANDLE);
+  clusterBuffersMemory_.assign(framesInFlight_, MemoryAllocation{});
+  clusterBuffersMapped_.assign(framesInFlight_, nullptr);
+  clusterIndexCapacity_.assign(framesInFlight_, 0);
+
+  for (uint32_t i = 0; i < static_cast<uint32_t>(framesInFlight_); i++) {
+    createMappedBuffer(sizeof(GpuLight) * MAX_LIGHTS,
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       lightStorageBuffers_[i], lightStorageBuffersMemory_[i],
+                       lightStorageBuffersMapped_[i]);
+    ensureClusterCapacity(i, INITIAL_CLUSTER_INDEX_CAPACITY);
+  }
+}
+
+void VulkanRenderer::createInstanceBuffers() {
+  instanceBuffers_.assign(framesInFlight_, VK_NULL_HANDLE);
+  instanceBuffersMemory_.assign(framesInFlight_, MemoryAllocation{});
+  instanceBuffersMapped_.assign(framesInFlight_, nullptr);
+  instanceCapacity_.assign(framesInFlight_, 0);
+
+  for (uint32_t i = 0; i < static_cast<uint32_t>(framesInFlight_); i++)
+    ensureInstanceCapacity(i, INITIAL_INSTANCE_CAPACITY);
+
+  // Allocated by the first frame that culls meshlets
+  meshletCommandBuffers_.assign(framesInFlight_, VK_NULL_HANDLE);
+  meshletCommandBuffersMemory_.assign(framesInFlight_, MemoryAllocation{});
+  meshletCommandBuffersMapped_.assign(framesInFlight_, nullptr);
+  meshletCommandCapacity_.assign(framesInFlight_, 0);
 }
 
 void VulkanRenderer::createDescriptorPool() {
-  VkDescriptorPoolSize poolSize{};
-  poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * 2);
+  std::array<VkDescriptorPoolSize, 2> poolSizes{};
+  poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  poolSizes[0].descriptorCount =
+      static_cast<uint32_t>(framesInFlight_ * 2);
+  // Instance, light and cluster buffers in set 0, plus five storage buffers
+  // per cull set
+  poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[1].descriptorCount =
+      static_cast<uint32_t>(framesInFlight_ * 8);
 
   VkDescriptorPoolCreateInfo poolInfo{};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  poolInfo.poolSizeCount = 1;
-  poolInfo.pPoolSizes = &poolSize;
-  poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+  poolInfo.maxSets = static_cast<uint32_t>(framesInFlight_ * 2);
 
   checkVk(vkCreateDescriptorPool(device_, &poolInfo, nullptr, &descriptorPool_),
           "Failed to create descriptor pool");
 }
 
 void VulkanRenderer::createDescriptorSets() {
-  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT,
+  std::vector<VkDescriptorSetLayout> layouts(framesInFlight_,
                                              descriptorSetLayout_);
 
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   allocInfo.descriptorPool = descriptorPool_;
-  allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  allocInfo.descriptorSetCount = static_cast<uint32_t>(framesInFlight_);
   allocInfo.pSetLayouts = layouts.data();
 
-  descriptorSets_.resize(MAX_FRAMES_IN_FLIGHT);
+  descriptorSets_.resize(framesInFlight_);
   checkVk(vkAllocateDescriptorSets(device_, &allocInfo, descriptorSets_.data()),
           "Failed to allocate descriptor sets");
 
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (int i = 0; i < framesInFlight_; i++) {
     VkDescriptorBufferInfo uboInfo{};
     uboInfo.buffer = uniformBuffers_[i];
     uboInfo.offset = 0;
@@ -1520,11 +2590,26 @@ void VulkanRenderer::createDescriptorSets() {
 
     vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes.size()),
                            writes.data(), 0, nullptr);
+
+    writeInstanceDescriptor(static_cast<uint32_t>(i));
+    writeLightDescriptors(static_cast<uint32_t>(i));
   }
+
+  if (!cullDescriptorSetLayout_)
+    return;
+
+  std::vector<VkDescriptorSetLayout> cullLayouts(framesInFlight_,
+                                                 cullDescriptorSetLayout_);
+  allocInfo.pSetLayouts = cullLayouts.data();
+  cullDescriptorSets_.resize(framesInFlight_);
+  checkVk(
+      vkAllocateDescriptorSets(device_, &allocInfo, cullDescriptorSets_.data()),
+      "Failed to allocate cull descriptor sets");
+  cullDescriptorsDirty_.assign(framesInFlight_, true);
 }
 
 void VulkanRenderer::createCommandBuffers() {
-  commandBuffers_.resize(MAX_FRAMES_IN_FLIGHT);
+  commandBuffers_.resize(framesInFlight_);
 
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1537,9 +2622,9 @@ void VulkanRenderer::createCommandBuffers() {
 }
 
 void VulkanRenderer::createSyncObjects() {
-  imageAvailableSemaphores_.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores_.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences_.resize(MAX_FRAMES_IN_FLIGHT);
+  imageAvailableSemaphores_.resize(framesInFlight_);
+  renderFinishedSemaphores_.resize(framesInFlight_);
+  inFlightFences_.resize(framesInFlight_);
 
   VkSemaphoreCreateInfo semaphoreInfo{};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -1548,7 +2633,7 @@ void VulkanRenderer::createSyncObjects() {
   fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (int i = 0; i < framesInFlight_; i++) {
     checkVk(vkCreateSemaphore(device_, &semaphoreInfo, nullptr,
                               &imageAvailableSemaphores_[i]),
             "Failed to create semaphore");
@@ -1571,9 +2656,7 @@ void VulkanRenderer::cleanupSwapchain() {
   if (depthImage_)
     vkDestroyImage(device_, depthImage_, nullptr);
   depthImage_ = VK_NULL_HANDLE;
-  if (depthImageMemory_)
-    vkFreeMemory(device_, depthImageMemory_, nullptr);
-  depthImageMemory_ = VK_NULL_HANDLE;
+  memoryAllocator_.free(depthImageMemory_);
 
   for (auto fb : swapchainFramebuffers_)
     vkDestroyFramebuffer(device_, fb, nullptr);
@@ -1583,6 +2666,15 @@ void VulkanRenderer::cleanupSwapchain() {
     vkDestroyImageView(device_, iv, nullptr);
   swapchainImageViews_.clear();
 
+  if (headless_) {
+    for (VkImage image : swapchainImages_)
+      vkDestroyImage(device_, image, nullptr);
+    swapchainImages_.clear();
+    for (auto &memory : offscreenImagesMemory_)
+      memoryAllocator_.free(memory);
+    offscreenImagesMemory_.clear();
+  }
+
   if (swapchain_)
     vkDestroySwapchainKHR(device_, swapchain_, nullptr);
   swapchain_ = VK_NULL_HANDLE;
@@ -1606,6 +2698,113 @@ void VulkanRenderer::recreateSwapchain() {
   createFramebuffers();
 }
 
+// ---------------------------------------------------------------------------
+// Headless rendering
+// ---------------------------------------------------------------------------
+
+// Stands in for the swapchain: the rest of the renderer only sees
+// swapchainImages_/swapchainImageViews_/swapchainExtent_
+void VulkanRenderer::createOffscreenTargets() {
+  swapchainFormat_ = VK_FORMAT_R8G8B8A8_SRGB;
+  swapchainExtent_ = {static_cast<uint32_t>(width_),
+                      static_cast<uint32_t>(height_)};
+
+  swapchainImages_.resize(framesInFlight_);
+  offscreenImagesMemory_.resize(framesInFlight_);
+  for (int i = 0; i < framesInFlight_; i++) {
+    createImage(swapchainExtent_.width, swapchainExtent_.height,
+                swapchainFormat_, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_ATTACHMENT,
+                swapchainImages_[i], offscreenImagesMemory_[i]);
+  }
+  createImageViews();
+}
+
+void VulkanRenderer::setFrameDumpDirectory(const char *directory) {
+  frameDumpDirectory_ = directory ? directory : "";
+  frameDumpIndex_ = 0;
+}
+
+// Copies the finished frame into this frame's host-visible readback buffer.
+// The render pass's outgoing dependency orders the copy after the color
+// writes.
+void VulkanRenderer::recordFrameReadback(VkCommandBuffer commandBuffer,
+                                         uint32_t imageIndex) {
+  if (readbackBuffers_.empty()) {
+    VkDeviceSize size = static_cast<VkDeviceSize>(swapchainExtent_.width) *
+                        swapchainExtent_.height * 4;
+    readbackBuffers_.resize(framesInFlight_);
+    readbackBuffersMemory_.resize(framesInFlight_);
+    for (int i = 0; i < framesInFlight_; i++) {
+      createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                   MEMORY_STAGING, readbackBuffers_[i],
+                   readbackBuffersMemory_[i]);
+    }
+  }
+
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {swapchainExtent_.width, swapchainExtent_.height, 1};
+  vkCmdCopyImageToBuffer(commandBuffer, swapchainImages_[imageIndex],
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         readbackBuffers_[currentFrame_], 1, &region);
+
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr,
+                       0, nullptr);
+}
+
+// Waits for the frame and writes it as a binary PPM. Stalls the pipeline,
+// so frame dumps are for inspecting output, not for timing.
+void VulkanRenderer::writeFrameDump(uint32_t frame) {
+  if (readbackBuffers_.size() <= frame)
+    return;
+  vkWaitForFences(device_, 1, &inFlightFences_[frame], VK_TRUE, UINT64_MAX);
+
+  char name[32];
+  snprintf(name, sizeof(name), "/frame_%05u.ppm", frameDumpIndex_++);
+  std::string path = frameDumpDirectory_ + name;
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Warning: could not write " << path << std::endl;
+    return;
+  }
+
+  uint32_t w = swapchainExtent_.width;
+  uint32_t h = swapchainExtent_.height;
+  file << "P6\n" << w << " " << h << "\n255\n";
+  const auto *pixels =
+      static_cast<const uint8_t *>(readbackBuffersMemory_[frame].mapped);
+  std::vector<char> row(w * 3);
+  for (uint32_t y = 0; y < h; y++) {
+    const uint8_t *src = pixels + static_cast<size_t>(y) * w * 4;
+    for (uint32_t x = 0; x < w; x++) {
+      row[x * 3 + 0] = static_cast<char>(src[x * 4 + 0]);
+      row[x * 3 + 1] = static_cast<char>(src[x * 4 + 1]);
+      row[x * 3 + 2] = static_cast<char>(src[x * 4 + 2]);
+    }
+    file.write(row.data(), static_cast<std::streamsize>(row.size()));
+  }
+}
+
+void VulkanRenderer::destroyReadbackBuffers() {
+  for (size_t i = 0; i < readbackBuffers_.size(); i++) {
+    vkDestroyBuffer(device_, readbackBuffers_[i], nullptr);
+    memoryAllocator_.free(readbackBuffersMemory_[i]);
+  }
+  readbackBuffers_.clear();
+  readbackBuffersMemory_.clear();
+}
+
 // ---------------------------------------------------------------------------
 // Helpers
 // ---------------------------------------------------------------------------
@@ -1623,103 +2822,327 @@ VulkanRenderer::createShaderModule(const std::vector<char> &code) const {
   return shaderModule;
 }
 
-uint32_t
-VulkanRenderer::findMemoryType(uint32_t typeFilter,
-                               VkMemoryPropertyFlags properties) const {
-  VkPhysicalDeviceMemoryProperties memProperties;
-  vkGetPhysicalDeviceMemoryProperties(physicalDevice_, &memProperties);
-
-  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-    if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags &
-                                    properties) == properties) {
-      return i;
-    }
-  }
-  throw std::runtime_error("Failed to find suitable memory type");
-}
-
 void VulkanRenderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                                   VkMemoryPropertyFlags properties,
-                                  VkBuffer &buffer,
-                                  VkDeviceMemory &memory) const {
+                                  MemoryCategory category, VkBuffer &buffer,
+                                  MemoryAllocation &memory,
+                                  bool sharedWithUploadQueue) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
   bufferInfo.usage = usage;
   bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+  // Written by the transfer queue while the graphics queue reads other
+  // ranges, so no single family can own it
+  uint32_t families[] = {queueFamilies_.graphicsFamily.value_or(0),
+                         uploadFamily_};
+  if (sharedWithUploadQueue && dedicatedTransfer_) {
+    bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    bufferInfo.queueFamilyIndexCount = 2;
+    bufferInfo.pQueueFamilyIndices = families;
+  }
+
   checkVk(vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer),
           "Failed to create buffer");
 
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex =
-      findMemoryType(memRequirements.memoryTypeBits, properties);
+  memory =
+      memoryAllocator_.allocate(memRequirements, properties, category, true);
+  checkVk(vkBindBufferMemory(device_, buffer, memory.memory, memory.offset),
+          "Failed to bind buffer memory");
+}
 
-  checkVk(vkAllocateMemory(device_, &allocInfo, nullptr, &memory),
-          "Failed to allocate buffer memory");
+// ---------------------------------------------------------------------------
+// Staging ring + batched uploads
+// ---------------------------------------------------------------------------
 
-  vkBindBufferMemory(device_, buffer, memory, 0);
+void VulkanRenderer::createStagingRing(VkDeviceSize capacity) {
+  createBuffer(capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               MEMORY_STAGING, stagingRing_.buffer, stagingRing_.memory);
+  stagingRing_.mapped = static_cast<uint8_t *>(stagingRing_.memory.mapped);
+  stagingRing_.capacity = capacity;
+  stagingRing_.head = 0;
+  stagingRing_.tail = 0;
 }
 
-VkCommandBuffer VulkanRenderer::beginOneTimeCommands() {
-  VkCommandBufferAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandPool = commandPool_;
-  allocInfo.commandBufferCount = 1;
+void VulkanRenderer::destroyStagingRing() {
+  if (stagingRing_.buffer)
+    vkDestroyBuffer(device_, stagingRing_.buffer, nullptr);
+  memoryAllocator_.free(stagingRing_.memory);
+  stagingRing_ = StagingRing{};
+}
 
-  VkCommandBuffer cmd;
-  vkAllocateCommandBuffers(device_, &allocInfo, &cmd);
+// Carves `size` bytes out of the free part of the ring. Allocations never
+// straddle the end: if the tail end is too small the allocation wraps to 0.
+bool VulkanRenderer::allocateStaging(VkDeviceSize size, VkDeviceSize &offset) {
+  StagingRing &ring = stagingRing_;
+  bool empty = uploadsInFlight_.empty() && !uploadBatchStaged_;
+  if (empty) {
+    ring.head = 0;
+    ring.tail = 0;
+  }
+
+  if (empty || ring.head > ring.tail) {
+    if (ring.head + size <= ring.capacity) {
+      offset = ring.head;
+      ring.head += size;
+      return true;
+    }
+    if (size <= ring.tail) {
+      offset = 0;
+      ring.head = size;
+      return true;
+    }
+    return false;
+  }
+  // head <= tail: the free space is the gap between them (none if equal)
+  if (ring.head + size <= ring.tail) {
+    offset = ring.head;
+    ring.head += size;
+    return true;
+  }
+  return false;
+}
+
+// Copies `data` into the ring and returns its offset in stagingRing_.buffer.
+// When the ring is full this submits the open batch and/or waits for the
+// oldest batch in flight, so callers must fetch uploadCommands() afterwards.
+VkDeviceSize VulkanRenderer::stageUpload(const void *data, VkDeviceSize size) {
+  VkDeviceSize alignedSize =
+      (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+  // Oversized upload: drain everything and replace the ring with a larger one
+  if (alignedSize > stagingRing_.capacity) {
+    submitUploads();
+    waitForUploads();
+    VkDeviceSize capacity = stagingRing_.capacity;
+    while (capacity < alignedSize)
+      capacity *= 2;
+    destroyStagingRing();
+    createStagingRing(capacity);
+  }
+
+  VkDeviceSize offset;
+  while (!allocateStaging(alignedSize, offset)) {
+    if (!uploadsInFlight_.empty())
+      reclaimUploads(true);
+    else
+      submitUploads();
+  }
+
+  memcpy(stagingRing_.mapped + offset, data, static_cast<size_t>(size));
+  uploadBatchStaged_ = true;
+  return offset;
+}
+
+// Returns the open upload command buffer, beginning a new batch if needed
+VkCommandBuffer VulkanRenderer::uploadCommands() {
+  if (uploadBatch_.commandBuffer)
+    return uploadBatch_.commandBuffer;
+
+  if (!freeUploadBatches_.empty()) {
+    uploadBatch_ = freeUploadBatches_.back();
+    freeUploadBatches_.pop_back();
+    vkResetFences(device_, 1, &uploadBatch_.fence);
+  } else {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = uploadCommandPool_;
+    allocInfo.commandBufferCount = 1;
+    checkVk(vkAllocateCommandBuffers(device_, &allocInfo,
+                                     &uploadBatch_.commandBuffer),
+            "Failed to allocate upload command buffer");
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    checkVk(vkCreateFence(device_, &fenceInfo, nullptr, &uploadBatch_.fence),
+            "Failed to create upload fence");
+  }
 
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-  vkBeginCommandBuffer(cmd, &beginInfo);
-
-  return cmd;
+  checkVk(vkBeginCommandBuffer(uploadBatch_.commandBuffer, &beginInfo),
+          "Failed to begin upload command buffer");
+  return uploadBatch_.commandBuffer;
 }
 
-void VulkanRenderer::endOneTimeCommands(VkCommandBuffer cmd) {
-  vkEndCommandBuffer(cmd);
+// Submits the open batch to the upload queue without waiting. On the
+// graphics queue, later submissions are ordered after it by the batch's own
+// barriers; a transfer queue batch signals a semaphore for the handoff.
+void VulkanRenderer::submitUploads() {
+  PROFILE_FUNCTION();
+  if (!uploadBatch_.commandBuffer)
+    return;
+
+  checkVk(vkEndCommandBuffer(uploadBatch_.commandBuffer),
+          "Failed to record upload command buffer");
+
+  UploadAcquire &acquire = uploadBatch_.acquire;
+  acquire.vertexBuffer = vertexArena_.buffer;
+  acquire.indexBuffer = indexArena_.buffer;
 
   VkSubmitInfo submitInfo{};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &cmd;
+  submitInfo.pCommandBuffers = &uploadBatch_.commandBuffer;
+  if (dedicatedTransfer_) {
+    if (freeUploadSemaphores_.empty()) {
+      VkSemaphoreCreateInfo semaphoreInfo{};
+      semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+      VkSemaphore semaphore;
+      checkVk(vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &semaphore),
+              "Failed to create upload semaphore");
+      freeUploadSemaphores_.push_back(semaphore);
+    }
+    acquire.semaphore = freeUploadSemaphores_.back();
+    freeUploadSemaphores_.pop_back();
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &acquire.semaphore;
+  }
+  checkVk(vkQueueSubmit(uploadQueue_, 1, &submitInfo, uploadBatch_.fence),
+          "Failed to submit uploads");
+
+  // Same queue: submission order already covers the frames that follow
+  if (!dedicatedTransfer_) {
+    uploadsToAcquire_.push_back(std::move(acquire));
+    acquire = UploadAcquire{};
+  }
+
+  uploadBatch_.ringEnd = stagingRing_.head;
+  uploadsInFlight_.push_back(std::move(uploadBatch_));
+  uploadBatch_ = UploadBatch{};
+  uploadBatchStaged_ = false;
+}
+
+// Releases the ring space of completed batches, oldest first. With
+// waitOldest, blocks until at least the oldest batch has completed.
+void VulkanRenderer::reclaimUploads(bool waitOldest) {
+  while (!uploadsInFlight_.empty()) {
+    UploadBatch &batch = uploadsInFlight_.front();
+    if (waitOldest) {
+      vkWaitForFences(device_, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+      waitOldest = false;
+    } else if (vkGetFenceStatus(device_, batch.fence) != VK_SUCCESS) {
+      break;
+    }
+    stagingRing_.tail = batch.ringEnd;
+    if (dedicatedTransfer_)
+      uploadsToAcquire_.push_back(std::move(batch.acquire));
+    batch.acquire = UploadAcquire{};
+    freeUploadBatches_.push_back(std::move(batch));
+    uploadsInFlight_.pop_front();
+  }
+}
 
-  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue_);
+void VulkanRenderer::waitForUploads() {
+  while (!uploadsInFlight_.empty())
+    reclaimUploads(true);
+}
 
-  vkFreeCommandBuffers(device_, commandPool_, 1, &cmd);
+// Makes landed uploads drawable. Runs once per frame before the draw list is
+// built, so everything acquired here is covered by recordUploadAcquires() in
+// the same frame.
+void VulkanRenderer::acquireUploads() {
+  for (auto &acquire : uploadsToAcquire_) {
+    if (acquire.semaphore)
+      uploadWaitSemaphores_.push_back(acquire.semaphore);
+    uploadImageAcquires_.insert(uploadImageAcquires_.end(),
+                                acquire.images.begin(), acquire.images.end());
+    for (int materialId : acquire.materials)
+      materials_[materialId].resident = true;
+    residentMeshCount_ = std::max(residentMeshCount_, acquire.meshCount);
+
+    if (acquire.vertexBuffer)
+      vertexArena_.drawBuffer = acquire.vertexBuffer;
+    if (acquire.indexBuffer)
+      indexArena_.drawBuffer = acquire.indexBuffer;
+    // Outgrown buffers may still be bound by the previous frame
+    for (const auto &replaced : acquire.replaced)
+      retireBuffer(replaced.buffer, replaced.memory);
+  }
+  uploadsToAcquire_.clear();
 }
 
-void VulkanRenderer::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer,
-                                VkDeviceSize size) {
-  VkCommandBuffer cmd = beginOneTimeCommands();
+// Graphics-queue half of the transfer-queue handoff: acquires image
+// ownership and makes new geometry visible to vertex input. The frame's
+// submit waits on the matching semaphores at the transfer stage.
+void VulkanRenderer::recordUploadAcquires(VkCommandBuffer commandBuffer) {
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask =
+      VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+      0, 1, &barrier, 0, nullptr,
+      static_cast<uint32_t>(uploadImageAcquires_.size()),
+      uploadImageAcquires_.data());
+  uploadImageAcquires_.clear();
+}
 
-  VkBufferCopy copyRegion{};
-  copyRegion.size = size;
-  vkCmdCopyBuffer(cmd, srcBuffer, dstBuffer, 1, &copyRegion);
+void VulkanRenderer::destroyUploadBatches() {
+  if (!device_)
+    return;
 
-  endOneTimeCommands(cmd);
+  // An open batch that was never submitted still holds a recording buffer
+  if (uploadBatch_.commandBuffer) {
+    vkEndCommandBuffer(uploadBatch_.commandBuffer);
+    freeUploadBatches_.push_back(uploadBatch_);
+    uploadBatch_ = UploadBatch{};
+  }
+  waitForUploads();
+  for (auto &batch : freeUploadBatches_) {
+    vkFreeCommandBuffers(device_, uploadCommandPool_, 1, &batch.commandBuffer);
+    vkDestroyFence(device_, batch.fence, nullptr);
+  }
+  freeUploadBatches_.clear();
+  uploadBatchStaged_ = false;
+
+  // Landed but never acquired: their outgrown arena buffers were never
+  // retired, and their semaphores were never waited on
+  for (auto &acquire : uploadsToAcquire_) {
+    if (acquire.semaphore)
+      freeUploadSemaphores_.push_back(acquire.semaphore);
+    for (auto &replaced : acquire.replaced) {
+      vkDestroyBuffer(device_, replaced.buffer, nullptr);
+      memoryAllocator_.free(replaced.memory);
+    }
+  }
+  uploadsToAcquire_.clear();
+  for (auto &inUse : uploadSemaphoresInUse_) {
+    freeUploadSemaphores_.insert(freeUploadSemaphores_.end(), inUse.begin(),
+                                 inUse.end());
+    inUse.clear();
+  }
+  freeUploadSemaphores_.insert(freeUploadSemaphores_.end(),
+                               uploadWaitSemaphores_.begin(),
+                               uploadWaitSemaphores_.end());
+  uploadWaitSemaphores_.clear();
+  for (VkSemaphore semaphore : freeUploadSemaphores_)
+    vkDestroySemaphore(device_, semaphore, nullptr);
+  freeUploadSemaphores_.clear();
 }
 
 void VulkanRenderer::createImage(uint32_t w, uint32_t h, VkFormat format,
                                  VkImageTiling tiling, VkImageUsageFlags usage,
                                  VkMemoryPropertyFlags properties,
-                                 VkImage &image, VkDeviceMemory &memory) const {
+                                 MemoryCategory category, VkImage &image,
+                                 MemoryAllocation &memory, uint32_t mipLevels) {
   VkImageCreateInfo imageInfo{};
   imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   imageInfo.imageType = VK_IMAGE_TYPE_2D;
   imageInfo.extent.width = w;
   imageInfo.extent.height = h;
   imageInfo.extent.depth = 1;
-  imageInfo.mipLevels = 1;
+  imageInfo.mipLevels = mipLevels;
   imageInfo.arrayLayers = 1;
   imageInfo.format = format;
   imageInfo.tiling = tiling;
@@ -1734,21 +3157,16 @@ void VulkanRenderer::createImage(uint32_t w, uint32_t h, VkFormat format,
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex =
-      findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  checkVk(vkAllocateMemory(device_, &allocInfo, nullptr, &memory),
-          "Failed to allocate image memory");
-
-  vkBindImageMemory(device_, image, memory, 0);
+  memory = memoryAllocator_.allocate(memRequirements, properties, category,
+                                     tiling == VK_IMAGE_TILING_LINEAR);
+  checkVk(vkBindImageMemory(device_, image, memory.memory, memory.offset),
+          "Failed to bind image memory");
 }
 
 VkImageView
 VulkanRenderer::createImageView(VkImage image, VkFormat format,
-                                VkImageAspectFlags aspectFlags) const {
+                                VkImageAspectFlags aspectFlags,
+                                uint32_t mipLevels) const {
   VkImageViewCreateInfo viewInfo{};
   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   viewInfo.image = image;
@@ -1756,7 +3174,7 @@ VulkanRenderer::createImageView(VkImage image, VkFormat format,
   viewInfo.format = format;
   viewInfo.subresourceRange.aspectMask = aspectFlags;
   viewInfo.subresourceRange.baseMipLevel = 0;
-  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.levelCount = mipLevels;
   viewInfo.subresourceRange.baseArrayLayer = 0;
   viewInfo.subresourceRange.layerCount = 1;
 
@@ -1781,11 +3199,38 @@ VkFormat VulkanRenderer::findDepthFormat() const {
 
 void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
                                          uint32_t imageIndex) {
+  PROFILE_FUNCTION();
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   checkVk(vkBeginCommandBuffer(commandBuffer, &beginInfo),
           "Failed to begin command buffer");
 
+  bool statistics = statisticsActive();
+  if (timestampsSupported_)
+    vkCmdResetQueryPool(commandBuffer, timestampPools_[currentFrame_], 0,
+                        GPU_TIMESTAMP_COUNT);
+  if (statistics)
+    vkCmdResetQueryPool(commandBuffer, statisticsPools_[currentFrame_], 0, 1);
+
+  if (!uploadWaitSemaphores_.empty())
+    recordUploadAcquires(commandBuffer);
+
+  writeTimestamp(commandBuffer, GPU_TIMESTAMP_FRAME_BEGIN);
+
+  // Compute culling must finish before the render pass reads its output
+  if (gpuCulling_)
+    recordCullPass(commandBuffer);
+
+  // With more than one record thread the pass contents come from secondary
+  // command buffers recorded in parallel
+  bool parallel = recordThreads_ > 1;
+  if (parallel)
+    recordSecondaries(currentFrame_, imageIndex, recordThreads_);
+
+  writeTimestamp(commandBuffer, GPU_TIMESTAMP_SCENE_BEGIN);
+  if (statistics)
+    vkCmdBeginQuery(commandBuffer, statisticsPools_[currentFrame_], 0, 0);
+
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   renderPassInfo.renderPass = renderPass_;
@@ -1800,10 +3245,95 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   renderPassInfo.pClearValues = clearValues.data();
 
   vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
-                       VK_SUBPASS_CONTENTS_INLINE);
+                       parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                                : VK_SUBPASS_CONTENTS_INLINE);
+
+  if (parallel) {
+    if (!recordTaskBuffers_.empty())
+      vkCmdExecuteCommands(commandBuffer,
+                           static_cast<uint32_t>(recordTaskBuffers_.size()),
+                           recordTaskBuffers_.data());
+  } else {
+    DrawState state;
+    bindSceneState(commandBuffer, state);
+    if (gpuCulling_)
+      recordIndirectDraws(commandBuffer, state);
+    size_t debugStart = debugBatchStart();
+    recordDrawBatches(commandBuffer, 0, debugStart, state);
+    writeTimestamp(commandBuffer, GPU_TIMESTAMP_DEBUG_BEGIN);
+    recordDrawBatches(commandBuffer, debugStart, drawList_.size() - debugStart,
+                      state);
+    renderStats_ = state.stats;
+
+    // UI overlay (rendered on top of 3D scene, within same render pass)
+    writeTimestamp(commandBuffer, GPU_TIMESTAMP_UI_BEGIN);
+    if (debugOverlayEnabled_ && uiVertexCount_ > 0) {
+      recordUICommands(commandBuffer);
+    }
+  }
 
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    graphicsPipeline_);
+  vkCmdEndRenderPass(commandBuffer);
+
+  if (statistics)
+    vkCmdEndQuery(commandBuffer, statisticsPools_[currentFrame_], 0);
+  writeTimestamp(commandBuffer, GPU_TIMESTAMP_FRAME_END);
+  if (!timestampsWritten_.empty()) {
+    timestampsWritten_[currentFrame_] = timestampsSupported_;
+    statisticsWritten_[currentFrame_] = statistics;
+  }
+
+  if (headless_ && !frameDumpDirectory_.empty())
+    recordFrameReadback(commandBuffer, imageIndex);
+
+  checkVk(vkEndCommandBuffer(commandBuffer), "Failed to record command buffer");
+}
+
+// Bind state only when it changes; the draw list is sorted so that pipeline,
+// then material, changes as rarely as possible
+void VulkanRenderer::bindPipelineCached(VkCommandBuffer commandBuffer,
+                                        DrawState &state, VkPipeline pipeline) {
+  if (pipeline == state.pipeline) {
+    state.stats.skippedBinds++;
+    return;
+  }
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+  state.pipeline = pipeline;
+  state.stats.pipelineBinds++;
+}
+
+void VulkanRenderer::bindMaterialCached(VkCommandBuffer commandBuffer,
+                                        DrawState &state, int materialId) {
+  // Textures still in flight draw with the default material
+  if (!materials_[materialId].resident)
+    materialId = defaultMaterialId_;
+  if (materialId == state.materialId) {
+    state.stats.skippedBinds++;
+    return;
+  }
+  VkDescriptorSet matSet = materials_[materialId].descriptorSet;
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          pipelineLayout_, 1, 1, &matSet, 0, nullptr);
+  state.materialId = materialId;
+  state.stats.descriptorBinds++;
+}
+
+// The index arena is bound at offset 0 either way; each mesh's indexOffset is
+// already in units of its own index type
+void VulkanRenderer::bindIndexTypeCached(VkCommandBuffer commandBuffer,
+                                         DrawState &state,
+                                         VkIndexType indexType) {
+  if (static_cast<int>(indexType) == state.indexType) {
+    state.stats.skippedBinds++;
+    return;
+  }
+  vkCmdBindIndexBuffer(commandBuffer, indexArena_.drawBuffer, 0, indexType);
+  state.indexType = static_cast<int>(indexType);
+  state.stats.bufferBinds++;
+}
+
+void VulkanRenderer::bindSceneState(VkCommandBuffer commandBuffer,
+                                    DrawState &state) {
+  bindPipelineCached(commandBuffer, state, graphicsPipeline_);
 
   VkViewport viewport{};
   viewport.x = 0.0f;
@@ -1819,121 +3349,1509 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   scissor.extent = swapchainExtent_;
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-  VkBuffer vertexBuffers[] = {vertexBuffer_};
-  VkDeviceSize offsets[] = {0};
-  vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-  vkCmdBindIndexBuffer(commandBuffer, indexBuffer_, 0, VK_INDEX_TYPE_UINT32);
+  // Null until the first geometry upload lands; nothing is drawn until then
+  if (vertexArena_.drawBuffer) {
+    VkBuffer vertexBuffers[] = {vertexArena_.drawBuffer};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+  }
   vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                           pipelineLayout_, 0, 1,
                           &descriptorSets_[currentFrame_], 0, nullptr);
+  state.stats.bufferBinds += vertexArena_.drawBuffer ? 1 : 0;
+  state.stats.descriptorBinds++;
+}
+
+void VulkanRenderer::recordIndirectDraws(VkCommandBuffer commandBuffer,
+                                         DrawState &state) {
+  // Instance counts were filled in by cull.comp; meshes with no visible
+  // instances draw nothing
+  const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+  if (residentMeshCount_ == 0)
+    return;
+  uint32_t maxDrawCount =
+      multiDrawIndirectSupported_ ? deviceLimits_.maxDrawIndirectCount : 1;
+  for (const auto &group : gpuDrawGroups_) {
+    bindIndexTypeCached(commandBuffer, state, group.indexType);
+    bindMaterialCached(commandBuffer, state, group.materialId);
+    for (uint32_t i = 0; i < group.commandCount; i += maxDrawCount) {
+      uint32_t drawCount = std::min(maxDrawCount, group.commandCount - i);
+      vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffers_[currentFrame_],
+                               (group.firstCommand + i) * stride, drawCount,
+                               static_cast<uint32_t>(stride));
+      state.stats.drawCalls++;
+    }
+  }
+}
+
+// Commands were built by cullMeshlets(). Without drawIndirectFirstInstance
+// the same commands are issued one by one from the CPU copy.
+void VulkanRenderer::recordMeshletDraws(VkCommandBuffer commandBuffer,
+                                        const DrawBatch &batch,
+                                        DrawState &state) {
+  state.stats.instances += static_cast<int>(batch.instanceCount);
+  if (!drawIndirectFirstInstanceSupported_) {
+    for (uint32_t i = 0; i < batch.commandCount; i++) {
+      const VkDrawIndexedIndirectCommand &cmd =
+          meshletCommands_[batch.firstCommand + i];
+      vkCmdDrawIndexed(commandBuffer, cmd.indexCount, cmd.instanceCount,
+                       cmd.firstIndex, cmd.vertexOffset, cmd.firstInstance);
+      state.stats.drawCalls++;
+    }
+    return;
+  }
+
+  const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+  uint32_t maxDrawCount =
+      multiDrawIndirectSupported_ ? deviceLimits_.maxDrawIndirectCount : 1;
+  for (uint32_t i = 0; i < batch.commandCount; i += maxDrawCount) {
+    uint32_t drawCount = std::min(maxDrawCount, batch.commandCount - i);
+    vkCmdDrawIndexedIndirect(commandBuffer,
+                             meshletCommandBuffers_[currentFrame_],
+                             (batch.firstCommand + i) * stride, drawCount,
+                             static_cast<uint32_t>(stride));
+    state.stats.drawCalls++;
+  }
+}
+
+// Sorted draw list: the whole scene on the CPU path, debug wireframes only
+// when culling on the GPU. Model matrices were written to this frame's
+// instance buffer by prepareInstances().
+void VulkanRenderer::recordDrawBatches(VkCommandBuffer commandBuffer,
+                                       size_t firstBatch, size_t batchCount,
+                                       DrawState &state) {
+  for (size_t i = firstBatch; i < firstBatch + batchCount; i++) {
+    const DrawBatch &batch = drawList_[i];
+    const MeshData &mesh = meshes_[batch.meshId];
+    bindPipelineCached(commandBuffer, state,
+                       batch.pipeline == DRAW_PIPELINE_DEBUG ? debugPipeline_
+                                                             : graphicsPipeline_);
+    bindMaterialCached(commandBuffer, state, mesh.materialId);
+    bindIndexTypeCached(commandBuffer, state, mesh.indexType);
+
+    if (batch.meshletCulled) {
+      recordMeshletDraws(commandBuffer, batch, state);
+      continue;
+    }
+
+    const MeshLod &lod = mesh.lods[batch.lod];
+    vkCmdDrawIndexed(commandBuffer, lod.indexCount, batch.instanceCount,
+                     lod.indexOffset, mesh.vertexOffset, batch.firstInstance);
+    state.stats.drawCalls++;
+    state.stats.instances += static_cast<int>(batch.instanceCount);
+  }
+}
+
+void VulkanRenderer::setCamera(float eyeX, float eyeY, float eyeZ,
+                               float targetX, float targetY, float targetZ,
+                               float upX, float upY, float upZ,
+                               float fovDegrees) {
+  cameraEye_ = glm::vec3(eyeX, eyeY, eyeZ);
+  cameraTarget_ = glm::vec3(targetX, targetY, targetZ);
+  cameraUp_ = glm::vec3(upX, upY, upZ);
+  cameraFov_ = fovDegrees;
+}
+
+void VulkanRenderer::getCursorPos(double &x, double &y) const {
+  x = 0.0;
+  y = 0.0;
+  if (window_)
+    glfwGetCursorPos(window_, &x, &y);
+}
+
+void VulkanRenderer::setCursorLocked(bool locked) {
+  cursorLocked_ = locked;
+  if (window_)
+    glfwSetInputMode(window_, GLFW_CURSOR,
+                     locked ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+}
+
+bool VulkanRenderer::isCursorLocked() const { return cursorLocked_; }
+
+int VulkanRenderer::isMouseButtonPressed(int button) const {
+  if (!window_)
+    return 0;
+  return glfwGetMouseButton(window_, button) == GLFW_PRESS ? 1 : 0;
+}
+
+void VulkanRenderer::getScrollOffset(float &x, float &y) const {
+  x = scrollOffsetX_;
+  y = scrollOffsetY_;
+}
+
+void VulkanRenderer::resetScrollOffset() {
+  scrollOffsetX_ = 0.0f;
+  scrollOffsetY_ = 0.0f;
+}
+
+void VulkanRenderer::updateTime() {
+  // steady_clock rather than glfwGetTime(), which needs glfwInit()
+  double now = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+                   .count();
+  if (lastFrameTime_ == 0.0) {
+    lastFrameTime_ = now;
+    return;
+  }
+  deltaTime_ = static_cast<float>(now - lastFrameTime_);
+  lastFrameTime_ = now;
+  totalTime_ += deltaTime_;
+}
+
+float VulkanRenderer::getDeltaTime() const { return deltaTime_; }
+float VulkanRenderer::getTotalTime() const { return totalTime_; }
+
+void VulkanRenderer::updateUniformBuffer(uint32_t currentImage) {
+  PROFILE_FUNCTION();
+  float aspect = static_cast<float>(swapchainExtent_.width) /
+                 static_cast<float>(swapchainExtent_.height);
+
+  UniformBufferObject ubo{};
+  ubo.view = glm::lookAt(cameraEye_, cameraTarget_, cameraUp_);
+  ubo.proj = glm::perspective(glm::radians(cameraFov_), aspect, CAMERA_NEAR,
+                              CAMERA_FAR);
+  ubo.proj[1][1] *= -1; // Vulkan Y-flip
+
+  memcpy(uniformBuffersMapped_[currentImage], &ubo, sizeof(ubo));
+
+  frustum_ = Frustum::fromMatrix(ubo.proj * ubo.view);
+
+  updateLights(currentImage, ubo.view);
+}
+
+// ---------------------------------------------------------------------------
+// Light clustering
+// ---------------------------------------------------------------------------
+
+void VulkanRenderer::updateLights(uint32_t frame, const glm::mat4 &view) {
+  PROFILE_FUNCTION();
+  // Directional and unbounded lights reach every fragment and go first; the
+  // rest are only listed in the clusters they overlap
+  auto *packed = static_cast<GpuLight *>(lightStorageBuffersMapped_[frame]);
+  uint32_t lightCount = 0;
+  clusterLights_.clear();
+  for (int i = 0; i < lightSlotCount_; i++) {
+    const GpuLight &light = lights_[i];
+    if (light.color.w > 0.0f &&
+        (light.type == LIGHT_DIRECTIONAL || light.radius <= 0.0f))
+      packed[lightCount++] = light;
+  }
+  uint32_t globalCount = lightCount;
+  for (int i = 0; i < lightSlotCount_; i++) {
+    const GpuLight &light = lights_[i];
+    if (light.color.w > 0.0f && light.type != LIGHT_DIRECTIONAL &&
+        light.radius > 0.0f) {
+      packed[lightCount++] = light;
+      clusterLights_.push_back({glm::vec3(light.position), light.radius});
+    }
+  }
+
+  lightClusters_.setProjection(swapchainExtent_.width, swapchainExtent_.height,
+                               glm::radians(cameraFov_), CAMERA_NEAR,
+                               CAMERA_FAR);
+  lightClusters_.build(clusterLights_, view, globalCount);
+
+  const std::vector<ClusterRange> &ranges = lightClusters_.getRanges();
+  const std::vector<uint32_t> &indices = lightClusters_.getIndices();
+  ensureClusterCapacity(frame, static_cast<uint32_t>(indices.size()));
+  auto *clusterData = static_cast<char *>(clusterBuffersMapped_[frame]);
+  memcpy(clusterData, ranges.data(), sizeof(ClusterRange) * CLUSTER_COUNT);
+  if (!indices.empty())
+    memcpy(clusterData + sizeof(ClusterRange) * CLUSTER_COUNT, indices.data(),
+           sizeof(uint32_t) * indices.size());
+
+  lightData_.cameraPos = glm::vec4(cameraEye_, 1.0f);
+  lightData_.cameraForward =
+      glm::vec4(glm::normalize(cameraTarget_ - cameraEye_), 0.0f);
+  lightData_.clusterParams = lightClusters_.getShaderParams();
+  lightData_.numLights = static_cast<int>(lightCount);
+  lightData_.globalLightCount = static_cast<int>(globalCount);
+  memcpy(lightBuffersMapped_[frame], &lightData_, sizeof(lightData_));
+}
+
+void VulkanRenderer::ensureClusterCapacity(uint32_t frame,
+                                           uint32_t indexCount) {
+  // Same geometric growth as the instance buffers; the frame's fence has
+  // signaled, so the old buffer is idle
+  if (indexCount <= clusterIndexCapacity_[frame])
+    return;
+  uint32_t capacity =
+      std::max(clusterIndexCapacity_[frame], INITIAL_CLUSTER_INDEX_CAPACITY);
+  while (capacity < indexCount)
+    capacity *= 2;
+
+  destroyMappedBuffer(clusterBuffers_[frame], clusterBuffersMemory_[frame],
+                      clusterBuffersMapped_[frame]);
+  createMappedBuffer(sizeof(ClusterRange) * CLUSTER_COUNT +
+                         sizeof(uint32_t) * capacity,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, clusterBuffers_[frame],
+                     clusterBuffersMemory_[frame], clusterBuffersMapped_[frame]);
+  clusterIndexCapacity_[frame] = capacity;
+
+  writeLightDescriptors(frame);
+}
+
+void VulkanRenderer::writeLightDescriptors(uint32_t frame) {
+  // Descriptor sets are created after the initial buffers
+  if (descriptorSets_.size() <= frame || !clusterBuffers_[frame])
+    return;
+
+  VkDescriptorBufferInfo lightInfo{};
+  lightInfo.buffer = lightStorageBuffers_[frame];
+  lightInfo.offset = 0;
+  lightInfo.range = VK_WHOLE_SIZE;
+
+  VkDescriptorBufferInfo clusterInfo{};
+  clusterInfo.buffer = clusterBuffers_[frame];
+  clusterInfo.offset = 0;
+  clusterInfo.range = VK_WHOLE_SIZE;
+
+  std::array<VkWriteDescriptorSet, 2> writes{};
+  for (uint32_t i = 0; i < 2; i++) {
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = descriptorSets_[frame];
+    writes[i].dstBinding = 3 + i;
+    writes[i].dstArrayElement = 0;
+    writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[i].descriptorCount = 1;
+  }
+  writes[0].pBufferInfo = &lightInfo;
+  writes[1].pBufferInfo = &clusterInfo;
+
+  vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes.size()),
+                         writes.data(), 0, nullptr);
+}
+
+// ---------------------------------------------------------------------------
+// Instancing
+// ---------------------------------------------------------------------------
+
+void VulkanRenderer::ensureInstanceCapacity(uint32_t frame,
+                                            uint32_t instanceCount) {
+  if (instanceCount <= instanceCapacity_[frame])
+    return;
+
+  // Grow geometrically. Only called once this frame's fence has signaled, so
+  // the old buffer is no longer referenced by in-flight work.
+  uint32_t capacity = std::max(instanceCapacity_[frame], 1u);
+  while (capacity < instanceCount)
+    capacity *= 2;
+
+  if (instanceBuffers_[frame]) {
+    vkDestroyBuffer(device_, instanceBuffers_[frame], nullptr);
+    memoryAllocator_.free(instanceBuffersMemory_[frame]);
+  }
+
+  VkDeviceSize bufferSize = sizeof(InstanceData) * capacity;
+  createBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               MEMORY_FRAME_DATA, instanceBuffers_[frame],
+               instanceBuffersMemory_[frame]);
+  instanceBuffersMapped_[frame] = instanceBuffersMemory_[frame].mapped;
+  instanceCapacity_[frame] = capacity;
+
+  writeInstanceDescriptor(frame);
+  if (cullDescriptorsDirty_.size() > frame)
+    cullDescriptorsDirty_[frame] = true;
+}
+
+void VulkanRenderer::writeInstanceDescriptor(uint32_t frame) {
+  // Descriptor sets are created after the initial instance buffers
+  if (descriptorSets_.size() <= frame || !instanceBuffers_[frame])
+    return;
+
+  VkDescriptorBufferInfo instanceInfo{};
+  instanceInfo.buffer = instanceBuffers_[frame];
+  instanceInfo.offset = 0;
+  instanceInfo.range = VK_WHOLE_SIZE;
+
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = descriptorSets_[frame];
+  write.dstBinding = 2;
+  write.dstArrayElement = 0;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  write.descriptorCount = 1;
+  write.pBufferInfo = &instanceInfo;
+
+  vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+}
+
+Aabb VulkanRenderer::computeWorldBounds(const EntityData &ent) const {
+  const MeshData &mesh = meshes_[ent.meshId];
+  const glm::mat4 &m = ent.transform;
+
+  // |M| * extent around the transformed center
+  glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+  glm::vec3 extent = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+  glm::vec3 worldCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+  glm::vec3 worldExtent = glm::abs(glm::vec3(m[0])) * extent.x +
+                          glm::abs(glm::vec3(m[1])) * extent.y +
+                          glm::abs(glm::vec3(m[2])) * extent.z;
+  return {worldCenter - worldExtent, worldCenter + worldExtent};
+}
+
+bool VulkanRenderer::isEntityVisible(const EntityData &ent) const {
+  const MeshData &mesh = meshes_[ent.meshId];
+  const glm::mat4 &m = ent.transform;
+
+  // Sphere test first: scale the radius by the largest axis scale
+  glm::vec3 center = glm::vec3(m * glm::vec4(mesh.boundsCenter, 1.0f));
+  float scale = std::max(glm::length(glm::vec3(m[0])),
+                         std::max(glm::length(glm::vec3(m[1])),
+                                  glm::length(glm::vec3(m[2]))));
+  if (!frustum_.intersectsSphere(center, mesh.boundsRadius * scale))
+    return false;
+
+  Aabb box = computeWorldBounds(ent);
+  return frustum_.intersectsAabb(box.min, box.max);
+}
+
+// Pixels covered by one world unit at distance 1, for the current projection
+float VulkanRenderer::lodPixelScale() const {
+  return static_cast<float>(swapchainExtent_.height) * 0.5f /
+         std::tan(glm::radians(cameraFov_) * 0.5f);
+}
+
+// Coarsest level whose error, projected at the distance of the nearest point
+// of the bounding sphere, stays within lodBias_ pixels. Moving to a coarser
+// level needs it to be a hysteresis fraction under the threshold, moving back
+// needs the current level a fraction over it. Mirrored by selectLod() in
+// cull.comp.
+uint32_t VulkanRenderer::selectLod(const MeshData &mesh,
+                                   const glm::mat4 &transform,
+                                   uint32_t currentLod,
+                                   float pixelScale) const {
+  if (mesh.lodCount <= 1)
+    return 0;
+
+  glm::vec3 center = glm::vec3(transform * glm::vec4(mesh.boundsCenter, 1.0f));
+  float scale = std::max(glm::length(glm::vec3(transform[0])),
+                         std::max(glm::length(glm::vec3(transform[1])),
+                                  glm::length(glm::vec3(transform[2]))));
+  float distance =
+      glm::length(center - cameraEye_) - mesh.boundsRadius * scale;
+  if (distance <= 0.0f)
+    return 0; // camera inside the bounds
+  float pixelsPerUnit = scale * pixelScale / distance;
+
+  uint32_t lod = std::min(currentLod, mesh.lodCount - 1);
+  uint32_t coarser = lod;
+  while (coarser + 1 < mesh.lodCount &&
+         mesh.lods[coarser + 1].error * pixelsPerUnit <=
+             lodBias_ * (1.0f - lodHysteresis_))
+    coarser++;
+  if (coarser > lod)
+    return coarser;
+  while (lod > 0 && mesh.lods[lod].error * pixelsPerUnit >
+                        lodBias_ * (1.0f + lodHysteresis_))
+    lod--;
+  return lod;
+}
+
+void VulkanRenderer::collectVisibleEntities(std::vector<int> &visible) const {
+  visible.clear();
+  // Subtrees fully inside the frustum are accepted without per-entity tests;
+  // leaves on the boundary get the exact sphere/AABB test.
+  entityTree_.query(frustum_, [&](int entityId, bool fullyInside) {
+    if (fullyInside || isEntityVisible(entities_[entityId]))
+      visible.push_back(entityId);
+  });
+}
+
+void VulkanRenderer::appendDrawItems(const std::vector<EntityData> &pool,
+                                     const std::vector<int> &visible,
+                                     uint32_t pipeline) {
+  glm::vec3 forward = glm::normalize(cameraTarget_ - cameraEye_);
+  float pixelScale = lodPixelScale();
+  for (int id : visible) {
+    const EntityData &ent = pool[id];
+    if (static_cast<size_t>(ent.meshId) >= residentMeshCount_)
+      continue; // geometry still uploading
+    const MeshData &mesh = meshes_[ent.meshId];
+    glm::vec3 center =
+        glm::vec3(ent.transform * glm::vec4(mesh.boundsCenter, 1.0f));
+    float depth = glm::dot(center - cameraEye_, forward);
+
+    // Debug wireframes always draw the full mesh
+    uint32_t lod = 0;
+    if (pipeline == DRAW_PIPELINE_SCENE) {
+      lod = selectLod(mesh, ent.transform, ent.lod, pixelScale);
+      entities_[id].lod = lod;
+    }
+    drawItems_.push_back({makeSortKey(pipeline,
+                                      static_cast<uint32_t>(mesh.materialId),
+                                      static_cast<uint32_t>(ent.meshId), lod,
+                                      depth),
+                          static_cast<uint32_t>(id)});
+  }
+}
+
+void VulkanRenderer::buildDrawList(InstanceData *instances,
+                                   uint32_t firstInstance) {
+  drawList_.clear();
+  if (drawItems_.empty())
+    return;
+
+  radixSortDrawItems(drawItems_, drawItemsScratch_);
+
+  // Runs of equal pipeline/material/mesh/LOD (the upper 32 key bits) become
+  // one instanced draw; instances within a run are ordered front to back
+  uint32_t cursor = firstInstance;
+  uint64_t lastState = ~0ull;
+  for (const auto &item : drawItems_) {
+    uint32_t pipeline = static_cast<uint32_t>(item.sortKey >> 62);
+    const EntityData &ent = pipeline == DRAW_PIPELINE_DEBUG
+                                ? debugEntities_[item.entityId]
+                                : entities_[item.entityId];
+    instances[cursor].model = ent.transform;
+
+    // Compare the mesh id too: the key only holds its low 14 bits
+    uint64_t state = item.sortKey >> 32;
+    if (state != lastState || ent.meshId != drawList_.back().meshId) {
+      uint32_t lod = static_cast<uint32_t>(state & 0x3u);
+      drawList_.push_back({pipeline, ent.meshId, lod, cursor, 0});
+      lastState = state;
+    }
+    drawList_.back().instanceCount++;
+    cursor++;
+  }
+}
+
+void VulkanRenderer::prepareInstances(uint32_t frame) {
+  PROFILE_FUNCTION();
+  bool drawDebug = debugOverlayEnabled_ && !debugEntities_.empty();
+
+  // With GPU culling every active entity reserves a slot in each LOD of its
+  // mesh; cull.comp decides which of them are written
+  uint32_t sceneInstances = 0;
+  if (gpuCulling_) {
+    for (size_t i = 0; i < meshes_.size(); i++)
+      sceneInstances += meshEntityCounts_[i] * meshes_[i].lodCount;
+  } else {
+    collectVisibleEntities(visibleEntities_);
+    culledEntityCount_ = entityTree_.getProxyCount() -
+                         static_cast<int>(visibleEntities_.size());
+    sceneInstances = static_cast<uint32_t>(visibleEntities_.size());
+  }
+
+  // Debug wireframes are few and short-lived, so they are tested linearly
+  visibleDebugEntities_.clear();
+  if (drawDebug) {
+    for (size_t i = 0; i < debugEntities_.size(); i++) {
+      if (debugEntities_[i].active && isEntityVisible(debugEntities_[i]))
+        visibleDebugEntities_.push_back(static_cast<int>(i));
+    }
+  }
+
+  ensureInstanceCapacity(
+      frame,
+      sceneInstances + static_cast<uint32_t>(visibleDebugEntities_.size()));
+
+  drawItems_.clear();
+  if (gpuCulling_)
+    uploadGpuCullData(frame);
+  else
+    appendDrawItems(entities_, visibleEntities_, DRAW_PIPELINE_SCENE);
+  appendDrawItems(debugEntities_, visibleDebugEntities_, DRAW_PIPELINE_DEBUG);
+
+  // On the GPU path the scene range is reserved for cull.comp, so the list
+  // (debug only) starts after it
+  auto *instances = static_cast<InstanceData *>(instanceBuffersMapped_[frame]);
+  buildDrawList(instances, gpuCulling_ ? sceneInstances : 0);
+  if (!gpuCulling_)
+    cullMeshlets(frame);
+}
+
+// Tests every meshlet of every visible LOD 0 instance. The frustum planes go
+// into the entity's object space (p' = M^T p) and the camera through the
+// inverse transform, so meshlet bounds are used as stored. Scaling the
+// radius by |p'.xyz| keeps the sphere test exact under non-uniform scale.
+// Back-face culling holds under any transform that doesn't mirror; mirrored
+// entities only get the frustum test.
+void VulkanRenderer::cullMeshlets(uint32_t frame) {
+  PROFILE_FUNCTION();
+  meshletCommands_.clear();
+  meshletStats_ = MeshletStats{};
+  if (!meshletCulling_)
+    return;
+
+  // On the CPU path the draw list starts at instance 0, so a scene batch's
+  // instances are drawItems_[firstInstance, +instanceCount)
+  for (auto &batch : drawList_) {
+    const MeshData &mesh = meshes_[batch.meshId];
+    if (batch.pipeline != DRAW_PIPELINE_SCENE || batch.lod != 0 ||
+        mesh.meshletCount == 0)
+      continue;
+    batch.meshletCulled = true;
+    batch.firstCommand = static_cast<uint32_t>(meshletCommands_.size());
+
+    const Meshlet *meshlets = &meshlets_[mesh.meshletOffset];
+    for (uint32_t i = 0; i < batch.instanceCount; i++) {
+      uint32_t instance = batch.firstInstance + i;
+      const glm::mat4 &transform =
+          entities_[drawItems_[instance].entityId].transform;
+
+      // Planes the whole mesh is inside of can't cull any of its meshlets
+      glm::vec3 center =
+          glm::vec3(transform * glm::vec4(mesh.boundsCenter, 1.0f));
+      float scale = std::max(glm::length(glm::vec3(transform[0])),
+                             std::max(glm::length(glm::vec3(transform[1])),
+                                      glm::length(glm::vec3(transform[2]))));
+      float radius = mesh.boundsRadius * scale;
+      glm::mat4 toObject = glm::transpose(transform);
+      glm::vec4 planes[6];
+      float planeScale[6];
+      int planeCount = 0;
+      for (const auto &plane : frustum_.planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w >= radius)
+          continue;
+        planes[planeCount] = toObject * plane;
+        planeScale[planeCount] = glm::length(glm::vec3(planes[planeCount]));
+        planeCount++;
+      }
+
+      bool mirrored =
+          glm::dot(glm::cross(glm::vec3(transform[0]), glm::vec3(transform[1])),
+                   glm::vec3(transform[2])) < 0.0f;
+      glm::vec3 camera =
+          glm::vec3(glm::inverse(transform) * glm::vec4(cameraEye_, 1.0f));
+      const float cameraPos[3] = {camera.x, camera.y, camera.z};
+
+      // Visible meshlets are adjacent index ranges, so each run of them
+      // becomes one command
+      uint32_t runStart = 0, runCount = 0;
+      auto flushRun = [&]() {
+        if (runCount == 0)
+          return;
+        meshletCommands_.push_back({runCount, 1, mesh.indexOffset + runStart,
+                                    mesh.vertexOffset, instance});
+        runCount = 0;
+      };
+      for (uint32_t m = 0; m < mesh.meshletCount; m++) {
+        const Meshlet &meshlet = meshlets[m];
+        glm::vec3 meshletCenter(meshlet.center[0], meshlet.center[1],
+                                meshlet.center[2]);
+        bool outside = false;
+        for (int p = 0; p < planeCount && !outside; p++)
+          outside = glm::dot(glm::vec3(planes[p]), meshletCenter) +
+                        planes[p].w <
+                    -meshlet.radius * planeScale[p];
+        bool backfacing =
+            !outside && !mirrored && isMeshletBackfacing(meshlet, cameraPos);
+
+        meshletStats_.testedMeshlets++;
+        meshletStats_.testedTriangles += static_cast<int>(meshlet.triangleCount);
+        if (outside || backfacing) {
+          meshletStats_.frustumCulledMeshlets += outside ? 1 : 0;
+          meshletStats_.backfaceCulledMeshlets += backfacing ? 1 : 0;
+          meshletStats_.culledTriangles +=
+              static_cast<int>(meshlet.triangleCount);
+          flushRun();
+          continue;
+        }
+        if (runCount == 0)
+          runStart = meshlet.indexOffset;
+        runCount += meshlet.triangleCount * 3;
+      }
+      flushRun();
+    }
+    batch.commandCount =
+        static_cast<uint32_t>(meshletCommands_.size()) - batch.firstCommand;
+  }
+
+  if (meshletCommands_.empty())
+    return;
+  ensureMeshletCommandCapacity(
+      frame, static_cast<uint32_t>(meshletCommands_.size()));
+  memcpy(meshletCommandBuffersMapped_[frame], meshletCommands_.data(),
+         sizeof(VkDrawIndexedIndirectCommand) * meshletCommands_.size());
+}
+
+void VulkanRenderer::ensureMeshletCommandCapacity(uint32_t frame,
+                                                  uint32_t commandCount) {
+  // Same geometric growth as the instance buffers; the frame's fence has
+  // signaled, so the old buffer is idle
+  if (commandCount <= meshletCommandCapacity_[frame])
+    return;
+  uint32_t capacity =
+      std::max(meshletCommandCapacity_[frame], INITIAL_INSTANCE_CAPACITY);
+  while (capacity < commandCount)
+    capacity *= 2;
+
+  destroyMappedBuffer(meshletCommandBuffers_[frame],
+                      meshletCommandBuffersMemory_[frame],
+                      meshletCommandBuffersMapped_[frame]);
+  createMappedBuffer(sizeof(VkDrawIndexedIndirectCommand) * capacity,
+                     VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                     meshletCommandBuffers_[frame],
+                     meshletCommandBuffersMemory_[frame],
+                     meshletCommandBuffersMapped_[frame]);
+  meshletCommandCapacity_[frame] = capacity;
+}
+
+// ---------------------------------------------------------------------------
+// GPU-driven culling
+// ---------------------------------------------------------------------------
+
+void VulkanRenderer::createCullPipeline() {
+  if (!gpuCullingSupported_) {
+    std::cout << "GPU culling unavailable: needs compute on the graphics "
+                 "queue and drawIndirectFirstInstance"
+              << std::endl;
+    return;
+  }
+
+  std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+  for (uint32_t i = 0; i < bindings.size(); i++) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  checkVk(vkCreateDescriptorSetLayout(device_, &layoutInfo, nullptr,
+                                      &cullDescriptorSetLayout_),
+          "Failed to create cull descriptor set layout");
+
+  VkPushConstantRange pushRange{};
+  pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushRange.offset = 0;
+  pushRange.size = sizeof(CullPushConstants);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &cullDescriptorSetLayout_;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+
+  checkVk(vkCreatePipelineLayout(device_, &pipelineLayoutInfo, nullptr,
+                                 &cullPipelineLayout_),
+          "Failed to create cull pipeline layout");
+
+  auto compShaderCode = readFile("build/shaders/cull.spv");
+  VkShaderModule compModule = createShaderModule(compShaderCode);
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = compModule;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = cullPipelineLayout_;
+
+  checkVk(vkCreateComputePipelines(device_, pipelineCache_, 1, &pipelineInfo,
+                                   nullptr, &cullPipeline_),
+          "Failed to create cull compute pipeline");
+
+  vkDestroyShaderModule(device_, compModule, nullptr);
+}
+
+void VulkanRenderer::createGpuCullBuffers() {
+  // Buffers are allocated lazily by ensureGpuCullCapacity() once GPU culling
+  // is turned on
+  gpuEntityBuffers_.assign(framesInFlight_, VK_NULL_HANDLE);
+  gpuEntityBuffersMemory_.assign(framesInFlight_, MemoryAllocation{});
+  gpuEntityBuffersMapped_.assign(framesInFlight_, nullptr);
+  gpuEntityCapacity_.assign(framesInFlight_, 0);
+  gpuMeshBuffers_.assign(framesInFlight_, VK_NULL_HANDLE);
+  gpuMeshBuffersMemory_.assign(framesInFlight_, MemoryAllocation{});
+  gpuMeshBuffersMapped_.assign(framesInFlight_, nullptr);
+  indirectBuffers_.assign(framesInFlight_, VK_NULL_HANDLE);
+  indirectBuffersMemory_.assign(framesInFlight_, MemoryAllocation{});
+  indirectBuffersMapped_.assign(framesInFlight_, nullptr);
+  gpuMeshCapacity_.assign(framesInFlight_, 0);
+  gpuDirtyEntities_.assign(framesInFlight_, {});
+  gpuEntityFullUpload_.assign(framesInFlight_, true);
+  gpuCulledBase_.assign(framesInFlight_, -1);
+  gpuCommandCount_.assign(framesInFlight_, 0);
+}
+
+void VulkanRenderer::createMappedBuffer(VkDeviceSize size,
+                                        VkBufferUsageFlags usage,
+                                        VkBuffer &buffer,
+                                        MemoryAllocation &memory,
+                                        void *&mapped) {
+  createBuffer(size, usage,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               MEMORY_FRAME_DATA, buffer, memory);
+  mapped = memory.mapped;
+}
+
+void VulkanRenderer::destroyMappedBuffer(VkBuffer &buffer,
+                                         MemoryAllocation &memory,
+                                         void *&mapped) {
+  if (buffer)
+    vkDestroyBuffer(device_, buffer, nullptr);
+  memoryAllocator_.free(memory);
+  buffer = VK_NULL_HANDLE;
+  mapped = nullptr;
+}
+
+void VulkanRenderer::ensureGpuCullCapacity(uint32_t frame,
+                                           uint32_t entityCount,
+                                           uint32_t meshCount) {
+  // Same geometric growth as the instance buffers; the frame's fence has
+  // signaled, so the old buffers are idle
+  if (entityCount > gpuEntityCapacity_[frame]) {
+    uint32_t capacity =
+        std::max(gpuEntityCapacity_[frame], INITIAL_INSTANCE_CAPACITY);
+    while (capacity < entityCount)
+      capacity *= 2;
+
+    destroyMappedBuffer(gpuEntityBuffers_[frame],
+                        gpuEntityBuffersMemory_[frame],
+                        gpuEntityBuffersMapped_[frame]);
+    createMappedBuffer(sizeof(GpuEntity) * capacity,
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       gpuEntityBuffers_[frame], gpuEntityBuffersMemory_[frame],
+                       gpuEntityBuffersMapped_[frame]);
+    gpuEntityCapacity_[frame] = capacity;
+    gpuEntityFullUpload_[frame] = true;
+    cullDescriptorsDirty_[frame] = true;
+  }
+
+  if (meshCount > gpuMeshCapacity_[frame]) {
+    uint32_t capacity = std::max(gpuMeshCapacity_[frame], 64u);
+    while (capacity < meshCount)
+      capacity *= 2;
+
+    destroyMappedBuffer(gpuMeshBuffers_[frame], gpuMeshBuffersMemory_[frame],
+                        gpuMeshBuffersMapped_[frame]);
+    destroyMappedBuffer(indirectBuffers_[frame], indirectBuffersMemory_[frame],
+                        indirectBuffersMapped_[frame]);
+    createMappedBuffer(sizeof(GpuMeshBounds) * capacity,
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       gpuMeshBuffers_[frame], gpuMeshBuffersMemory_[frame],
+                       gpuMeshBuffersMapped_[frame]);
+    createMappedBuffer(sizeof(VkDrawIndexedIndirectCommand) * capacity *
+                           MAX_MESH_LODS,
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                           VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                       indirectBuffers_[frame], indirectBuffersMemory_[frame],
+                       indirectBuffersMapped_[frame]);
+    gpuMeshCapacity_[frame] = capacity;
+    gpuCommandCount_[frame] = 0; // fresh buffer has no counts to read back
+    cullDescriptorsDirty_[frame] = true;
+  }
+}
+
+// Unlike the per-frame buffers this one may still be in use by frames in
+// flight, so a grow retires the old buffer instead of destroying it. Entries
+// are carried over; ones the GPU writes during the copy only lose their
+// hysteresis state.
+void VulkanRenderer::ensureGpuLodStateCapacity(uint32_t entityCount) {
+  if (entityCount <= gpuLodStateCapacity_)
+    return;
+  uint32_t capacity = std::max(gpuLodStateCapacity_, INITIAL_INSTANCE_CAPACITY);
+  while (capacity < entityCount)
+    capacity *= 2;
+
+  VkBuffer buffer;
+  MemoryAllocation memory;
+  void *mapped;
+  createMappedBuffer(sizeof(uint32_t) * capacity,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, buffer, memory,
+                     mapped);
+  memset(mapped, 0, sizeof(uint32_t) * capacity);
+  if (gpuLodStateBuffer_) {
+    memcpy(mapped, gpuLodStateMapped_,
+           sizeof(uint32_t) * gpuLodStateCapacity_);
+    retireBuffer(gpuLodStateBuffer_, gpuLodStateMemory_);
+  }
+  gpuLodStateBuffer_ = buffer;
+  gpuLodStateMemory_ = memory;
+  gpuLodStateMapped_ = mapped;
+  gpuLodStateCapacity_ = capacity;
+  cullDescriptorsDirty_.assign(framesInFlight_, true);
+}
+
+void VulkanRenderer::markGpuEntityDirty(int entityId) {
+  if (!gpuCulling_)
+    return;
+
+  if (gpuEntityDirtyMask_.size() < entities_.size())
+    gpuEntityDirtyMask_.resize(entities_.size(), 0);
+
+  const uint8_t allFrames = (1u << framesInFlight_) - 1;
+  uint8_t &mask = gpuEntityDirtyMask_[entityId];
+  if (mask == allFrames)
+    return;
+  for (uint32_t f = 0; f < static_cast<uint32_t>(framesInFlight_); f++) {
+    if (!(mask & (1u << f)))
+      gpuDirtyEntities_[f].push_back(entityId);
+  }
+  mask = allFrames;
+}
+
+void VulkanRenderer::writeGpuEntity(uint32_t frame, int entityId) {
+  const EntityData &ent = entities_[entityId];
+  GpuEntity &dst =
+      static_cast<GpuEntity *>(gpuEntityBuffersMapped_[frame])[entityId];
+  dst.model = ent.transform;
+  dst.meshId = static_cast<uint32_t>(ent.meshId);
+  dst.active = ent.active ? 1u : 0u;
+}
+
+void VulkanRenderer::rebuildGpuDrawOrder() {
+  // Commands (and their instance ranges) are laid out in index type, then
+  // material order so each (index type, material) pair is one multi-draw
+  gpuDrawOrder_.resize(meshes_.size());
+  for (size_t i = 0; i < meshes_.size(); i++)
+    gpuDrawOrder_[i] = static_cast<int>(i);
+  std::stable_sort(gpuDrawOrder_.begin(), gpuDrawOrder_.end(),
+                   [this](int a, int b) {
+                     const MeshData &ma = meshes_[a];
+                     const MeshData &mb = meshes_[b];
+                     if (ma.indexType != mb.indexType)
+                       return ma.indexType < mb.indexType;
+                     return ma.materialId < mb.materialId;
+                   });
+
+  // A mesh's LODs get consecutive commands, so they share its group
+  gpuDrawGroups_.clear();
+  uint32_t command = 0;
+  for (int meshId : gpuDrawOrder_) {
+    const MeshData &mesh = meshes_[meshId];
+    if (gpuDrawGroups_.empty() ||
+        gpuDrawGroups_.back().indexType != mesh.indexType ||
+        gpuDrawGroups_.back().materialId != mesh.materialId)
+      gpuDrawGroups_.push_back({mesh.indexType, mesh.materialId, command, 0});
+    gpuDrawGroups_.back().commandCount += mesh.lodCount;
+    command += mesh.lodCount;
+  }
+}
+
+void VulkanRenderer::writeCullDescriptors(uint32_t frame) {
+  std::array<VkDescriptorBufferInfo, 5> infos{};
+  infos[0].buffer = gpuEntityBuffers_[frame];
+  infos[1].buffer = gpuMeshBuffers_[frame];
+  infos[2].buffer = indirectBuffers_[frame];
+  infos[3].buffer = instanceBuffers_[frame];
+  infos[4].buffer = gpuLodStateBuffer_;
+
+  std::array<VkWriteDescriptorSet, 5> writes{};
+  for (uint32_t i = 0; i < writes.size(); i++) {
+    infos[i].offset = 0;
+    infos[i].range = VK_WHOLE_SIZE;
+
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = cullDescriptorSets_[frame];
+    writes[i].dstBinding = i;
+    writes[i].dstArrayElement = 0;
+    writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[i].descriptorCount = 1;
+    writes[i].pBufferInfo = &infos[i];
+  }
+
+  vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes.size()),
+                         writes.data(), 0, nullptr);
+}
+
+void VulkanRenderer::uploadGpuCullData(uint32_t frame) {
+  uint32_t entityCount = static_cast<uint32_t>(entities_.size());
+  uint32_t meshCount = static_cast<uint32_t>(meshes_.size());
+  ensureGpuCullCapacity(frame, entityCount, meshCount);
+  ensureGpuLodStateCapacity(entityCount);
+  if (gpuDrawOrder_.size() != meshes_.size())
+    rebuildGpuDrawOrder();
+
+  // This frame's previous cull pass has completed (fence waited), so its
+  // instance counts give the culled count for the overlay before they are
+  // reset below
+  auto *commands =
+      static_cast<VkDrawIndexedIndirectCommand *>(indirectBuffersMapped_[frame]);
+  if (gpuCulledBase_[frame] >= 0) {
+    int visible = 0;
+    for (uint32_t i = 0; i < gpuCommandCount_[frame]; i++)
+      visible += static_cast<int>(commands[i].instanceCount);
+    culledEntityCount_ = gpuCulledBase_[frame] - visible;
+  }
+
+  // Entities: only those changed since this frame's buffer was last written
+  const uint8_t frameBit = static_cast<uint8_t>(1u << frame);
+  if (gpuEntityFullUpload_[frame]) {
+    for (uint32_t i = 0; i < entityCount; i++)
+      writeGpuEntity(frame, static_cast<int>(i));
+    for (auto &mask : gpuEntityDirtyMask_)
+      mask &= ~frameBit;
+    gpuDirtyEntities_[frame].clear();
+    gpuEntityFullUpload_[frame] = false;
+  } else {
+    for (int entityId : gpuDirtyEntities_[frame]) {
+      writeGpuEntity(frame, entityId);
+      gpuEntityDirtyMask_[entityId] &= ~frameBit;
+    }
+    gpuDirtyEntities_[frame].clear();
+  }
+
+  // Mesh bounds and indirect commands, one command per LOD. Each LOD
+  // reserves one instance slot per active entity using the mesh; cull.comp
+  // fills instanceCount.
+  auto *bounds = static_cast<GpuMeshBounds *>(gpuMeshBuffersMapped_[frame]);
+  uint32_t firstInstance = 0;
+  uint32_t commandIndex = 0;
+  for (uint32_t i = 0; i < meshCount; i++) {
+    int meshId = gpuDrawOrder_[i];
+    const MeshData &mesh = meshes_[meshId];
+
+    GpuMeshBounds &b = bounds[meshId];
+    b.sphere = glm::vec4(mesh.boundsCenter, mesh.boundsRadius);
+    b.aabbMin = glm::vec4(mesh.boundsMin, 0.0f);
+    b.aabbMax = glm::vec4(mesh.boundsMax, 0.0f);
+    for (uint32_t lod = 0; lod < MAX_MESH_LODS; lod++)
+      b.lodErrors[lod] = lod < mesh.lodCount ? mesh.lods[lod].error : 0.0f;
+    b.commandIndex = commandIndex;
+    b.lodCount = mesh.lodCount;
+
+    // Meshes whose geometry is still uploading get empty commands
+    bool resident = static_cast<size_t>(meshId) < residentMeshCount_;
+    for (uint32_t lod = 0; lod < mesh.lodCount; lod++) {
+      VkDrawIndexedIndirectCommand &cmd = commands[commandIndex++];
+      cmd.indexCount = resident ? mesh.lods[lod].indexCount : 0;
+      cmd.instanceCount = 0;
+      cmd.firstIndex = mesh.lods[lod].indexOffset;
+      cmd.vertexOffset = mesh.vertexOffset;
+      cmd.firstInstance = firstInstance;
+      firstInstance += meshEntityCounts_[meshId];
+    }
+  }
+  gpuCommandCount_[frame] = commandIndex;
+  gpuCulledBase_[frame] = entityTree_.getProxyCount();
+
+  if (cullDescriptorsDirty_[frame]) {
+    writeCullDescriptors(frame);
+    cullDescriptorsDirty_[frame] = false;
+  }
+}
+
+void VulkanRenderer::recordCullPass(VkCommandBuffer commandBuffer) {
+  uint32_t entityCount = static_cast<uint32_t>(entities_.size());
+
+  CullPushConstants push{};
+  for (int i = 0; i < 6; i++)
+    push.planes[i] = frustum_.planes[i];
+  push.cameraPos = glm::vec4(cameraEye_, lodPixelScale());
+  push.entityCount = entityCount;
+  push.lodThreshold = lodBias_;
+  push.lodHysteresis = lodHysteresis_;
+
+  // The previous frame's pass may still be writing the shared LOD state
+  VkMemoryBarrier lodBarrier{};
+  lodBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  lodBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  lodBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &lodBarrier,
+                       0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    cullPipeline_);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          cullPipelineLayout_, 0, 1,
+                          &cullDescriptorSets_[currentFrame_], 0, nullptr);
+  vkCmdPushConstants(commandBuffer, cullPipelineLayout_,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+  vkCmdDispatch(commandBuffer, (entityCount + 63) / 64, 1, 1);
+
+  // Instance counts feed the indirect draws, model matrices the vertex shader
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask =
+      VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                           VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanRenderer::setGpuCulling(bool enabled) {
+  if (enabled && !cullPipeline_) {
+    std::cerr << "GPU culling is not supported on this device" << std::endl;
+    return;
+  }
+  if (enabled == gpuCulling_)
+    return;
+
+  gpuCulling_ = enabled;
+  if (enabled) {
+    // Nothing was tracked while disabled: re-upload every frame's buffer
+    gpuEntityFullUpload_.assign(framesInFlight_, true);
+    gpuCulledBase_.assign(framesInFlight_, -1);
+    gpuEntityDirtyMask_.assign(entities_.size(), 0);
+    for (auto &dirty : gpuDirtyEntities_)
+      dirty.clear();
+  }
+}
+
+bool VulkanRenderer::isGpuCullingEnabled() const { return gpuCulling_; }
 
-  // Draw all active entities in a pool using push-constant model matrices
-  auto drawEntities = [&](const std::vector<EntityData> &pool) {
-    for (size_t i = 0; i < pool.size(); i++) {
-      const auto &ent = pool[i];
-      if (!ent.active)
-        continue;
+void VulkanRenderer::setMeshletCulling(bool enabled) {
+  meshletCulling_ = enabled;
+}
+
+bool VulkanRenderer::isMeshletCullingEnabled() const {
+  return meshletCulling_;
+}
 
-      const MeshData &mesh = meshes_[ent.meshId];
+MeshletStats VulkanRenderer::getMeshletStats() const { return meshletStats_; }
 
-      VkDescriptorSet matSet = materials_[mesh.materialId].descriptorSet;
-      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                              pipelineLayout_, 1, 1, &matSet, 0, nullptr);
+// ---------------------------------------------------------------------------
+// Parallel command recording
+// ---------------------------------------------------------------------------
 
-      PushConstantData pc{};
-      pc.model = ent.transform;
-      vkCmdPushConstants(commandBuffer, pipelineLayout_,
-                         VK_SHADER_STAGE_VERTEX_BIT, 0,
-                         sizeof(PushConstantData), &pc);
+void VulkanRenderer::createRecordContexts() {
+  // One pool per frame in flight and per thread slot (workers + caller), so
+  // no pool is ever touched by two threads at once
+  int slots = recordPool_.getWorkerCount() + 1;
+  recordContexts_.assign(framesInFlight_, std::vector<RecordContext>(slots));
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  poolInfo.queueFamilyIndex = queueFamilies_.graphicsFamily.value();
 
-      vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, mesh.indexOffset,
-                       mesh.vertexOffset, 0);
+  for (auto &frameContexts : recordContexts_) {
+    for (auto &ctx : frameContexts) {
+      checkVk(vkCreateCommandPool(device_, &poolInfo, nullptr, &ctx.pool),
+              "Failed to create record command pool");
     }
-  };
+  }
+}
 
-  drawEntities(entities_);
+void VulkanRenderer::destroyRecordContexts() {
+  // Destroying a pool frees its command buffers
+  for (auto &frameContexts : recordContexts_) {
+    for (auto &ctx : frameContexts) {
+      if (ctx.pool)
+        vkDestroyCommandPool(device_, ctx.pool, nullptr);
+    }
+  }
+  recordContexts_.clear();
+}
 
-  // Debug wireframe overlay (rendered when debug is enabled)
-  if (debugOverlayEnabled_ && !debugEntities_.empty()) {
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                      debugPipeline_);
-    drawEntities(debugEntities_);
+VkCommandBuffer VulkanRenderer::acquireSecondary(uint32_t frame, int slot) {
+  RecordContext &ctx = recordContexts_[frame][slot];
+  if (ctx.used == ctx.buffers.size()) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = ctx.pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer buffer;
+    checkVk(vkAllocateCommandBuffers(device_, &allocInfo, &buffer),
+            "Failed to allocate secondary command buffer");
+    ctx.buffers.push_back(buffer);
   }
+  return ctx.buffers[ctx.used++];
+}
 
-  // UI overlay (rendered on top of 3D scene, within same render pass)
-  if (debugOverlayEnabled_ && uiVertexCount_ > 0) {
-    recordUICommands(commandBuffer);
+void VulkanRenderer::recordSecondaries(uint32_t frame, uint32_t imageIndex,
+                                       int chunkCount) {
+  PROFILE_FUNCTION();
+  // This frame's fence has signaled, so its secondaries are no longer in use
+  for (auto &ctx : recordContexts_[frame]) {
+    vkResetCommandPool(device_, ctx.pool, 0);
+    ctx.used = 0;
   }
 
-  vkCmdEndRenderPass(commandBuffer);
+  // Task order is execution order: GPU-culled scene, draw list chunks (scene
+  // then debug wireframes), UI on top
+  // Scene and debug batches are chunked separately so a timestamp task can
+  // sit between them
+  auto addChunks = [&](uint32_t firstBatch, uint32_t batchCount) {
+    uint32_t chunks =
+        std::min(static_cast<uint32_t>(std::max(chunkCount, 1)), batchCount);
+    for (uint32_t c = 0; c < chunks; c++) {
+      uint32_t first = static_cast<uint32_t>(
+          static_cast<uint64_t>(batchCount) * c / chunks);
+      uint32_t last = static_cast<uint32_t>(
+          static_cast<uint64_t>(batchCount) * (c + 1) / chunks);
+      recordTasks_.push_back(
+          {RECORD_TASK_BATCHES, firstBatch + first, last - first});
+    }
+  };
 
-  checkVk(vkEndCommandBuffer(commandBuffer), "Failed to record command buffer");
-}
+  recordTasks_.clear();
+  if (gpuCulling_)
+    recordTasks_.push_back({RECORD_TASK_INDIRECT, 0, 0});
+  uint32_t batchCount = static_cast<uint32_t>(drawList_.size());
+  uint32_t debugStart = static_cast<uint32_t>(debugBatchStart());
+  addChunks(0, debugStart);
+  if (timestampsSupported_)
+    recordTasks_.push_back(
+        {RECORD_TASK_TIMESTAMP, GPU_TIMESTAMP_DEBUG_BEGIN, 0});
+  addChunks(debugStart, batchCount - debugStart);
+  if (timestampsSupported_)
+    recordTasks_.push_back({RECORD_TASK_TIMESTAMP, GPU_TIMESTAMP_UI_BEGIN, 0});
+  if (debugOverlayEnabled_ && uiVertexCount_ > 0)
+    recordTasks_.push_back({RECORD_TASK_UI, 0, 0});
+
+  recordTaskBuffers_.assign(recordTasks_.size(), VK_NULL_HANDLE);
+  recordTaskStates_.assign(recordTasks_.size(), DrawState{});
+
+  VkCommandBufferInheritanceInfo inheritance{};
+  inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritance.renderPass = renderPass_;
+  inheritance.subpass = 0;
+  inheritance.framebuffer = swapchainFramebuffers_[imageIndex];
+  if (statisticsActive())
+    inheritance.pipelineStatistics = PIPELINE_STATISTICS;
+
+  recordPool_.parallelFor(
+      static_cast<int>(recordTasks_.size()), [&](int taskIndex, int slot) {
+        PROFILE_ZONE("recordTask");
+        const RecordTask &task = recordTasks_[taskIndex];
+        DrawState &state = recordTaskStates_[taskIndex];
+        VkCommandBuffer cmd = acquireSecondary(frame, slot);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+                          VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritance;
+        checkVk(vkBeginCommandBuffer(cmd, &beginInfo),
+                "Failed to begin secondary command buffer");
+
+        // Secondaries inherit no state, so each one binds its own
+        switch (task.type) {
+        case RECORD_TASK_INDIRECT:
+          bindSceneState(cmd, state);
+          recordIndirectDraws(cmd, state);
+          break;
+        case RECORD_TASK_BATCHES:
+          bindSceneState(cmd, state);
+          recordDrawBatches(cmd, task.firstBatch, task.batchCount, state);
+          break;
+        case RECORD_TASK_UI:
+          recordUICommands(cmd);
+          break;
+        case RECORD_TASK_TIMESTAMP:
+          writeTimestamp(cmd, static_cast<GpuTimestamp>(task.firstBatch));
+          break;
+        }
 
-void VulkanRenderer::setCamera(float eyeX, float eyeY, float eyeZ,
-                               float targetX, float targetY, float targetZ,
-                               float upX, float upY, float upZ,
-                               float fovDegrees) {
-  cameraEye_ = glm::vec3(eyeX, eyeY, eyeZ);
-  cameraTarget_ = glm::vec3(targetX, targetY, targetZ);
-  cameraUp_ = glm::vec3(upX, upY, upZ);
-  cameraFov_ = fovDegrees;
+        checkVk(vkEndCommandBuffer(cmd),
+                "Failed to record secondary command buffer");
+        recordTaskBuffers_[taskIndex] = cmd;
+      });
+
+  renderStats_ = RenderStats{};
+  for (const auto &state : recordTaskStates_)
+    renderStats_.add(state.stats);
 }
 
-void VulkanRenderer::getCursorPos(double &x, double &y) const {
-  glfwGetCursorPos(window_, &x, &y);
+void VulkanRenderer::setRecordThreads(int threadCount) {
+  int maxThreads =
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  threadCount = std::clamp(threadCount, 1, maxThreads);
+  if (threadCount == recordThreads_ && !recordContexts_.empty())
+    return;
+
+  // Pools may still be referenced by in-flight frames
+  if (device_)
+    vkDeviceWaitIdle(device_);
+  destroyRecordContexts();
+  recordPool_.resize(threadCount - 1);
+  recordThreads_ = threadCount;
+  if (device_)
+    createRecordContexts();
 }
 
-void VulkanRenderer::setCursorLocked(bool locked) {
-  cursorLocked_ = locked;
-  glfwSetInputMode(window_, GLFW_CURSOR,
-                   locked ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+int VulkanRenderer::getRecordThreads() const { return recordThreads_; }
+
+// ---------------------------------------------------------------------------
+// Frame pacing
+// ---------------------------------------------------------------------------
+
+void VulkanRenderer::setFramesInFlight(int count) {
+  if (device_) {
+    std::cerr << "Frames in flight can only be set before init" << std::endl;
+    return;
+  }
+  framesInFlight_ =
+      std::clamp(count, 1, static_cast<int>(MAX_FRAMES_IN_FLIGHT));
 }
 
-bool VulkanRenderer::isCursorLocked() const { return cursorLocked_; }
+int VulkanRenderer::getFramesInFlight() const { return framesInFlight_; }
 
-int VulkanRenderer::isMouseButtonPressed(int button) const {
-  return glfwGetMouseButton(window_, button) == GLFW_PRESS ? 1 : 0;
+void VulkanRenderer::setPresentMode(PresentMode mode) {
+  if (mode < PRESENT_MODE_FIFO || mode > PRESENT_MODE_IMMEDIATE) {
+    std::cerr << "Unknown present mode " << mode << std::endl;
+    return;
+  }
+  requestedPresentMode_ = mode;
+  if (!device_)
+    activePresentMode_ = mode;
+  else if (!headless_ && mode != activePresentMode_)
+    framebufferResized_ = true; // recreate the swapchain at the next present
 }
 
-void VulkanRenderer::getScrollOffset(float &x, float &y) const {
-  x = scrollOffsetX_;
-  y = scrollOffsetY_;
+PresentMode VulkanRenderer::getPresentMode() const {
+  return activePresentMode_;
 }
 
-void VulkanRenderer::resetScrollOffset() {
-  scrollOffsetX_ = 0.0f;
-  scrollOffsetY_ = 0.0f;
+void VulkanRenderer::benchmarkRecording(int drawCount, int iterations) {
+  if (meshes_.empty() || swapchainFramebuffers_.empty()) {
+    std::cerr << "Recording benchmark needs at least one mesh" << std::endl;
+    return;
+  }
+  vkDeviceWaitIdle(device_);
+  if (hasPendingGeometry()) {
+    recordGeometryUploads();
+    submitUploads();
+    waitForUploads();
+    acquireUploads();
+  }
+
+  // Synthetic worst case: one draw per entity, cycling through every mesh so
+  // consecutive draws never share a batch. Recorded but never submitted.
+  std::vector<DrawBatch> savedList;
+  savedList.swap(drawList_);
+  bool savedGpuCulling = gpuCulling_;
+  int savedThreads = recordThreads_;
+  gpuCulling_ = false;
+  for (int i = 0; i < drawCount; i++)
+    drawList_.push_back(
+        {DRAW_PIPELINE_SCENE, i % static_cast<int>(meshes_.size()), 0, 0, 1});
+
+  std::cout << "Recording benchmark: " << drawCount << " draws, " << iterations
+            << " iterations" << std::endl;
+
+  int maxThreads =
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  double baselineMs = 0.0;
+  for (int threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+    setRecordThreads(threads);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++)
+      recordSecondaries(currentFrame_, 0, threads);
+    auto end = std::chrono::high_resolution_clock::now();
+    double ms =
+        std::chrono::duration<double, std::milli>(end - start).count() /
+        std::max(iterations, 1);
+    if (threads == 1)
+      baselineMs = ms;
+
+    std::cout << "  " << threads << " thread(s): " << ms << " ms/frame ("
+              << (ms > 0.0 ? baselineMs / ms : 0.0) << "x)" << std::endl;
+    if (threads == maxThreads)
+      break;
+  }
+
+  drawList_.swap(savedList);
+  gpuCulling_ = savedGpuCulling;
+  setRecordThreads(savedThreads);
 }
 
-void VulkanRenderer::updateTime() {
-  double now = glfwGetTime();
-  if (lastFrameTime_ == 0.0) {
-    lastFrameTime_ = now;
+// ---------------------------------------------------------------------------
+// Culling benchmark
+// ---------------------------------------------------------------------------
+
+void VulkanRenderer::benchmarkCulling(int entityCount, int iterations) {
+  CullingBenchmarkResult r = runCullingBenchmark(entityCount, iterations);
+  std::cout << "Culling benchmark: " << r.entityCount << " entities, "
+            << iterations << " frames" << std::endl;
+  std::cout << "  tree build:  " << r.buildMs << " ms (height "
+            << r.treeHeight << ")" << std::endl;
+  std::cout << "  linear scan: " << r.linearMs << " ms/frame" << std::endl;
+  std::cout << "  tree query:  " << r.treeMs << " ms/frame" << std::endl;
+  std::cout << "  tree update: " << r.updateMs << " ms/frame (10% moving)"
+            << std::endl;
+  if (r.visibleCount < 0)
+    std::cerr << "  Warning: tree and linear scan disagree on visibility"
+              << std::endl;
+  else
+    std::cout << "  visible:     " << r.visibleCount << std::endl;
+}
+
+void VulkanRenderer::benchmarkMeshOptimizer(const char *path, int iterations) {
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  std::string name;
+  if (path && path[0]) {
+    cgltf_data *data = parseGltf(path);
+    if (!data)
+      return;
+    readGltfGeometry(data, vertices, indices);
+    cgltf_free(data);
+    name = path;
+  } else {
+    // Row-by-row grid: the order most generators and exporters produce
+    const uint32_t cells = 256;
+    for (uint32_t z = 0; z <= cells; z++) {
+      for (uint32_t x = 0; x <= cells; x++) {
+        Vertex v{};
+        v.pos = glm::vec3(static_cast<float>(x), 0.0f, static_cast<float>(z));
+        v.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        vertices.push_back(v);
+      }
+    }
+    for (uint32_t z = 0; z < cells; z++) {
+      for (uint32_t x = 0; x < cells; x++) {
+        uint32_t i0 = z * (cells + 1) + x;
+        uint32_t i1 = i0 + cells + 1;
+        indices.insert(indices.end(), {i0, i1, i0 + 1, i0 + 1, i1, i1 + 1});
+      }
+    }
+    name = "256x256 grid";
+  }
+  if (vertices.empty() || indices.size() % 3 != 0) {
+    std::cerr << "Mesh optimizer benchmark: no usable geometry in " << name
+              << std::endl;
     return;
   }
-  deltaTime_ = static_cast<float>(now - lastFrameTime_);
-  lastFrameTime_ = now;
-  totalTime_ += deltaTime_;
+
+  MeshOptimizerBenchmarkResult r =
+      runMeshOptimizerBenchmark(&vertices[0].pos.x, sizeof(Vertex),
+                                vertices.size(), indices.data(),
+                                indices.size(), iterations);
+  std::cout << "Mesh optimizer benchmark: " << name << ", " << r.vertexCount
+            << " vertices, " << r.triangleCount << " triangles, "
+            << iterations << " runs" << std::endl;
+  std::cout << "  ACMR:          " << r.before.acmr << " -> " << r.after.acmr
+            << " (cache size " << VERTEX_CACHE_SIZE << ")" << std::endl;
+  std::cout << "  ATVR:          " << r.before.atvr << " -> " << r.after.atvr
+            << std::endl;
+  std::cout << "  vertex cache:  " << r.cacheMs << " ms" << std::endl;
+  std::cout << "  overdraw:      " << r.overdrawMs << " ms" << std::endl;
+  std::cout << "  vertex fetch:  " << r.fetchMs << " ms" << std::endl;
 }
 
-float VulkanRenderer::getDeltaTime() const { return deltaTime_; }
-float VulkanRenderer::getTotalTime() const { return totalTime_; }
+// ---------------------------------------------------------------------------
+// GPU timing queries
+// ---------------------------------------------------------------------------
 
-void VulkanRenderer::updateUniformBuffer(uint32_t currentImage) {
-  float aspect = static_cast<float>(swapchainExtent_.width) /
-                 static_cast<float>(swapchainExtent_.height);
+void VulkanRenderer::createQueryPools() {
+  timestampPools_.assign(framesInFlight_, VK_NULL_HANDLE);
+  statisticsPools_.assign(framesInFlight_, VK_NULL_HANDLE);
+  timestampsWritten_.assign(framesInFlight_, false);
+  statisticsWritten_.assign(framesInFlight_, false);
+
+  for (int i = 0; i < framesInFlight_; i++) {
+    if (timestampsSupported_) {
+      VkQueryPoolCreateInfo poolInfo{};
+      poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+      poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+      poolInfo.queryCount = GPU_TIMESTAMP_COUNT;
+      checkVk(vkCreateQueryPool(device_, &poolInfo, nullptr,
+                                &timestampPools_[i]),
+              "Failed to create timestamp query pool");
+    }
+    if (pipelineStatisticsSupported_) {
+      VkQueryPoolCreateInfo poolInfo{};
+      poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+      poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+      poolInfo.queryCount = 1;
+      poolInfo.pipelineStatistics = PIPELINE_STATISTICS;
+      checkVk(vkCreateQueryPool(device_, &poolInfo, nullptr,
+                                &statisticsPools_[i]),
+              "Failed to create pipeline statistics query pool");
+    }
+  }
+}
 
-  UniformBufferObject ubo{};
-  ubo.view = glm::lookAt(cameraEye_, cameraTarget_, cameraUp_);
-  ubo.proj = glm::perspective(glm::radians(cameraFov_), aspect, 0.1f, 100.0f);
-  ubo.proj[1][1] *= -1; // Vulkan Y-flip
+void VulkanRenderer::destroyQueryPools() {
+  for (VkQueryPool pool : timestampPools_) {
+    if (pool)
+      vkDestroyQueryPool(device_, pool, nullptr);
+  }
+  for (VkQueryPool pool : statisticsPools_) {
+    if (pool)
+      vkDestroyQueryPool(device_, pool, nullptr);
+  }
+  timestampPools_.clear();
+  statisticsPools_.clear();
+  timestampsWritten_.clear();
+  statisticsWritten_.clear();
+}
 
-  memcpy(uniformBuffersMapped_[currentImage], &ubo, sizeof(ubo));
+// Frame begin is taken at the top of the pipe so it covers everything the
+// frame does; the rest mark where the previous pass's work has drained
+void VulkanRenderer::writeTimestamp(VkCommandBuffer commandBuffer,
+                                    GpuTimestamp timestamp) {
+  if (!timestampsSupported_)
+    return;
+  VkPipelineStageFlagBits stage = timestamp == GPU_TIMESTAMP_FRAME_BEGIN
+                                      ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT
+                                      : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+  vkCmdWriteTimestamp(commandBuffer, stage, timestampPools_[currentFrame_],
+                      timestamp);
+}
 
-  // Upload light data
-  lightData_.cameraPos = glm::vec4(cameraEye_, 1.0f);
-  memcpy(lightBuffersMapped_[currentImage], &lightData_, sizeof(lightData_));
+// Secondary command buffers only inherit the statistics query when the
+// device supports inheritedQueries; otherwise parallel recording goes without
+bool VulkanRenderer::statisticsActive() const {
+  return pipelineStatisticsSupported_ &&
+         (recordThreads_ <= 1 || inheritedQueriesSupported_);
+}
+
+// The draw list is sorted by pipeline and debug wireframes sort last
+size_t VulkanRenderer::debugBatchStart() const {
+  auto it = std::partition_point(
+      drawList_.begin(), drawList_.end(), [](const DrawBatch &batch) {
+        return batch.pipeline != DRAW_PIPELINE_DEBUG;
+      });
+  return static_cast<size_t>(it - drawList_.begin());
+}
+
+// Called once the frame's fence has signalled, so the results are normally
+// available; VK_NOT_READY just keeps the previous values rather than waiting
+void VulkanRenderer::readGpuTimings(uint32_t frame) {
+  if (frame < timestampsWritten_.size() && timestampsWritten_[frame]) {
+    uint64_t ticks[GPU_TIMESTAMP_COUNT];
+    VkResult result = vkGetQueryPoolResults(
+        device_, timestampPools_[frame], 0, GPU_TIMESTAMP_COUNT,
+        sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result == VK_SUCCESS) {
+      uint64_t mask = timestampValidBits_ >= 64
+                          ? ~0ull
+                          : (1ull << timestampValidBits_) - 1;
+      double msPerTick = deviceLimits_.timestampPeriod / 1.0e6;
+      auto elapsed = [&](GpuTimestamp from, GpuTimestamp to) {
+        return static_cast<float>(((ticks[to] - ticks[from]) & mask) *
+                                  msPerTick);
+      };
+      gpuTimings_.cullMs =
+          elapsed(GPU_TIMESTAMP_FRAME_BEGIN, GPU_TIMESTAMP_SCENE_BEGIN);
+      gpuTimings_.sceneMs =
+          elapsed(GPU_TIMESTAMP_SCENE_BEGIN, GPU_TIMESTAMP_DEBUG_BEGIN);
+      gpuTimings_.debugMs =
+          elapsed(GPU_TIMESTAMP_DEBUG_BEGIN, GPU_TIMESTAMP_UI_BEGIN);
+      gpuTimings_.uiMs =
+          elapsed(GPU_TIMESTAMP_UI_BEGIN, GPU_TIMESTAMP_FRAME_END);
+      gpuTimings_.totalMs =
+          elapsed(GPU_TIMESTAMP_FRAME_BEGIN, GPU_TIMESTAMP_FRAME_END);
+      gpuTimings_.valid = true;
+    }
+    timestampsWritten_[frame] = false;
+  }
+
+  if (frame < statisticsWritten_.size() && statisticsWritten_[frame]) {
+    uint64_t values[3];
+    VkResult result = vkGetQueryPoolResults(
+        device_, statisticsPools_[frame], 0, 1, sizeof(values), values,
+        sizeof(values), VK_QUERY_RESULT_64_BIT);
+    if (result == VK_SUCCESS) {
+      gpuTimings_.vertexInvocations = values[0];
+      gpuTimings_.clippingPrimitives = values[1];
+      gpuTimings_.fragmentInvocations = values[2];
+      gpuTimings_.statisticsValid = true;
+    }
+    statisticsWritten_[frame] = false;
+  }
 }
 
 // ---------------------------------------------------------------------------
@@ -1941,12 +4859,9 @@ void VulkanRenderer::updateUniformBuffer(uint32_t currentImage) {
 // ---------------------------------------------------------------------------
 
 void VulkanRenderer::recalcNumLights() {
-  int maxActive = 0;
-  for (int i = 0; i < MAX_LIGHTS; i++) {
-    if (lightData_.lights[i].color.w > 0.0f)
-      maxActive = i + 1;
-  }
-  lightData_.numLights = maxActive;
+  // Only the top slots can have gone inactive since the last call
+  while (lightSlotCount_ > 0 && lights_[lightSlotCount_ - 1].color.w <= 0.0f)
+    lightSlotCount_--;
 }
 
 void VulkanRenderer::setLight(int index, int type, float posX, float posY,
@@ -1956,7 +4871,7 @@ void VulkanRenderer::setLight(int index, int type, float posX, float posY,
   if (index < 0 || index >= MAX_LIGHTS)
     return;
 
-  GpuLight &light = lightData_.lights[index];
+  GpuLight &light = lights_[index];
   light.position = glm::vec4(posX, posY, posZ, 0.0f);
   light.direction = glm::vec4(dirX, dirY, dirZ, 0.0f);
   light.color = glm::vec4(r, g, b, intensity);
@@ -1965,14 +4880,17 @@ void VulkanRenderer::setLight(int index, int type, float posX, float posY,
   light.radius = radius;
   light.type = type;
 
-  recalcNumLights();
+  if (intensity > 0.0f)
+    lightSlotCount_ = std::max(lightSlotCount_, index + 1);
+  else
+    recalcNumLights();
 }
 
 void VulkanRenderer::clearLight(int index) {
   if (index < 0 || index >= MAX_LIGHTS)
     return;
 
-  lightData_.lights[index] = GpuLight{};
+  lights_[index] = GpuLight{};
   recalcNumLights();
 }
 
@@ -1980,6 +4898,21 @@ void VulkanRenderer::setAmbientIntensity(float intensity) {
   lightData_.ambientIntensity = intensity;
 }
 
+void VulkanRenderer::benchmarkLighting(int maxLights, int iterations) {
+  maxLights = std::min(maxLights, MAX_LIGHTS);
+  std::vector<LightClusterBenchmarkResult> results =
+      runLightClusterBenchmark(maxLights, iterations);
+  std::cout << "Lighting benchmark: " << CLUSTER_GRID_X << "x"
+            << CLUSTER_GRID_Y << "x" << CLUSTER_GRID_Z << " clusters, "
+            << iterations << " builds per light count" << std::endl;
+  for (const auto &r : results) {
+    std::cout << "  " << r.lightCount << " lights: build " << r.buildMs
+              << " ms, " << r.avgClusterLights << " avg / "
+              << r.maxClusterLights << " max lights per cluster, "
+              << r.indexCount << " indices" << std::endl;
+  }
+}
+
 // ---------------------------------------------------------------------------
 // Debug overlay public API
 // ---------------------------------------------------------------------------
@@ -1989,12 +4922,37 @@ void VulkanRenderer::setDebugOverlay(bool enabled) {
 }
 
 int VulkanRenderer::getActiveEntityCount() const {
-  int count = 0;
-  for (const auto &ent : entities_) {
-    if (ent.active)
-      count++;
+  // Every active scene entity owns exactly one tree proxy
+  return entityTree_.getProxyCount();
+}
+
+int VulkanRenderer::getCulledEntityCount() const { return culledEntityCount_; }
+
+RenderStats VulkanRenderer::getRenderStats() const { return renderStats_; }
+
+GpuTimings VulkanRenderer::getGpuTimings() const { return gpuTimings_; }
+
+MemoryStats VulkanRenderer::getMemoryStats() const {
+  return memoryAllocator_.getStats();
+}
+
+void VulkanRenderer::printMemoryStats() const {
+  const MemoryStats &stats = memoryAllocator_.getStats();
+  std::cout << "Device memory: " << stats.usedBytes / 1024 << " KiB used in "
+            << stats.blockCount << " block(s), " << stats.blockBytes / 1024
+            << " KiB reserved" << std::endl;
+  for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+    const MemoryCategoryStats &category = stats.categories[i];
+    std::cout << "  " << memoryCategoryName(static_cast<MemoryCategory>(i))
+              << ": " << category.allocationCount << " allocation(s), "
+              << category.bytes / 1024 << " KiB" << std::endl;
   }
-  return count;
+  std::cout << "Geometry: " << geometryBytes_ / 1024 << " KiB of packed vertices "
+            << "and indices (" << unpackedGeometryBytes_ / 1024
+            << " KiB unpacked)" << std::endl;
+  std::cout << "Texture cache: " << textureCache_.size() << " texture(s), "
+            << textureCacheHits_ << " hit(s), " << materials_.size() << "/"
+            << MAX_MATERIALS << " materials" << std::endl;
 }
 
 // ---------------------------------------------------------------------------
@@ -2178,7 +5136,7 @@ void VulkanRenderer::createUIPipeline() {
   pipelineInfo.renderPass = renderPass_;
   pipelineInfo.subpass = 0;
 
-  checkVk(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &pipelineInfo,
+  checkVk(vkCreateGraphicsPipelines(device_, pipelineCache_, 1, &pipelineInfo,
                                     nullptr, &uiPipeline_),
           "Failed to create UI graphics pipeline");
 
@@ -2189,25 +5147,24 @@ void VulkanRenderer::createUIPipeline() {
 void VulkanRenderer::createUIVertexBuffers() {
   VkDeviceSize bufferSize = sizeof(UIVertex) * UI_MAX_VERTICES;
 
-  uiVertexBuffers_.resize(MAX_FRAMES_IN_FLIGHT);
-  uiVertexBuffersMemory_.resize(MAX_FRAMES_IN_FLIGHT);
-  uiVertexBuffersMapped_.resize(MAX_FRAMES_IN_FLIGHT);
+  uiVertexBuffers_.resize(framesInFlight_);
+  uiVertexBuffersMemory_.resize(framesInFlight_);
+  uiVertexBuffersMapped_.resize(framesInFlight_);
 
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (int i = 0; i < framesInFlight_; i++) {
     createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 uiVertexBuffers_[i], uiVertexBuffersMemory_[i]);
-    vkMapMemory(device_, uiVertexBuffersMemory_[i], 0, bufferSize, 0,
-                &uiVertexBuffersMapped_[i]);
+                 MEMORY_FRAME_DATA, uiVertexBuffers_[i],
+                 uiVertexBuffersMemory_[i]);
+    uiVertexBuffersMapped_[i] = uiVertexBuffersMemory_[i].mapped;
   }
 }
 
-void VulkanRenderer::transitionImageLayout(VkImage image,
+void VulkanRenderer::transitionImageLayout(VkCommandBuffer cmd, VkImage image,
                                            VkImageLayout oldLayout,
-                                           VkImageLayout newLayout) {
-  VkCommandBuffer cmd = beginOneTimeCommands();
-
+                                           VkImageLayout newLayout,
+                                           uint32_t mipLevels) {
   VkImageMemoryBarrier barrier{};
   barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
   barrier.oldLayout = oldLayout;
@@ -2217,7 +5174,7 @@ void VulkanRenderer::transitionImageLayout(VkImage image,
   barrier.image = image;
   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.levelCount = mipLevels;
   barrier.subresourceRange.baseArrayLayer = 0;
   barrier.subresourceRange.layerCount = 1;
 
@@ -2244,8 +5201,6 @@ void VulkanRenderer::transitionImageLayout(VkImage image,
 
   vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1,
                        &barrier);
-
-  endOneTimeCommands(cmd);
 }
 
 void VulkanRenderer::createFontResources() {
@@ -2326,32 +5281,13 @@ void VulkanRenderer::createFontResources() {
   createImage(static_cast<uint32_t>(atlasW), static_cast<uint32_t>(atlasH),
               VK_FORMAT_R8_UNORM, VK_IMAGE_TILING_OPTIMAL,
               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, fontImage_,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_TEXTURE, fontImage_,
               fontImageMemory_);
 
-  // Upload via staging buffer
+  // Upload via the staging ring
   VkDeviceSize imageSize = static_cast<VkDeviceSize>(atlasW) * atlasH;
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingMemory;
-  createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               stagingBuffer, stagingMemory);
-
-  void *data;
-  vkMapMemory(device_, stagingMemory, 0, imageSize, 0, &data);
-  memcpy(data, bitmap.data(), static_cast<size_t>(imageSize));
-  vkUnmapMemory(device_, stagingMemory);
-
-  transitionImageLayout(fontImage_, VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  copyBufferToImage(stagingBuffer, fontImage_, static_cast<uint32_t>(atlasW),
-                    static_cast<uint32_t>(atlasH));
-  transitionImageLayout(fontImage_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-  vkDestroyBuffer(device_, stagingBuffer, nullptr);
-  vkFreeMemory(device_, stagingMemory, nullptr);
+  uploadImage(fontImage_, bitmap.data(), imageSize,
+              static_cast<uint32_t>(atlasW), static_cast<uint32_t>(atlasH));
 
   fontImageView_ = createImageView(fontImage_, VK_FORMAT_R8_UNORM,
                                    VK_IMAGE_ASPECT_COLOR_BIT);
@@ -2360,13 +5296,13 @@ void VulkanRenderer::createFontResources() {
 void VulkanRenderer::createUIDescriptorPool() {
   VkDescriptorPoolSize poolSize{};
   poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolSize.descriptorCount = static_cast<uint32_t>(framesInFlight_);
 
   VkDescriptorPoolCreateInfo poolInfo{};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   poolInfo.poolSizeCount = 1;
   poolInfo.pPoolSizes = &poolSize;
-  poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolInfo.maxSets = static_cast<uint32_t>(framesInFlight_);
 
   checkVk(
       vkCreateDescriptorPool(device_, &poolInfo, nullptr, &uiDescriptorPool_),
@@ -2374,21 +5310,21 @@ void VulkanRenderer::createUIDescriptorPool() {
 }
 
 void VulkanRenderer::createUIDescriptorSets() {
-  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT,
+  std::vector<VkDescriptorSetLayout> layouts(framesInFlight_,
                                              uiDescriptorSetLayout_);
 
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   allocInfo.descriptorPool = uiDescriptorPool_;
-  allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  allocInfo.descriptorSetCount = static_cast<uint32_t>(framesInFlight_);
   allocInfo.pSetLayouts = layouts.data();
 
-  uiDescriptorSets_.resize(MAX_FRAMES_IN_FLIGHT);
+  uiDescriptorSets_.resize(framesInFlight_);
   checkVk(
       vkAllocateDescriptorSets(device_, &allocInfo, uiDescriptorSets_.data()),
       "Failed to allocate UI descriptor sets");
 
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (int i = 0; i < framesInFlight_; i++) {
     VkDescriptorImageInfo imageInfo{};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     imageInfo.imageView = fontImageView_;
@@ -2459,6 +5395,9 @@ void VulkanRenderer::createTextureSampler() {
   samplerInfo.unnormalizedCoordinates = VK_FALSE;
   samplerInfo.compareEnable = VK_FALSE;
   samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  samplerInfo.minLod = 0.0f;
+  samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // every level the view exposes
+  samplerInfo.mipLodBias = 0.0f;
 
   checkVk(vkCreateSampler(device_, &samplerInfo, nullptr, &textureSampler_),
           "Failed to create texture sampler");
@@ -2470,31 +5409,10 @@ void VulkanRenderer::createDefaultTexture() {
 
   createImage(1, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, defaultTextureImage_,
-              defaultTextureMemory_);
-
-  // Upload via staging buffer
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingMemory;
-  createBuffer(4, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               stagingBuffer, stagingMemory);
-
-  void *data;
-  vkMapMemory(device_, stagingMemory, 0, 4, 0, &data);
-  memcpy(data, pixel, 4);
-  vkUnmapMemory(device_, stagingMemory);
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_TEXTURE,
+              defaultTextureImage_, defaultTextureMemory_);
 
-  transitionImageLayout(defaultTextureImage_, VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  copyBufferToImage(stagingBuffer, defaultTextureImage_, 1, 1);
-  transitionImageLayout(defaultTextureImage_,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-  vkDestroyBuffer(device_, stagingBuffer, nullptr);
-  vkFreeMemory(device_, stagingMemory, nullptr);
+  uploadImage(defaultTextureImage_, pixel, sizeof(pixel), 1, 1);
 
   defaultTextureView_ = createImageView(
       defaultTextureImage_, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
@@ -2536,16 +5454,16 @@ int VulkanRenderer::createMaterial(VkImageView textureView) {
   return materialId;
 }
 
-void VulkanRenderer::copyBufferToImage(VkBuffer buffer, VkImage image,
-                                       uint32_t width, uint32_t height) {
-  VkCommandBuffer cmd = beginOneTimeCommands();
-
+void VulkanRenderer::copyBufferToImage(VkCommandBuffer cmd, VkBuffer buffer,
+                                       VkDeviceSize offset, VkImage image,
+                                       uint32_t width, uint32_t height,
+                                       uint32_t mipLevel) {
   VkBufferImageCopy region{};
-  region.bufferOffset = 0;
+  region.bufferOffset = offset;
   region.bufferRowLength = 0;
   region.bufferImageHeight = 0;
   region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.mipLevel = mipLevel;
   region.imageSubresource.baseArrayLayer = 0;
   region.imageSubresource.layerCount = 1;
   region.imageOffset = {0, 0, 0};
@@ -2553,11 +5471,200 @@ void VulkanRenderer::copyBufferToImage(VkBuffer buffer, VkImage image,
 
   vkCmdCopyBufferToImage(cmd, buffer, image,
                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+// Stages pixels and records the layout transitions and copies into the open
+// upload batch; the image is ready for sampling once the batch executes
+void VulkanRenderer::uploadImage(VkImage image, const void *pixels,
+                                 VkDeviceSize size, uint32_t width,
+                                 uint32_t height, uint32_t mipLevels,
+                                 bool blitMips, const TexelBlock &block) {
+  VkDeviceSize offset = stageUpload(pixels, size);
+  VkCommandBuffer cmd = uploadCommands();
+  transitionImageLayout(cmd, image, VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+
+  uint32_t copiedLevels = blitMips ? 1 : mipLevels;
+  for (uint32_t level = 0, w = width, h = height; level < copiedLevels;
+       level++) {
+    copyBufferToImage(cmd, stagingRing_.buffer, offset, image, w, h, level);
+    offset += texelBlockLevelBytes(block, w, h);
+    w = std::max(w / 2, 1u);
+    h = std::max(h / 2, 1u);
+  }
+
+  if (blitMips) {
+    recordMipmapBlits(cmd, image, width, height, mipLevels);
+    return;
+  }
+  if (!dedicatedTransfer_) {
+    transitionImageLayout(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
+    return;
+  }
+
+  // Queue family ownership transfer: the transfer queue releases the image
+  // (doing the layout transition), the graphics queue acquires it with an
+  // identical barrier in recordUploadAcquires()
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcQueueFamilyIndex = uploadFamily_;
+  barrier.dstQueueFamilyIndex = queueFamilies_.graphicsFamily.value();
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = mipLevels;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  uploadBatch_.acquire.images.push_back(barrier);
+}
+
+// Expects every level in TRANSFER_DST_OPTIMAL with level 0 filled. Each level
+// is blitted from the one above it, then handed to the fragment shader.
+void VulkanRenderer::recordMipmapBlits(VkCommandBuffer cmd, VkImage image,
+                                       uint32_t width, uint32_t height,
+                                       uint32_t mipLevels) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+
+  int32_t mipWidth = static_cast<int32_t>(width);
+  int32_t mipHeight = static_cast<int32_t>(height);
+  for (uint32_t level = 1; level < mipLevels; level++) {
+    barrier.subresourceRange.baseMipLevel = level - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                         nullptr, 1, &barrier);
+
+    int32_t nextWidth = std::max(mipWidth / 2, 1);
+    int32_t nextHeight = std::max(mipHeight / 2, 1);
+    VkImageBlit blit{};
+    blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+    blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+    blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+    blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+    vkCmdBlitImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                   VK_FILTER_LINEAR);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr,
+                         0, nullptr, 1, &barrier);
+
+    mipWidth = nextWidth;
+    mipHeight = nextHeight;
+  }
+
+  barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+}
+
+void VulkanRenderer::setTextureMipmaps(bool enabled) {
+  textureMipmaps_ = enabled;
+}
+
+bool VulkanRenderer::getTextureMipmaps() const { return textureMipmaps_; }
+
+void VulkanRenderer::setMeshOptimization(bool enabled) {
+  meshOptimization_ = enabled;
+}
+
+bool VulkanRenderer::getMeshOptimization() const { return meshOptimization_; }
+
+void VulkanRenderer::setWeldEpsilon(float epsilon) {
+  if (epsilon < 0.0f) {
+    std::cerr << "Weld epsilon must be >= 0, got " << epsilon << std::endl;
+    return;
+  }
+  weldEpsilon_ = epsilon;
+}
+
+float VulkanRenderer::getWeldEpsilon() const { return weldEpsilon_; }
+
+void VulkanRenderer::setMeshLods(bool enabled) { meshLods_ = enabled; }
+
+bool VulkanRenderer::getMeshLods() const { return meshLods_; }
+
+void VulkanRenderer::setLodBias(float pixels) {
+  if (pixels < 0.0f) {
+    std::cerr << "LOD bias must be >= 0, got " << pixels << std::endl;
+    return;
+  }
+  lodBias_ = pixels;
+}
+
+float VulkanRenderer::getLodBias() const { return lodBias_; }
 
-  endOneTimeCommands(cmd);
+void VulkanRenderer::setLodHysteresis(float fraction) {
+  if (fraction < 0.0f || fraction >= 1.0f) {
+    std::cerr << "LOD hysteresis must be in [0, 1), got " << fraction
+              << std::endl;
+    return;
+  }
+  lodHysteresis_ = fraction;
 }
 
+float VulkanRenderer::getLodHysteresis() const { return lodHysteresis_; }
+
+// Identical encoded images (the same GLB loaded twice, or several glTFs
+// sharing a texture file) resolve to one material: one VkImage and one
+// descriptor set. The mip setting is part of the key since it changes what
+// gets uploaded.
 int VulkanRenderer::loadTextureFromMemory(const uint8_t *data, size_t size) {
+  uint8_t mipmaps = textureMipmaps_ ? 1 : 0;
+  uint64_t key = hashBytes(&mipmaps, 1, hashBytes(data, size));
+  uint64_t checkHash = hashBytesMix(data, size);
+  auto cached = textureCache_.find(key);
+  if (cached != textureCache_.end() && cached->second.encodedSize == size &&
+      cached->second.checkHash == checkHash) {
+    textureCacheHits_++;
+    std::cout << "Reusing cached texture (material "
+              << cached->second.materialId << ")" << std::endl;
+    return cached->second.materialId;
+  }
+
+  int materialId = decodeTexture(data, size);
+  // Failed loads aren't cached so a fallback image can still be tried. On a
+  // key collision the newer image takes the slot.
+  if (materialId != defaultMaterialId_)
+    textureCache_[key] = {materialId, size, checkHash};
+  return materialId;
+}
+
+int VulkanRenderer::decodeTexture(const uint8_t *data, size_t size) {
+  if (isKtx2(data, size))
+    return loadTextureKtx2(data, size);
+
   int texWidth, texHeight, texChannels;
   stbi_uc *pixels =
       stbi_load_from_memory(data, static_cast<int>(size), &texWidth, &texHeight,
@@ -2568,52 +5675,126 @@ int VulkanRenderer::loadTextureFromMemory(const uint8_t *data, size_t size) {
     return defaultMaterialId_;
   }
 
-  VkDeviceSize imageSize = static_cast<VkDeviceSize>(texWidth) * texHeight * 4;
-
-  // Staging buffer
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingMemory;
-  createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               stagingBuffer, stagingMemory);
+  uint32_t width = static_cast<uint32_t>(texWidth);
+  uint32_t height = static_cast<uint32_t>(texHeight);
+  VkDeviceSize imageSize = static_cast<VkDeviceSize>(width) * height * 4;
 
-  void *mapped;
-  vkMapMemory(device_, stagingMemory, 0, imageSize, 0, &mapped);
-  memcpy(mapped, pixels, static_cast<size_t>(imageSize));
-  vkUnmapMemory(device_, stagingMemory);
+  // Blits need a graphics-capable queue, so the dedicated transfer queue
+  // gets a CPU-built chain instead
+  uint32_t mipLevels = 1;
+  if (textureMipmaps_) {
+    for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+      mipLevels++;
+  }
+  bool blitMips = mipLevels > 1 && linearBlitSupported_ && !dedicatedTransfer_;
 
+  // Create VkImage
+  VkImage textureImage;
+  MemoryAllocation textureMemory;
+  VkImageUsageFlags usage =
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  if (blitMips)
+    usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  createImage(width, height, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
+              usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_TEXTURE,
+              textureImage, textureMemory, mipLevels);
+
+  // Recorded into the open upload batch; submitted with the next frame
+  if (mipLevels > 1 && !blitMips) {
+    std::vector<uint8_t> chain =
+        buildMipChain(pixels, width, height, mipLevels);
+    uploadImage(textureImage, chain.data(), chain.size(), width, height,
+                mipLevels);
+  } else {
+    uploadImage(textureImage, pixels, imageSize, width, height, mipLevels,
+                blitMips);
+  }
   stbi_image_free(pixels);
 
-  // Create VkImage
+  VkImageView textureView =
+      createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB,
+                      VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+
+  int materialId = createMaterial(textureView);
+  materials_[materialId].textureImage = textureImage;
+  materials_[materialId].textureMemory = textureMemory;
+  materials_[materialId].ownsTexture = true;
+
+  // Drawn with the default material until the upload batch is acquired
+  materials_[materialId].resident = false;
+  uploadBatch_.acquire.materials.push_back(materialId);
+
+  std::cout << "Loaded texture: " << texWidth << "x" << texHeight << ", "
+            << mipLevels << " mip level(s)"
+            << (mipLevels > 1 ? (blitMips ? " (GPU blit)" : " (CPU)") : "")
+            << " (material " << materialId << ")" << std::endl;
+  return materialId;
+}
+
+// Uploads the stored blocks and mip levels as they are; nothing is decoded
+// or generated on the CPU. Falls back to the default material when the
+// device can't sample the file's format, so callers can try another image.
+int VulkanRenderer::loadTextureKtx2(const uint8_t *data, size_t size) {
+  Ktx2Texture ktx;
+  std::string error;
+  if (!parseKtx2(data, size, ktx, error)) {
+    std::cerr << "Warning: Can't load KTX2 texture (" << error
+              << "), using default material" << std::endl;
+    return defaultMaterialId_;
+  }
+
+  VkFormatProperties formatProps;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice_, ktx.format,
+                                      &formatProps);
+  const VkFormatFeatureFlags required =
+      VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+      VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  if ((formatProps.optimalTilingFeatures & required) != required) {
+    std::cerr << "Warning: KTX2 format " << ktx2FormatName(ktx.format)
+              << " is not supported by this device, using default material"
+              << std::endl;
+    return defaultMaterialId_;
+  }
+
+  uint32_t mipLevels =
+      textureMipmaps_ ? static_cast<uint32_t>(ktx.levels.size()) : 1;
+
+  // The file stores levels smallest first with padding in between; pack the
+  // ones we use largest first for uploadImage
+  std::vector<uint8_t> packed;
+  for (uint32_t level = 0; level < mipLevels; level++) {
+    const Ktx2Level &src = ktx.levels[level];
+    packed.insert(packed.end(), src.data, src.data + src.size);
+  }
+
   VkImage textureImage;
-  VkDeviceMemory textureMemory;
-  createImage(static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight),
-              VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
+  MemoryAllocation textureMemory;
+  createImage(ktx.width, ktx.height, ktx.format, VK_IMAGE_TILING_OPTIMAL,
               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureMemory);
-
-  transitionImageLayout(textureImage, VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  copyBufferToImage(stagingBuffer, textureImage,
-                    static_cast<uint32_t>(texWidth),
-                    static_cast<uint32_t>(texHeight));
-  transitionImageLayout(textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_TEXTURE,
+              textureImage, textureMemory, mipLevels);
 
-  vkDestroyBuffer(device_, stagingBuffer, nullptr);
-  vkFreeMemory(device_, stagingMemory, nullptr);
+  // Recorded into the open upload batch; submitted with the next frame
+  uploadImage(textureImage, packed.data(), packed.size(), ktx.width,
+              ktx.height, mipLevels, false, ktx.block);
 
-  VkImageView textureView = createImageView(
-      textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+  VkImageView textureView = createImageView(textureImage, ktx.format,
+                                            VK_IMAGE_ASPECT_COLOR_BIT,
+                                            mipLevels);
 
   int materialId = createMaterial(textureView);
   materials_[materialId].textureImage = textureImage;
   materials_[materialId].textureMemory = textureMemory;
   materials_[materialId].ownsTexture = true;
 
-  std::cout << "Loaded texture: " << texWidth << "x" << texHeight
-            << " (material " << materialId << ")" << std::endl;
+  // Drawn with the default material until the upload batch is acquired
+  materials_[materialId].resident = false;
+  uploadBatch_.acquire.materials.push_back(materialId);
+
+  std::cout << "Loaded KTX2 texture: " << ktx.width << "x" << ktx.height
+            << " " << ktx2FormatName(ktx.format) << ", " << mipLevels
+            << " mip level(s), " << packed.size() / 1024 << " KiB (material "
+            << materialId << ")" << std::endl;
   return materialId;
 }
 
@@ -2624,11 +5805,12 @@ void VulkanRenderer::cleanupMaterialResources() {
         vkDestroyImageView(device_, mat.textureView, nullptr);
       if (mat.textureImage)
         vkDestroyImage(device_, mat.textureImage, nullptr);
-      if (mat.textureMemory)
-        vkFreeMemory(device_, mat.textureMemory, nullptr);
+      memoryAllocator_.free(mat.textureMemory);
     }
   }
   materials_.clear();
+  textureCache_.clear();
+  textureCacheHits_ = 0;
 
   if (defaultTextureView_)
     vkDestroyImageView(device_, defaultTextureView_, nullptr);
@@ -2636,9 +5818,7 @@ void VulkanRenderer::cleanupMaterialResources() {
   if (defaultTextureImage_)
     vkDestroyImage(device_, defaultTextureImage_, nullptr);
   defaultTextureImage_ = VK_NULL_HANDLE;
-  if (defaultTextureMemory_)
-    vkFreeMemory(device_, defaultTextureMemory_, nullptr);
-  defaultTextureMemory_ = VK_NULL_HANDLE;
+  memoryAllocator_.free(defaultTextureMemory_);
 
   if (materialDescriptorPool_)
     vkDestroyDescriptorPool(device_, materialDescriptorPool_, nullptr);
@@ -2653,10 +5833,10 @@ void VulkanRenderer::cleanupMaterialResources() {
 }
 
 void VulkanRenderer::cleanupUIResources() {
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (int i = 0; i < framesInFlight_; i++) {
     if (uiVertexBuffers_.size() > static_cast<size_t>(i)) {
       vkDestroyBuffer(device_, uiVertexBuffers_[i], nullptr);
-      vkFreeMemory(device_, uiVertexBuffersMemory_[i], nullptr);
+      memoryAllocator_.free(uiVertexBuffersMemory_[i]);
     }
   }
   uiVertexBuffers_.clear();
@@ -2672,9 +5852,7 @@ void VulkanRenderer::cleanupUIResources() {
   if (fontImage_)
     vkDestroyImage(device_, fontImage_, nullptr);
   fontImage_ = VK_NULL_HANDLE;
-  if (fontImageMemory_)
-    vkFreeMemory(device_, fontImageMemory_, nullptr);
-  fontImageMemory_ = VK_NULL_HANDLE;
+  memoryAllocator_.free(fontImageMemory_);
 
   if (uiDescriptorPool_)
     vkDestroyDescriptorPool(device_, uiDescriptorPool_, nullptr);
@@ -2794,6 +5972,7 @@ void VulkanRenderer::appendText(const char *text, float x, float y,
 }
 
 void VulkanRenderer::buildDebugOverlayGeometry() {
+  PROFILE_FUNCTION();
   uiVertices_.clear();
   uiVertexCount_ = 0;
 
@@ -2803,8 +5982,14 @@ void VulkanRenderer::buildDebugOverlayGeometry() {
 
   float padding = 10.0f;
   float lineHeight = fontPixelHeight_ + 4.0f;
-  int lineCount = 3;
-  float panelWidth = 260.0f;
+  int lineCount = 6;
+  if (meshletStats_.testedMeshlets > 0)
+    lineCount++;
+  if (gpuTimings_.valid)
+    lineCount += 2;
+  if (gpuTimings_.statisticsValid)
+    lineCount++;
+  float panelWidth = 280.0f;
   float panelHeight = padding * 2 + lineHeight * lineCount;
 
   // Background panel (semi-transparent dark)
@@ -2829,6 +6014,55 @@ void VulkanRenderer::buildDebugOverlayGeometry() {
   snprintf(buf, sizeof(buf), "Entities: %d", getActiveEntityCount());
   appendText(buf, textX, textY, textColor);
 
+  textY += lineHeight;
+  snprintf(buf, sizeof(buf), "Culled: %d", culledEntityCount_);
+  appendText(buf, textX, textY, textColor);
+
+  if (meshletStats_.testedMeshlets > 0) {
+    textY += lineHeight;
+    snprintf(buf, sizeof(buf), "Meshlets: %d/%d  Tris: -%.0f%%",
+             meshletStats_.frustumCulledMeshlets +
+                 meshletStats_.backfaceCulledMeshlets,
+             meshletStats_.testedMeshlets,
+             100.0f * meshletStats_.culledTriangles /
+                 meshletStats_.testedTriangles);
+    appendText(buf, textX, textY, textColor);
+  }
+
+  textY += lineHeight;
+  snprintf(buf, sizeof(buf), "Draws: %d  Binds: %d", renderStats_.drawCalls,
+           renderStats_.pipelineBinds + renderStats_.descriptorBinds +
+               renderStats_.bufferBinds);
+  appendText(buf, textX, textY, textColor);
+
+  textY += lineHeight;
+  const MemoryStats &memory = memoryAllocator_.getStats();
+  snprintf(buf, sizeof(buf), "GPU mem: %.1f / %.1f MiB (%u)",
+           memory.usedBytes / (1024.0 * 1024.0),
+           memory.blockBytes / (1024.0 * 1024.0), memory.blockCount);
+  appendText(buf, textX, textY, textColor);
+
+  if (gpuTimings_.valid) {
+    textY += lineHeight;
+    snprintf(buf, sizeof(buf), "GPU: %.2f ms  Cull: %.2f",
+             gpuTimings_.totalMs, gpuTimings_.cullMs);
+    appendText(buf, textX, textY, textColor);
+
+    textY += lineHeight;
+    snprintf(buf, sizeof(buf), "Scene %.2f  Dbg %.2f  UI %.2f",
+             gpuTimings_.sceneMs, gpuTimings_.debugMs, gpuTimings_.uiMs);
+    appendText(buf, textX, textY, textColor);
+  }
+
+  if (gpuTimings_.statisticsValid) {
+    textY += lineHeight;
+    snprintf(buf, sizeof(buf), "VS %.0fk  Clip %.0fk  FS %.0fk",
+             gpuTimings_.vertexInvocations / 1000.0,
+             gpuTimings_.clippingPrimitives / 1000.0,
+             gpuTimings_.fragmentInvocations / 1000.0);
+    appendText(buf, textX, textY, textColor);
+  }
+
   uiVertexCount_ = static_cast<uint32_t>(uiVertices_.size());
 
   // Upload to current frame's vertex buffer
@@ -3,16 +3,27 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "bvh.h"
+#include "ktx2.h"
+#include "light_clusters.h"
+#include "memory_allocator.h"
+#include "mesh_optimizer.h"
+#include "task_pool.h"
+
 #include <array>
+#include <deque>
+#include <filesystem>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-#define MAX_LIGHTS 8
+// Light slots addressable through setLight. Only active lights are uploaded,
+// and fragments shade the lights of their cluster rather than all of them.
+#define MAX_LIGHTS 1024
 
 enum LightType {
   LIGHT_DIRECTIONAL = 0,
@@ -30,24 +41,43 @@ struct GpuLight {
   alignas(4) int type;             // 0=directional, 1=point, 2=spot
 };
 
+// Per-frame lighting constants. The lights themselves are in a storage
+// buffer, directional and unbounded ones first: every fragment shades those
+// globalLightCount lights, then the rest of its cluster's list.
 struct LightUBO {
-  alignas(16) glm::vec4 cameraPos; // xyz = eye position
-  alignas(4) int numLights;
+  alignas(16) glm::vec4 cameraPos;     // xyz = eye position
+  alignas(16) glm::vec4 cameraForward; // xyz = normalized view direction
+  alignas(16) glm::vec4 clusterParams; // LightClusterGrid::getShaderParams
+  alignas(4) int numLights;            // active lights in the light buffer
+  alignas(4) int globalLightCount;
   alignas(4) float ambientIntensity;
-  alignas(8) float _pad[2];    // pad to 16 before array
-  GpuLight lights[MAX_LIGHTS]; // 8 × 64 = 512
+  alignas(4) float _pad;
 };
 
+// Full-precision vertex that mesh loaders and primitive generators build;
+// addMesh packs it into a PackedVertex before it reaches the GPU
 struct Vertex {
   glm::vec3 pos;
   glm::vec3 normal;
   glm::vec3 color;
   glm::vec2 uv;
+};
+
+// GPU vertex layout: 24 bytes instead of Vertex's 44. Normals are octahedral
+// encoded into two snorm16s, colors are RGBA8 unorm and UVs half floats;
+// shader.vert decodes them.
+struct PackedVertex {
+  glm::vec3 pos;
+  uint32_t normal; // R16G16_SNORM, octahedral
+  uint32_t color;  // R8G8B8A8_UNORM, alpha unused
+  uint32_t uv;     // R16G16_SFLOAT
+
+  static PackedVertex pack(const Vertex &v);
 
   static VkVertexInputBindingDescription getBindingDescription() {
     VkVertexInputBindingDescription desc{};
     desc.binding = 0;
-    desc.stride = sizeof(Vertex);
+    desc.stride = sizeof(PackedVertex);
     desc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
     return desc;
   }
@@ -58,22 +88,22 @@ struct Vertex {
     attrs[0].binding = 0;
     attrs[0].location = 0;
     attrs[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attrs[0].offset = offsetof(Vertex, pos);
+    attrs[0].offset = offsetof(PackedVertex, pos);
 
     attrs[1].binding = 0;
     attrs[1].location = 1;
-    attrs[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attrs[1].offset = offsetof(Vertex, normal);
+    attrs[1].format = VK_FORMAT_R16G16_SNORM;
+    attrs[1].offset = offsetof(PackedVertex, normal);
 
     attrs[2].binding = 0;
     attrs[2].location = 2;
-    attrs[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attrs[2].offset = offsetof(Vertex, color);
+    attrs[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+    attrs[2].offset = offsetof(PackedVertex, color);
 
     attrs[3].binding = 0;
     attrs[3].location = 3;
-    attrs[3].format = VK_FORMAT_R32G32_SFLOAT;
-    attrs[3].offset = offsetof(Vertex, uv);
+    attrs[3].format = VK_FORMAT_R16G16_SFLOAT;
+    attrs[3].offset = offsetof(PackedVertex, uv);
 
     return attrs;
   }
@@ -129,34 +159,312 @@ struct UniformBufferObject {
   alignas(16) glm::mat4 proj;
 };
 
-struct PushConstantData {
+// Per-instance data, read by shader.vert via gl_InstanceIndex (std430)
+struct InstanceData {
+  glm::mat4 model;
+};
+
+enum DrawPipeline : uint32_t {
+  DRAW_PIPELINE_SCENE = 0,
+  DRAW_PIPELINE_DEBUG = 1,
+};
+
+// One visible entity in the per-frame draw list. Sort key layout, most
+// significant first: [63:62] pipeline, [61:48] material, [47:34] mesh,
+// [33:32] LOD, [31:0] view depth (float bits, front to back). Only the low
+// 14 bits of the mesh id fit, so buildDrawList also compares the full
+// meshId when splitting batches.
+struct DrawItem {
+  uint64_t sortKey;
+  uint32_t entityId;
+};
+
+// One instanced draw: a contiguous run of sorted draw items sharing
+// pipeline, material and mesh
+struct DrawBatch {
+  uint32_t pipeline;
+  int meshId;
+  uint32_t lod;
+  uint32_t firstInstance;
+  uint32_t instanceCount;
+  // Meshlet-culled batches draw commandCount commands from meshletCommands_
+  // instead: one per run of visible meshlets per instance
+  bool meshletCulled = false;
+  uint32_t firstCommand = 0;
+  uint32_t commandCount = 0;
+};
+
+// Meshlet culling results for the last frame culled on the CPU
+struct MeshletStats {
+  int testedMeshlets = 0;
+  int frustumCulledMeshlets = 0;
+  int backfaceCulledMeshlets = 0;
+  int testedTriangles = 0;
+  int culledTriangles = 0;
+};
+
+// Command counts for the last recorded 3D pass
+struct RenderStats {
+  int drawCalls = 0;
+  int instances = 0;
+  int pipelineBinds = 0;
+  int descriptorBinds = 0;
+  int bufferBinds = 0;
+  int skippedBinds = 0; // redundant binds elided by state tracking
+
+  void add(const RenderStats &other) {
+    drawCalls += other.drawCalls;
+    instances += other.instances;
+    pipelineBinds += other.pipelineBinds;
+    descriptorBinds += other.descriptorBinds;
+    bufferBinds += other.bufferBinds;
+    skippedBinds += other.skippedBinds;
+  }
+};
+
+// Bound state while recording one command buffer, used to skip redundant binds
+struct DrawState {
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  int materialId = -1;
+  int indexType = -1; // VkIndexType the index arena is bound as, -1 = unbound
+  RenderStats stats;
+};
+
+enum RecordTaskType {
+  RECORD_TASK_INDIRECT = 0,  // GPU-culled scene (indirect draws)
+  RECORD_TASK_BATCHES = 1,   // a chunk of the sorted draw list
+  RECORD_TASK_UI = 2,        // debug overlay text
+  RECORD_TASK_TIMESTAMP = 3, // pass boundary; firstBatch = GpuTimestamp
+};
+
+// One secondary command buffer's worth of work, executed in list order
+struct RecordTask {
+  RecordTaskType type;
+  uint32_t firstBatch;
+  uint32_t batchCount;
+};
+
+// Timestamp queries written each frame, in execution order. Each pass is
+// timed from its own timestamp to the next one.
+enum GpuTimestamp : uint32_t {
+  GPU_TIMESTAMP_FRAME_BEGIN = 0, // before the cull dispatch
+  GPU_TIMESTAMP_SCENE_BEGIN,     // render pass (clear + scene draws)
+  GPU_TIMESTAMP_DEBUG_BEGIN,     // debug wireframes
+  GPU_TIMESTAMP_UI_BEGIN,        // debug overlay
+  GPU_TIMESTAMP_FRAME_END,
+  GPU_TIMESTAMP_COUNT
+};
+
+// GPU time per pass for the most recent completed frame
+struct GpuTimings {
+  float cullMs = 0.0f;
+  float sceneMs = 0.0f;
+  float debugMs = 0.0f;
+  float uiMs = 0.0f;
+  float totalMs = 0.0f;
+  bool valid = false;
+  // Whole render pass; needs the pipelineStatisticsQuery feature
+  uint64_t vertexInvocations = 0;
+  uint64_t clippingPrimitives = 0;
+  uint64_t fragmentInvocations = 0;
+  bool statisticsValid = false;
+};
+
+// Per-thread command pool (one per frame in flight and worker slot) and the
+// secondary buffers allocated from it, reused after each pool reset
+struct RecordContext {
+  VkCommandPool pool = VK_NULL_HANDLE;
+  std::vector<VkCommandBuffer> buffers;
+  size_t used = 0;
+};
+
+// GPU-driven culling inputs, read by cull.comp (std430)
+struct GpuEntity {
   glm::mat4 model;
+  uint32_t meshId;
+  uint32_t active;
+  uint32_t _pad[2];
+};
+
+struct GpuMeshBounds {
+  glm::vec4 sphere;    // xyz = center, w = radius
+  glm::vec4 aabbMin;   // xyz = min, w = unused
+  glm::vec4 aabbMax;   // xyz = max, w = unused
+  glm::vec4 lodErrors; // MeshLod::error of each level
+  uint32_t commandIndex; // LOD 0's slot in the indirect command buffer;
+                         // LOD k uses commandIndex + k
+  uint32_t lodCount;
+  uint32_t _pad[2];
+};
+
+struct CullPushConstants {
+  glm::vec4 planes[6];
+  glm::vec4 cameraPos; // xyz = eye, w = pixels per unit at distance 1
+  uint32_t entityCount;
+  float lodThreshold; // lodBias_
+  float lodHysteresis;
+};
+
+// Consecutive indirect commands sharing a material, drawn with one
+// vkCmdDrawIndexedIndirect call when multiDrawIndirect is available
+struct IndirectDrawGroup {
+  VkIndexType indexType;
+  int materialId;
+  uint32_t firstCommand;
+  uint32_t commandCount;
 };
 
 struct MaterialData {
   VkImage textureImage = VK_NULL_HANDLE;
-  VkDeviceMemory textureMemory = VK_NULL_HANDLE;
+  MemoryAllocation textureMemory;
   VkImageView textureView = VK_NULL_HANDLE;
   VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
   bool ownsTexture = true;
+  bool resident = true; // false while its texture upload is in flight
+};
+
+// A texture already on the GPU, found again by a hash of its encoded bytes.
+// Materials are never released, so entries live until cleanup. The size and
+// a second, unrelated hash guard against a key collision returning another
+// image's material.
+struct TextureCacheEntry {
+  int materialId = -1;
+  size_t encodedSize = 0;
+  uint64_t checkHash = 0;
+};
+
+// Renderer settings that change what loading a glTF file produces
+struct MeshImportSettings {
+  bool optimization = true;
+  bool lods = true;
+  float weldEpsilon = 0.0f;
+  bool textureMipmaps = true;
+
+  bool operator==(const MeshImportSettings &other) const {
+    return optimization == other.optimization && lods == other.lods &&
+           weldEpsilon == other.weldEpsilon &&
+           textureMipmaps == other.textureMipmaps;
+  }
+};
+
+// A glTF file loaded through loadMesh. A repeat load of the same canonical
+// path returns the newest meshId as long as the file's mtime and the import
+// settings haven't changed. Geometry arenas are append-only, so a mesh whose
+// refCount drops to zero stays resident until cleanup; superseded versions
+// keep their entry so holders can still release them.
+struct MeshAsset {
+  std::string path; // canonical
+  int meshId = -1;
+  std::filesystem::file_time_type mtime;
+  MeshImportSettings settings;
+  uint32_t refCount = 0;
+};
+
+// A simplified version of a mesh. It indexes the mesh's own vertices, so a
+// level is just another index range in the index arena.
+static const uint32_t MAX_MESH_LODS = 4;
+
+struct MeshLod {
+  uint32_t indexOffset = 0; // in indices of the mesh's indexType
+  uint32_t indexCount = 0;
+  float error = 0.0f; // object-space deviation from LOD 0 (upper bound)
 };
 
 struct MeshData {
   int32_t vertexOffset;
-  uint32_t indexOffset;
+  uint32_t indexOffset; // in indices of indexType
   uint32_t indexCount;
+  // Meshes with at most 65536 vertices store 16-bit indices
+  VkIndexType indexType = VK_INDEX_TYPE_UINT32;
   int materialId = 0;
+  // lods[0] is the full mesh (indexOffset / indexCount above)
+  std::array<MeshLod, MAX_MESH_LODS> lods{};
+  uint32_t lodCount = 1;
+  // LOD 0 split into meshlets_[meshletOffset, +meshletCount); none for
+  // small meshes
+  uint32_t meshletOffset = 0;
+  uint32_t meshletCount = 0;
+
+  // Object-space bounds (computed in addMesh)
+  glm::vec3 boundsMin = glm::vec3(0.0f);
+  glm::vec3 boundsMax = glm::vec3(0.0f);
+  glm::vec3 boundsCenter = glm::vec3(0.0f);
+  float boundsRadius = 0.0f;
+};
+
+// Growable device-local buffer that mesh data is appended to. Bytes added
+// since the last frame sit in `pending` until the next command buffer copies
+// them in; running out of capacity doubles the buffer and copies the old
+// contents on the GPU.
+struct GeometryArena {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  MemoryAllocation memory;
+  VkDeviceSize capacity = 0; // bytes allocated
+  VkDeviceSize uploaded = 0; // bytes resident on the GPU
+  std::vector<uint8_t> pending;
+  // Buffer bound for drawing. Lags `buffer` after a grow until the upload
+  // batch that copied the old contents has landed.
+  VkBuffer drawBuffer = VK_NULL_HANDLE;
+};
+
+// Buffer still referenced by an in-flight frame; destroyed once that frame's
+// fence has signaled
+struct RetiredBuffer {
+  VkBuffer buffer;
+  MemoryAllocation memory;
+};
+
+// Persistently mapped host-visible buffer that every upload is staged
+// through. Allocations are made at `head`; `tail` advances in submission
+// order as the upload batches that read them complete.
+struct StagingRing {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  MemoryAllocation memory;
+  uint8_t *mapped = nullptr;
+  VkDeviceSize capacity = 0;
+  VkDeviceSize head = 0; // next free byte
+  VkDeviceSize tail = 0; // oldest byte still in use
+};
+
+// What the graphics side picks up once an upload batch has landed
+struct UploadAcquire {
+  VkSemaphore semaphore = VK_NULL_HANDLE; // transfer queue only
+  std::vector<VkImageMemoryBarrier> images; // ownership acquires
+  std::vector<int> materials;               // become drawable
+  size_t meshCount = 0; // meshes [0, meshCount) become drawable
+  VkBuffer vertexBuffer = VK_NULL_HANDLE; // arena buffers at submission
+  VkBuffer indexBuffer = VK_NULL_HANDLE;
+  std::vector<RetiredBuffer> replaced; // arena buffers outgrown by the batch
+};
+
+// Command buffer that collects upload commands until it is submitted
+struct UploadBatch {
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  VkFence fence = VK_NULL_HANDLE;
+  VkDeviceSize ringEnd = 0; // staging ring head at submission
+  UploadAcquire acquire;
 };
 
 struct EntityData {
   int meshId;
   glm::mat4 transform;
   bool active;
+  int proxyId = -1; // leaf in entityTree_ (scene entities only)
+  uint32_t lod = 0;  // LOD drawn last frame (CPU culling path)
+};
+
+// Requested swapchain present mode. Unsupported modes fall back
+// IMMEDIATE -> MAILBOX -> FIFO (FIFO is always available).
+enum PresentMode {
+  PRESENT_MODE_FIFO = 0,      // vsync, queues frames; highest latency
+  PRESENT_MODE_MAILBOX = 1,   // vsync, newest frame replaces the queued one
+  PRESENT_MODE_IMMEDIATE = 2, // no vsync, may tear; lowest latency
 };
 
 struct QueueFamilyIndices {
   std::optional<uint32_t> graphicsFamily;
   std::optional<uint32_t> presentFamily;
+  std::optional<uint32_t> transferFamily; // transfer-only, when available
 
   bool isComplete() const {
     return graphicsFamily.has_value() && presentFamily.has_value();
@@ -166,6 +474,9 @@ struct QueueFamilyIndices {
 class VulkanRenderer {
 public:
   bool init(int width, int height, const char *title);
+  // No window, surface or swapchain: frames render into offscreen images,
+  // optionally dumped to disk (see setFrameDumpDirectory)
+  bool initHeadless(int width, int height);
   void cleanup();
   bool shouldClose() const;
   void pollEvents();
@@ -177,7 +488,12 @@ public:
   void setRotation(float rx, float ry, float rz);
 
   // Multi-entity API
+  // Cached by canonical path + mtime; every successful call takes a
+  // reference that releaseMesh gives back
   int loadMesh(const char *path);
+  void releaseMesh(int meshId);
+  // -1 for meshes that didn't come from loadMesh
+  int getMeshRefCount(int meshId) const;
   int createEntity(int meshId);
 
   // Procedural primitives
@@ -215,6 +531,8 @@ public:
                 float outerCone);
   void clearLight(int index);
   void setAmbientIntensity(float intensity);
+  // Times the cluster build for 8, 16, ... up to maxLights point lights
+  void benchmarkLighting(int maxLights, int iterations);
 
   // Time
   void updateTime();
@@ -224,6 +542,65 @@ public:
   // Debug overlay
   void setDebugOverlay(bool enabled);
   int getActiveEntityCount() const;
+  int getCulledEntityCount() const;
+  RenderStats getRenderStats() const;
+  GpuTimings getGpuTimings() const;
+  MemoryStats getMemoryStats() const;
+  void printMemoryStats() const;
+  void benchmarkCulling(int entityCount, int iterations);
+  // Times the mesh optimizer on a glTF file's geometry (a generated grid if
+  // path is null or empty)
+  void benchmarkMeshOptimizer(const char *path, int iterations);
+
+  // Frame pacing. Frames in flight (1-3) size every per-frame resource, so
+  // they can only be set before init. The present mode can change at any
+  // time; after init the swapchain is recreated at the next present.
+  void setFramesInFlight(int count);
+  int getFramesInFlight() const;
+  void setPresentMode(PresentMode mode);
+  // The mode in use after fallback (the requested one before init)
+  PresentMode getPresentMode() const;
+
+  // GPU-driven culling (compute pass + indirect draws)
+  void setGpuCulling(bool enabled);
+  bool isGpuCullingEnabled() const;
+
+  // Per-instance meshlet culling on the CPU path (on by default): meshlets
+  // outside the frustum or facing away from the camera are left out of the
+  // draw. Only LOD 0 of meshes big enough to have meshlets is affected.
+  void setMeshletCulling(bool enabled);
+  bool isMeshletCullingEnabled() const;
+  MeshletStats getMeshletStats() const;
+
+  // Mip chains for textures loaded after the call (on by default)
+  void setTextureMipmaps(bool enabled);
+  bool getTextureMipmaps() const;
+
+  // Vertex cache, overdraw and vertex fetch ordering for meshes added after
+  // the call (on by default)
+  void setMeshOptimization(bool enabled);
+  bool getMeshOptimization() const;
+  // Meshes added after the call merge vertices whose attributes all fall in
+  // the same epsilon-sized cell (0, the default, merges exact duplicates)
+  void setWeldEpsilon(float epsilon);
+  float getWeldEpsilon() const;
+
+  // Level of detail. Meshes added while LODs are on (the default) get up to
+  // MAX_MESH_LODS - 1 simplified levels. Each entity draws the coarsest level
+  // whose error projects to at most `bias` pixels (0 = lossless levels only).
+  // It only switches once that error is a `hysteresis` fraction past the
+  // threshold, so entities near a switch distance don't flicker.
+  void setMeshLods(bool enabled);
+  bool getMeshLods() const;
+  void setLodBias(float pixels);
+  float getLodBias() const;
+  void setLodHysteresis(float fraction);
+  float getLodHysteresis() const;
+
+  // Parallel command recording (1 = record inline on the render thread)
+  void setRecordThreads(int threadCount);
+  int getRecordThreads() const;
+  void benchmarkRecording(int drawCount, int iterations);
 
   // Debug wireframe entities (rendered only when debug overlay is on)
   int createDebugEntity(int meshId);
@@ -231,12 +608,17 @@ public:
   void removeDebugEntity(int entityId);
   void clearDebugEntities();
 
+  // Headless frame dumps: every rendered frame is written to
+  // <directory>/frame_NNNNN.ppm (empty = off)
+  void setFrameDumpDirectory(const char *directory);
+
 private:
   // Window
   GLFWwindow *window_ = nullptr;
   int width_ = 800;
   int height_ = 600;
   bool framebufferResized_ = false;
+  bool headless_ = false;
 
   // Vulkan core
   VkInstance instance_ = VK_NULL_HANDLE;
@@ -245,7 +627,17 @@ private:
   VkDevice device_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_ = VK_NULL_HANDLE;
   VkQueue presentQueue_ = VK_NULL_HANDLE;
+  VkQueue uploadQueue_ = VK_NULL_HANDLE; // transfer queue, else graphics
   QueueFamilyIndices queueFamilies_;
+  uint32_t uploadFamily_ = 0;
+  bool dedicatedTransfer_ = false;
+  VkPhysicalDeviceLimits deviceLimits_{};
+  bool multiDrawIndirectSupported_ = false;
+  bool gpuCullingSupported_ = false;
+  bool drawIndirectFirstInstanceSupported_ = false;
+
+  // Every buffer and image is bound into memory from here
+  MemoryAllocator memoryAllocator_;
 
   // Swapchain
   VkSwapchainKHR swapchain_ = VK_NULL_HANDLE;
@@ -255,9 +647,17 @@ private:
   std::vector<VkImageView> swapchainImageViews_;
   std::vector<VkFramebuffer> swapchainFramebuffers_;
 
+  // Headless: swapchainImages_ are our own images, one per frame in flight,
+  // left in TRANSFER_SRC_OPTIMAL by the render pass
+  std::vector<MemoryAllocation> offscreenImagesMemory_;
+  std::string frameDumpDirectory_;
+  uint32_t frameDumpIndex_ = 0;
+  std::vector<VkBuffer> readbackBuffers_;
+  std::vector<MemoryAllocation> readbackBuffersMemory_;
+
   // Depth
   VkImage depthImage_ = VK_NULL_HANDLE;
-  VkDeviceMemory depthImageMemory_ = VK_NULL_HANDLE;
+  MemoryAllocation depthImageMemory_;
   VkImageView depthImageView_ = VK_NULL_HANDLE;
 
   // Pipeline
@@ -266,32 +666,184 @@ private:
   VkPipelineLayout pipelineLayout_ = VK_NULL_HANDLE;
   VkPipeline graphicsPipeline_ = VK_NULL_HANDLE;
 
-  // Buffers
-  VkBuffer vertexBuffer_ = VK_NULL_HANDLE;
-  VkDeviceMemory vertexBufferMemory_ = VK_NULL_HANDLE;
-  VkBuffer indexBuffer_ = VK_NULL_HANDLE;
-  VkDeviceMemory indexBufferMemory_ = VK_NULL_HANDLE;
+  // Shared by every pipeline; seeded from and saved to PIPELINE_CACHE_PATH
+  VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+  bool pipelineCacheWarm_ = false; // loaded a valid cache file
+  double pipelineBuildMs_ = 0.0;   // time spent creating pipelines at init
+  static constexpr const char *PIPELINE_CACHE_PATH =
+      "build/pipeline_cache.bin";
+
+  // Geometry (all meshes share one vertex and one index buffer; 16- and
+  // 32-bit index ranges live side by side in the index arena)
+  GeometryArena vertexArena_;
+  GeometryArena indexArena_;
+  // Bytes of mesh data added, and what it would take as Vertex + uint32
+  // indices, for printMemoryStats
+  VkDeviceSize geometryBytes_ = 0;
+  VkDeviceSize unpackedGeometryBytes_ = 0;
+  bool meshOptimization_ = true;
+  float weldEpsilon_ = 0.0f;
+  bool meshLods_ = true;
+  float lodBias_ = 1.0f;
+  float lodHysteresis_ = 0.25f;
+  // Workers for CPU mesh processing at load time, started by the first mesh
+  // big enough to split
+  TaskPool meshPool_;
+  static const VkDeviceSize GEOMETRY_ARENA_MIN_BYTES = 1 << 20;
+
+  // Uploads (textures, geometry) staged through one ring, one submit per
+  // frame or per ring-full of data
+  StagingRing stagingRing_;
+  UploadBatch uploadBatch_;       // open batch, commandBuffer null if none
+  bool uploadBatchStaged_ = false; // open batch holds ring allocations
+  std::deque<UploadBatch> uploadsInFlight_;
+  std::vector<UploadBatch> freeUploadBatches_;
+  std::vector<UploadAcquire> uploadsToAcquire_; // landed, not yet acquired
+  size_t residentMeshCount_ = 0;
+  // Graphics-side handoff recorded at the start of the next frame
+  std::vector<VkSemaphore> uploadWaitSemaphores_;
+  std::vector<VkImageMemoryBarrier> uploadImageAcquires_;
+  std::vector<VkSemaphore> freeUploadSemaphores_;
+  std::vector<std::vector<VkSemaphore>> uploadSemaphoresInUse_; // per frame
+  static const VkDeviceSize STAGING_RING_BYTES = 16 << 20;
+  static const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+  // Frame pacing
+  static const int MAX_FRAMES_IN_FLIGHT = 3;
+  int framesInFlight_ = 2;
+  PresentMode requestedPresentMode_ = PRESENT_MODE_MAILBOX;
+  PresentMode activePresentMode_ = PRESENT_MODE_MAILBOX;
 
   // Uniform buffers (per frame in flight)
-  static const int MAX_FRAMES_IN_FLIGHT = 2;
   std::vector<VkBuffer> uniformBuffers_;
-  std::vector<VkDeviceMemory> uniformBuffersMemory_;
+  std::vector<MemoryAllocation> uniformBuffersMemory_;
   std::vector<void *> uniformBuffersMapped_;
 
   // Light uniform buffers (per frame in flight)
   std::vector<VkBuffer> lightBuffers_;
-  std::vector<VkDeviceMemory> lightBuffersMemory_;
+  std::vector<MemoryAllocation> lightBuffersMemory_;
   std::vector<void *> lightBuffersMapped_;
   LightUBO lightData_{};
 
+  // Lights by slot as set through the API; slots past lightSlotCount_ are
+  // all inactive. Each frame the active ones are packed into the light
+  // storage buffer and the bounded ones are assigned to clusters.
+  std::array<GpuLight, MAX_LIGHTS> lights_{};
+  int lightSlotCount_ = 0;
+  std::vector<VkBuffer> lightStorageBuffers_;
+  std::vector<MemoryAllocation> lightStorageBuffersMemory_;
+  std::vector<void *> lightStorageBuffersMapped_;
+  LightClusterGrid lightClusters_;
+  std::vector<ClusterLight> clusterLights_;
+
+  // Cluster buffers (per frame in flight): CLUSTER_COUNT ranges followed by
+  // the light index list, which grows like the instance buffer
+  static const uint32_t INITIAL_CLUSTER_INDEX_CAPACITY = 4096;
+  std::vector<VkBuffer> clusterBuffers_;
+  std::vector<MemoryAllocation> clusterBuffersMemory_;
+  std::vector<void *> clusterBuffersMapped_;
+  std::vector<uint32_t> clusterIndexCapacity_;
+
+  // Instance buffers (per frame in flight, host-visible, persistently mapped)
+  static const uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+  std::vector<VkBuffer> instanceBuffers_;
+  std::vector<MemoryAllocation> instanceBuffersMemory_;
+  std::vector<void *> instanceBuffersMapped_;
+  std::vector<uint32_t> instanceCapacity_;
+
+  // Per-frame draw list (rebuilt every frame): sorted items, then batches
+  std::vector<DrawItem> drawItems_;
+  std::vector<DrawItem> drawItemsScratch_;
+  std::vector<DrawBatch> drawList_;
+  RenderStats renderStats_{};
+
+  // Frustum culling (frustum_ is rebuilt in updateUniformBuffer)
+  Frustum frustum_{};
+  DynamicAabbTree entityTree_;
+  std::vector<int> visibleEntities_;
+  std::vector<int> visibleDebugEntities_;
+  int culledEntityCount_ = 0;
+
+  // Meshlet culling: bounds for every mesh's LOD 0 clusters, and the
+  // per-frame indirect commands built from the ones that survive
+  bool meshletCulling_ = true;
+  std::vector<Meshlet> meshlets_;
+  std::vector<VkDrawIndexedIndirectCommand> meshletCommands_;
+  std::vector<VkBuffer> meshletCommandBuffers_;
+  std::vector<MemoryAllocation> meshletCommandBuffersMemory_;
+  std::vector<void *> meshletCommandBuffersMapped_;
+  std::vector<uint32_t> meshletCommandCapacity_;
+  MeshletStats meshletStats_{};
+
+  // GPU-driven culling: entities, mesh bounds and indirect commands live in
+  // per-frame host-visible buffers; cull.comp fills instance counts and the
+  // scene range of the instance buffer
+  bool gpuCulling_ = false;
+  VkDescriptorSetLayout cullDescriptorSetLayout_ = VK_NULL_HANDLE;
+  VkPipelineLayout cullPipelineLayout_ = VK_NULL_HANDLE;
+  VkPipeline cullPipeline_ = VK_NULL_HANDLE;
+  std::vector<VkDescriptorSet> cullDescriptorSets_;
+  std::vector<bool> cullDescriptorsDirty_;
+  std::vector<VkBuffer> gpuEntityBuffers_;
+  std::vector<MemoryAllocation> gpuEntityBuffersMemory_;
+  std::vector<void *> gpuEntityBuffersMapped_;
+  std::vector<uint32_t> gpuEntityCapacity_;
+  std::vector<VkBuffer> gpuMeshBuffers_;
+  std::vector<MemoryAllocation> gpuMeshBuffersMemory_;
+  std::vector<void *> gpuMeshBuffersMapped_;
+  std::vector<VkBuffer> indirectBuffers_;
+  std::vector<MemoryAllocation> indirectBuffersMemory_;
+  std::vector<void *> indirectBuffersMapped_;
+  std::vector<uint32_t> gpuMeshCapacity_;
+  // Current LOD per entity, read and written by cull.comp. One buffer shared
+  // by all frames, so each pass sees the choice the previous one made.
+  VkBuffer gpuLodStateBuffer_ = VK_NULL_HANDLE;
+  MemoryAllocation gpuLodStateMemory_;
+  void *gpuLodStateMapped_ = nullptr;
+  uint32_t gpuLodStateCapacity_ = 0;
+  // Entity uploads are incremental: each frame's buffer has its own dirty
+  // list, and gpuEntityDirtyMask_ holds one bit per frame in flight
+  std::vector<std::vector<int>> gpuDirtyEntities_;
+  std::vector<uint8_t> gpuEntityDirtyMask_;
+  std::vector<bool> gpuEntityFullUpload_;
+  // Active entities at the time each frame's cull pass was recorded, used to
+  // turn the read-back instance counts into a culled count
+  std::vector<int> gpuCulledBase_;
+  std::vector<uint32_t> gpuCommandCount_;
+  std::vector<uint32_t> meshEntityCounts_;
+  std::vector<int> gpuDrawOrder_; // mesh ids sorted by material
+  std::vector<IndirectDrawGroup> gpuDrawGroups_;
+
   // Descriptors
   VkDescriptorPool descriptorPool_ = VK_NULL_HANDLE;
   std::vector<VkDescriptorSet> descriptorSets_;
 
   // Commands
   VkCommandPool commandPool_ = VK_NULL_HANDLE;
+  VkCommandPool uploadCommandPool_ = VK_NULL_HANDLE; // on uploadFamily_
   std::vector<VkCommandBuffer> commandBuffers_;
 
+  // Parallel recording: worker threads fill secondary command buffers from
+  // their own pools; the primary executes them inside the render pass
+  int recordThreads_ = 1;
+  TaskPool recordPool_;
+  std::vector<std::vector<RecordContext>> recordContexts_; // [frame][slot]
+  std::vector<RecordTask> recordTasks_;
+  std::vector<VkCommandBuffer> recordTaskBuffers_;
+  std::vector<DrawState> recordTaskStates_;
+
+  // GPU timings: per frame in flight, read back once the frame's fence has
+  // signaled so results never stall
+  std::vector<VkQueryPool> timestampPools_;
+  std::vector<VkQueryPool> statisticsPools_;
+  std::vector<bool> timestampsWritten_;
+  std::vector<bool> statisticsWritten_;
+  bool timestampsSupported_ = false;
+  bool pipelineStatisticsSupported_ = false;
+  bool inheritedQueriesSupported_ = false;
+  uint32_t timestampValidBits_ = 0;
+  GpuTimings gpuTimings_{};
+
   // Sync
   std::vector<VkSemaphore> imageAvailableSemaphores_;
   std::vector<VkSemaphore> renderFinishedSemaphores_;
@@ -300,9 +852,9 @@ private:
 
   // Multi-mesh geometry (combined buffer)
   std::vector<MeshData> meshes_;
-  std::vector<Vertex> allVertices_;
-  std::vector<uint32_t> allIndices_;
-  bool buffersNeedRebuild_ = false;
+  std::unordered_map<int, MeshAsset> meshAssets_; // by mesh id
+  std::unordered_map<std::string, int> currentMeshAssets_; // newest per path
+  std::vector<std::vector<RetiredBuffer>> retiredBuffers_; // per frame
 
   // Entities
   std::vector<EntityData> entities_;
@@ -348,49 +900,137 @@ private:
   void createCommandPool();
   void createDepthResources();
   void createUniformBuffers();
+  void createInstanceBuffers();
   void createDescriptorPool();
   void createDescriptorSets();
   void createCommandBuffers();
   void createSyncObjects();
+  void createCullPipeline();
+  void createPipelineCache();
+  void savePipelineCache();
+  void createQueryPools();
+  void destroyQueryPools();
+  void writeTimestamp(VkCommandBuffer commandBuffer, GpuTimestamp timestamp);
+  void readGpuTimings(uint32_t frame);
+  bool statisticsActive() const;
+  size_t debugBatchStart() const;
 
   // Swapchain recreation
   void recreateSwapchain();
   void cleanupSwapchain();
 
-  // Multi-entity
-  void rebuildGeometryBuffers();
-  int addMesh(const std::vector<Vertex> &vertices,
-              const std::vector<uint32_t> &indices);
+  // Headless
+  bool initVulkan();
+  void createOffscreenTargets();
+  void recordFrameReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+  void writeFrameDump(uint32_t frame);
+  void destroyReadbackBuffers();
 
-  // One-time command buffer helpers
-  VkCommandBuffer beginOneTimeCommands();
-  void endOneTimeCommands(VkCommandBuffer commandBuffer);
+  // Multi-entity
+  VkDeviceSize appendGeometry(GeometryArena &arena, const void *data,
+                              VkDeviceSize size, VkDeviceSize alignment = 1);
+  bool hasPendingGeometry() const;
+  void recordGeometryUploads();
+  void growGeometryArena(VkCommandBuffer commandBuffer, GeometryArena &arena,
+                         VkDeviceSize required, VkBufferUsageFlags usage);
+  void destroyGeometryArena(GeometryArena &arena);
+  void retireBuffer(VkBuffer buffer, const MemoryAllocation &memory);
+  void releaseRetiredBuffers(uint32_t frame);
+  int addMesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices);
+  int loadMeshFile(const char *path);
+
+  // Staging ring + batched uploads
+  void createStagingRing(VkDeviceSize capacity);
+  void destroyStagingRing();
+  bool allocateStaging(VkDeviceSize size, VkDeviceSize &offset);
+  VkDeviceSize stageUpload(const void *data, VkDeviceSize size);
+  VkCommandBuffer uploadCommands();
+  void submitUploads();
+  void reclaimUploads(bool waitOldest);
+  void waitForUploads();
+  void acquireUploads();
+  void recordUploadAcquires(VkCommandBuffer commandBuffer);
+  void destroyUploadBatches();
 
   // Entity pool helpers
   int allocateEntity(std::vector<EntityData> &pool, std::vector<int> &freeSlots,
                      int meshId);
   void recalcNumLights();
+  void updateLights(uint32_t frame, const glm::mat4 &view);
+  void ensureClusterCapacity(uint32_t frame, uint32_t indexCount);
+  void writeLightDescriptors(uint32_t frame);
 
   // Helpers
   QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) const;
   bool isDeviceSuitable(VkPhysicalDevice device) const;
   VkShaderModule createShaderModule(const std::vector<char> &code) const;
-  uint32_t findMemoryType(uint32_t typeFilter,
-                          VkMemoryPropertyFlags properties) const;
   void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
-                    VkMemoryPropertyFlags properties, VkBuffer &buffer,
-                    VkDeviceMemory &memory) const;
-  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+                    VkMemoryPropertyFlags properties, MemoryCategory category,
+                    VkBuffer &buffer, MemoryAllocation &memory,
+                    bool sharedWithUploadQueue = false);
   void createImage(uint32_t w, uint32_t h, VkFormat format,
                    VkImageTiling tiling, VkImageUsageFlags usage,
-                   VkMemoryPropertyFlags properties, VkImage &image,
-                   VkDeviceMemory &memory) const;
+                   VkMemoryPropertyFlags properties, MemoryCategory category,
+                   VkImage &image, MemoryAllocation &memory,
+                   uint32_t mipLevels = 1);
   VkImageView createImageView(VkImage image, VkFormat format,
-                              VkImageAspectFlags aspectFlags) const;
+                              VkImageAspectFlags aspectFlags,
+                              uint32_t mipLevels = 1) const;
   VkFormat findDepthFormat() const;
   void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+  void bindPipelineCached(VkCommandBuffer commandBuffer, DrawState &state,
+                          VkPipeline pipeline);
+  void bindMaterialCached(VkCommandBuffer commandBuffer, DrawState &state,
+                          int materialId);
+  void bindIndexTypeCached(VkCommandBuffer commandBuffer, DrawState &state,
+                           VkIndexType indexType);
+  void bindSceneState(VkCommandBuffer commandBuffer, DrawState &state);
+  void recordIndirectDraws(VkCommandBuffer commandBuffer, DrawState &state);
+  void recordDrawBatches(VkCommandBuffer commandBuffer, size_t firstBatch,
+                         size_t batchCount, DrawState &state);
+  void recordMeshletDraws(VkCommandBuffer commandBuffer, const DrawBatch &batch,
+                          DrawState &state);
+
+  // Parallel recording
+  void createRecordContexts();
+  void destroyRecordContexts();
+  VkCommandBuffer acquireSecondary(uint32_t frame, int slot);
+  void recordSecondaries(uint32_t frame, uint32_t imageIndex, int chunkCount);
   void updateUniformBuffer(uint32_t currentImage);
 
+  // Instancing
+  void ensureInstanceCapacity(uint32_t frame, uint32_t instanceCount);
+  void writeInstanceDescriptor(uint32_t frame);
+  void appendDrawItems(const std::vector<EntityData> &pool,
+                       const std::vector<int> &visible, uint32_t pipeline);
+  void buildDrawList(InstanceData *instances, uint32_t firstInstance);
+  Aabb computeWorldBounds(const EntityData &ent) const;
+  bool isEntityVisible(const EntityData &ent) const;
+  void collectVisibleEntities(std::vector<int> &visible) const;
+  float lodPixelScale() const;
+  uint32_t selectLod(const MeshData &mesh, const glm::mat4 &transform,
+                     uint32_t currentLod, float pixelScale) const;
+  void prepareInstances(uint32_t frame);
+  void cullMeshlets(uint32_t frame);
+  void ensureMeshletCommandCapacity(uint32_t frame, uint32_t commandCount);
+
+  // GPU-driven culling
+  void createGpuCullBuffers();
+  void ensureGpuCullCapacity(uint32_t frame, uint32_t entityCount,
+                             uint32_t meshCount);
+  void createMappedBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                          VkBuffer &buffer, MemoryAllocation &memory,
+                          void *&mapped);
+  void destroyMappedBuffer(VkBuffer &buffer, MemoryAllocation &memory,
+                           void *&mapped);
+  void ensureGpuLodStateCapacity(uint32_t entityCount);
+  void markGpuEntityDirty(int entityId);
+  void writeGpuEntity(uint32_t frame, int entityId);
+  void rebuildGpuDrawOrder();
+  void writeCullDescriptors(uint32_t frame);
+  void uploadGpuCullData(uint32_t frame);
+  void recordCullPass(VkCommandBuffer commandBuffer);
+
   // UI pipeline
   VkPipeline uiPipeline_ = VK_NULL_HANDLE;
   VkPipelineLayout uiPipelineLayout_ = VK_NULL_HANDLE;
@@ -400,7 +1040,7 @@ private:
 
   // Font atlas
   VkImage fontImage_ = VK_NULL_HANDLE;
-  VkDeviceMemory fontImageMemory_ = VK_NULL_HANDLE;
+  MemoryAllocation fontImageMemory_;
   VkImageView fontImageView_ = VK_NULL_HANDLE;
   VkSampler fontSampler_ = VK_NULL_HANDLE;
   bool fontLoaded_ = false;
@@ -408,7 +1048,7 @@ private:
   // UI vertex buffers (per frame, host-visible, persistently mapped)
   static const int UI_MAX_VERTICES = 4096;
   std::vector<VkBuffer> uiVertexBuffers_;
-  std::vector<VkDeviceMemory> uiVertexBuffersMemory_;
+  std::vector<MemoryAllocation> uiVertexBuffersMemory_;
   std::vector<void *> uiVertexBuffersMapped_;
   uint32_t uiVertexCount_ = 0;
   std::vector<UIVertex> uiVertices_;
@@ -440,8 +1080,9 @@ private:
   void appendQuad(float x, float y, float w, float h, glm::vec4 color);
 
   // Image layout transition helper
-  void transitionImageLayout(VkImage image, VkImageLayout oldLayout,
-                             VkImageLayout newLayout);
+  void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image,
+                             VkImageLayout oldLayout, VkImageLayout newLayout,
+                             uint32_t mipLevels = 1);
 
   // Material/texture system
   static const int MAX_MATERIALS = 64;
@@ -450,9 +1091,16 @@ private:
   VkSampler textureSampler_ = VK_NULL_HANDLE;
   std::vector<MaterialData> materials_;
   VkImage defaultTextureImage_ = VK_NULL_HANDLE;
-  VkDeviceMemory defaultTextureMemory_ = VK_NULL_HANDLE;
+  MemoryAllocation defaultTextureMemory_;
   VkImageView defaultTextureView_ = VK_NULL_HANDLE;
   int defaultMaterialId_ = 0;
+  std::unordered_map<uint64_t, TextureCacheEntry> textureCache_;
+  uint32_t textureCacheHits_ = 0;
+  // Full mip chains for loaded textures: blitted on the GPU when the upload
+  // queue can blit and the format supports linear filtering, otherwise
+  // box-filtered on the CPU and uploaded with the base level
+  bool textureMipmaps_ = true;
+  bool linearBlitSupported_ = false;
 
   void createMaterialDescriptorSetLayout();
   void createMaterialDescriptorPool();
@@ -460,9 +1108,21 @@ private:
   void createDefaultTexture();
   int createMaterial(VkImageView textureView);
   void cleanupMaterialResources();
-  void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width,
-                         uint32_t height);
+  void copyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer,
+                         VkDeviceSize offset, VkImage image, uint32_t width,
+                         uint32_t height, uint32_t mipLevel = 0);
+  // `pixels` holds mipLevels tightly packed levels of `block`s, largest
+  // first, unless blitMips is set: then it holds only the base level and the
+  // rest are generated with vkCmdBlitImage (upload queue must support
+  // graphics)
+  void uploadImage(VkImage image, const void *pixels, VkDeviceSize size,
+                   uint32_t width, uint32_t height, uint32_t mipLevels = 1,
+                   bool blitMips = false, const TexelBlock &block = {});
+  void recordMipmapBlits(VkCommandBuffer commandBuffer, VkImage image,
+                         uint32_t width, uint32_t height, uint32_t mipLevels);
   int loadTextureFromMemory(const uint8_t *data, size_t size);
+  int decodeTexture(const uint8_t *data, size_t size);
+  int loadTextureKtx2(const uint8_t *data, size_t size);
 
   static void framebufferResizeCallback(GLFWwindow *window, int w, int h);
   static void scrollCallback(GLFWwindow *window, double xoffset,
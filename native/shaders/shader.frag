@@ -1,6 +1,9 @@
 #version 450
 
-#define MAX_LIGHTS 8
+// Must match light_clusters.h
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
 
 #define LIGHT_DIRECTIONAL 0
 #define LIGHT_POINT       1
@@ -17,13 +20,24 @@ struct Light {
 };
 
 layout(set = 0, binding = 1) uniform LightData {
-    vec4  cameraPos;       // xyz = eye position
+    vec4  cameraPos;        // xyz = eye position
+    vec4  cameraForward;    // xyz = view direction
+    vec4  clusterParams;    // xy = clusters per pixel, zw = slice scale/bias
     int   numLights;
+    int   globalLightCount; // lights shaded by every fragment, stored first
     float ambientIntensity;
-    // 8 bytes implicit std140 padding before array
-    Light lights[MAX_LIGHTS];
 } ld;
 
+layout(std430, set = 0, binding = 3) readonly buffer LightBuffer {
+    Light lights[];
+};
+
+// One (offset, count) range per cluster into lightIndices
+layout(std430, set = 0, binding = 4) readonly buffer ClusterBuffer {
+    uvec2 clusterRanges[CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z];
+    uint  lightIndices[];
+};
+
 layout(set = 1, binding = 0) uniform sampler2D baseColorTex;
 
 layout(location = 0) in vec3 fragNormal;
@@ -89,8 +103,20 @@ void main() {
     vec3 ambient = baseColor * ld.ambientIntensity;
     vec3 result = ambient;
 
-    for (int i = 0; i < ld.numLights; i++) {
-        result += baseColor * calcLight(ld.lights[i], normal, fragWorldPos, viewDir);
+    for (int i = 0; i < ld.globalLightCount; i++) {
+        result += baseColor * calcLight(lights[i], normal, fragWorldPos, viewDir);
+    }
+
+    // Point and spot lights: only those listed in this fragment's cluster
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * ld.clusterParams.xy),
+                     uvec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    float depth = max(dot(fragWorldPos - ld.cameraPos.xyz, ld.cameraForward.xyz), 1e-4);
+    int slice = clamp(int(floor(log(depth) * ld.clusterParams.z - ld.clusterParams.w)),
+                      0, CLUSTER_GRID_Z - 1);
+    uvec2 range = clusterRanges[tile.x + CLUSTER_GRID_X * (tile.y + CLUSTER_GRID_Y * uint(slice))];
+    for (uint i = 0u; i < range.y; i++) {
+        Light light = lights[lightIndices[range.x + i]];
+        result += baseColor * calcLight(light, normal, fragWorldPos, viewDir);
     }
 
     outColor = vec4(result, 1.0);
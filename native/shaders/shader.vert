@@ -5,13 +5,19 @@ layout(set = 0, binding = 0) uniform UniformBufferObject {
     mat4 proj;
 } ubo;
 
-layout(push_constant) uniform PushConstants {
+struct InstanceData {
     mat4 model;
-} pc;
+};
 
+layout(std430, set = 0, binding = 2) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+};
+
+// PackedVertex: the normal arrives octahedral-encoded (R16G16_SNORM), the
+// color as RGBA8 unorm and the UV as half floats
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec3 inColor;
+layout(location = 1) in vec2 inNormalOct;
+layout(location = 2) in vec4 inColor;
 layout(location = 3) in vec2 inUV;
 
 layout(location = 0) out vec3 fragNormal;
@@ -19,11 +25,21 @@ layout(location = 1) out vec3 fragColor;
 layout(location = 2) out vec3 fragWorldPos;
 layout(location = 3) out vec2 fragUV;
 
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main() {
-    vec4 worldPos = pc.model * vec4(inPosition, 1.0);
+    // gl_InstanceIndex includes the draw's firstInstance offset
+    mat4 model = instances[gl_InstanceIndex].model;
+    vec4 worldPos = model * vec4(inPosition, 1.0);
     gl_Position = ubo.proj * ubo.view * worldPos;
-    fragNormal = mat3(transpose(inverse(pc.model))) * inNormal;
-    fragColor = inColor;
+    fragNormal = mat3(transpose(inverse(model))) * octDecode(inNormalOct);
+    fragColor = inColor.rgb;
     fragWorldPos = worldPos.xyz;
     fragUV = inUV;
 }
@@ -0,0 +1,90 @@
+#include "task_pool.h"
+#include "profiler.h"
+
+TaskPool::~TaskPool() { resize(0); }
+
+void TaskPool::resize(int workerCount) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto &thread : threads_)
+    thread.join();
+  threads_.clear();
+
+  // Workers start from the current generation so they only pick up jobs
+  // submitted after resize() returns, even if they are slow to start
+  stopping_ = false;
+  for (int i = 0; i < workerCount; i++)
+    threads_.emplace_back(&TaskPool::workerLoop, this, i, generation_);
+}
+
+void TaskPool::parallelFor(int taskCount,
+                           const std::function<void(int, int)> &task) {
+  if (taskCount <= 0)
+    return;
+
+  if (threads_.empty()) {
+    for (int i = 0; i < taskCount; i++)
+      task(i, 0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    taskCount_ = taskCount;
+    nextTask_.store(0);
+    activeWorkers_ = static_cast<int>(threads_.size());
+    error_ = nullptr;
+    generation_++;
+  }
+  wake_.notify_all();
+
+  runTasks(static_cast<int>(threads_.size()));
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return activeWorkers_ == 0; });
+    task_ = nullptr;
+    error = error_;
+  }
+  if (error)
+    std::rethrow_exception(error);
+}
+
+void TaskPool::workerLoop(int slot, uint64_t seen) {
+  PROFILE_THREAD_NAME("TaskPool worker");
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+      if (stopping_)
+        return;
+      seen = generation_;
+    }
+
+    runTasks(slot);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--activeWorkers_ == 0)
+      done_.notify_one();
+  }
+}
+
+void TaskPool::runTasks(int slot) {
+  for (;;) {
+    int index = nextTask_.fetch_add(1);
+    if (index >= taskCount_)
+      return;
+    try {
+      (*task_)(index, slot);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_)
+        error_ = std::current_exception();
+    }
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for fork/join work (parallel command recording).
+// parallelFor() hands out task indices to the workers and the calling thread,
+// then blocks until every task has run.
+class TaskPool {
+public:
+  TaskPool() = default;
+  ~TaskPool();
+  TaskPool(const TaskPool &) = delete;
+  TaskPool &operator=(const TaskPool &) = delete;
+
+  // Stops the current workers and starts workerCount new ones (0 = run
+  // everything on the calling thread)
+  void resize(int workerCount);
+  int getWorkerCount() const { return static_cast<int>(threads_.size()); }
+
+  // Runs task(taskIndex, slot) for every taskIndex in [0, taskCount). slot
+  // identifies the executing thread: workers use [0, getWorkerCount()), the
+  // caller uses getWorkerCount(). Per-slot resources therefore need
+  // getWorkerCount() + 1 entries. The first exception thrown by a task is
+  // rethrown on the calling thread.
+  void parallelFor(int taskCount, const std::function<void(int, int)> &task);
+
+private:
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(int, int)> *task_ = nullptr;
+  int taskCount_ = 0;
+  std::atomic<int> nextTask_{0};
+  int activeWorkers_ = 0;
+  uint64_t generation_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr error_;
+
+  void workerLoop(int slot, uint64_t seen);
+  void runTasks(int slot);
+};